@@ -0,0 +1,129 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ * microbenchmark for the in-row search strategies of crs_matrix
+ *
+ * build: g++ -std=c++14 -O3 -march=native -I../include crs_search_bench.cpp
+ *
+ *****************************************************************************/
+
+#include "crs_search.h"
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+/// @brief many rows of equal length with random, strictly ascending indices
+template<class T>
+struct bench_rows
+{
+    bench_rows(std::size_t rowLength, std::size_t totalSize, std::mt19937& urbg):
+        len{rowLength}, rows{std::max(std::size_t(1), totalSize / rowLength)},
+        colidx(rows * rowLength)
+    {
+        auto gapDistr = std::uniform_int_distribution<int>{1,8};
+        for(std::size_t r = 0; r < rows; ++r) {
+            T x = 0;
+            for(std::size_t i = 0; i < len; ++i) {
+                x = T(x + T(gapDistr(urbg)));
+                colidx[r*len + i] = x;
+            }
+        }
+    }
+
+    std::size_t len;
+    std::size_t rows;
+    std::vector<T> colidx;
+};
+
+
+
+//-------------------------------------------------------------------
+template<class T, class Search>
+double ns_per_lookup(const bench_rows<T>& data,
+                     const std::vector<std::pair<std::size_t,T>>& queries,
+                     Search search, std::size_t& checksum)
+{
+    using clock = std::chrono::steady_clock;
+
+    const auto t0 = clock::now();
+    for(const auto& q : queries) {
+        const auto b = data.colidx.data() + q.first * data.len;
+        const auto e = b + data.len;
+        checksum += std::size_t(search(b, e, q.second) - b);
+    }
+    const auto t1 = clock::now();
+
+    return std::chrono::duration<double,std::nano>(t1 - t0).count()
+           / double(queries.size());
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+void run(const char* typeName)
+{
+    constexpr std::size_t totalSize = std::size_t(1) << 22;
+    constexpr std::size_t numQueries = std::size_t(1) << 22;
+
+    auto urbg = std::mt19937{};
+
+    std::printf("\nindex type: %s  (ns per lookup)\n", typeName);
+    std::printf("%10s %12s %12s %12s %12s %12s\n", "row length",
+                "std::lower", "linear", "branchless", "interpol.", "adaptive");
+
+    for(std::size_t len : {4, 8, 16, 32, 64, 256, 1024, 4096, 65536, 1048576}) {
+        const auto data = bench_rows<T>{len, totalSize, urbg};
+
+        auto rowDistr = std::uniform_int_distribution<std::size_t>{0, data.rows-1};
+        auto keyDistr = std::uniform_int_distribution<std::size_t>{0, len * 9 / 2};
+        auto queries = std::vector<std::pair<std::size_t,T>>{};
+        queries.reserve(numQueries);
+        for(std::size_t i = 0; i < numQueries; ++i) {
+            queries.emplace_back(rowDistr(urbg), T(keyDistr(urbg)));
+        }
+
+        std::size_t checksum = 0;
+        const auto tStd = ns_per_lookup(data, queries,
+            [](const T* f, const T* l, const T& k) { return std::lower_bound(f,l,k); },
+            checksum);
+        const auto tLin = (len <= 4096) ? ns_per_lookup(data, queries,
+            [](const T* f, const T* l, const T& k) { return linear_lower_bound(f,l,k); },
+            checksum) : 0.0;
+        const auto tBin = ns_per_lookup(data, queries,
+            [](const T* f, const T* l, const T& k) { return branchless_lower_bound(f,l,k); },
+            checksum);
+        const auto tInt = ns_per_lookup(data, queries,
+            [](const T* f, const T* l, const T& k) { return interpolation_lower_bound(f,l,k); },
+            checksum);
+        const auto tAda = ns_per_lookup(data, queries,
+            [](const T* f, const T* l, const T& k) { return adaptive_lower_bound(f,l,k); },
+            checksum);
+
+        std::printf("%10zu %12.2f %12.2f %12.2f %12.2f %12.2f   (%zu)\n",
+                    len, tStd, tLin, tBin, tInt, tAda, checksum % 10);
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    run<std::uint32_t>("uint32");
+    run<std::uint64_t>("uint64");
+}
@@ -0,0 +1,113 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ * SpMV benchmark: crs_matrix vs. SELL-C-sigma on power-law matrices
+ *
+ * build: g++ -std=c++14 -O3 -march=native -pthread -I../include sell_matrix_bench.cpp
+ *
+ *****************************************************************************/
+
+#include "crs_matrix_algorithms.h"
+#include "sell_matrix.h"
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+/// @brief row lengths follow a power law (Pareto distribution)
+crs_matrix<double>
+make_power_law_matrix(std::size_t n, double avgLength, double exponent)
+{
+    auto urbg = std::mt19937_64{42};
+    auto uni = std::uniform_real_distribution<double>{0.0, 1.0};
+    auto colDistr = std::uniform_int_distribution<std::size_t>{0, n-1};
+
+    const auto xmin = avgLength * (exponent - 1) / exponent;
+
+    auto tri = std::vector<crs_triplet<double>>{};
+    tri.reserve(std::size_t(double(n) * avgLength * 1.2));
+    for(std::size_t r = 0; r < n; ++r) {
+        auto len = std::size_t(xmin / std::pow(1.0 - uni(urbg), 1.0 / exponent));
+        if(len > n / 4) len = n / 4;
+        for(std::size_t i = 0; i < len; ++i) {
+            tri.push_back({r, colDistr(urbg), uni(urbg)});
+        }
+    }
+    auto m = crs_matrix<double>::from_triplets(tri.begin(), tri.end(),
+                                               crs_keep_last{}, 0);
+    m.rows(n);
+    m.cols(n);
+    return m;
+}
+
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+double gflops(const Matrix& m, std::size_t nnz, int threads, int reps)
+{
+    using clock = std::chrono::steady_clock;
+
+    auto x = std::vector<double>(m.cols(), 1.0);
+    auto y = std::vector<double>(m.rows(), 0.0);
+
+    spmv(m, x, y, 1.0, 0.0, threads);  //warm-up
+
+    const auto t0 = clock::now();
+    for(int i = 0; i < reps; ++i) spmv(m, x, y, 1.0, 0.0, threads);
+    const auto t1 = clock::now();
+
+    const auto s = std::chrono::duration<double>(t1 - t0).count();
+    return 2.0 * double(nnz) * reps / s * 1e-9;
+}
+
+
+
+//-------------------------------------------------------------------
+template<std::size_t C>
+void run_sell(const crs_matrix<double>& m, std::size_t sigma, int threads, int reps)
+{
+    const auto s = sell_matrix<double,C>{m, sigma};
+    std::printf("  SELL-%zu-%-8zu fill %.3f  %8.3f GFlop/s\n",
+                C, s.sigma(), s.fill_ratio(), gflops(s, m.size(), threads, reps));
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    constexpr std::size_t n = 1 << 20;
+    constexpr int reps = 20;
+
+    for(double exponent : {1.5, 2.0, 3.0}) {
+        const auto m = make_power_law_matrix(n, 12.0, exponent);
+
+        for(int threads : {1, 0}) {
+            std::printf("\nrows: %zu  nnz: %zu  exponent: %.1f  threads: %d\n",
+                        m.rows(), m.size(), exponent, effective_thread_count(threads));
+
+            std::printf("  CRS                        %8.3f GFlop/s\n",
+                        gflops(m, m.size(), threads, reps));
+
+            run_sell<4>(m, 1, threads, reps);
+            run_sell<4>(m, 4*32, threads, reps);
+            run_sell<8>(m, 1, threads, reps);
+            run_sell<8>(m, 8*32, threads, reps);
+            run_sell<8>(m, 8*1024, threads, reps);
+            run_sell<16>(m, 16*32, threads, reps);
+        }
+    }
+}
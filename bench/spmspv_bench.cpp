@@ -0,0 +1,122 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ * SpMSpV benchmark: push vs. pull vs. automatic direction vs. dense SpMV
+ * on power-law matrices for frontiers of increasing density
+ *
+ * build: g++ -std=c++14 -O3 -march=native -pthread -I../include spmspv_bench.cpp
+ *
+ *****************************************************************************/
+
+#include "sparse_vector.h"
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+/// @brief row lengths follow a power law (Pareto distribution)
+crs_matrix<double>
+make_power_law_matrix(std::size_t n, double avgLength, double exponent)
+{
+    auto urbg = std::mt19937_64{42};
+    auto uni = std::uniform_real_distribution<double>{0.0, 1.0};
+    auto colDistr = std::uniform_int_distribution<std::size_t>{0, n-1};
+
+    const auto xmin = avgLength * (exponent - 1) / exponent;
+
+    auto tri = std::vector<crs_triplet<double>>{};
+    tri.reserve(std::size_t(double(n) * avgLength * 1.2));
+    for(std::size_t r = 0; r < n; ++r) {
+        auto len = std::size_t(xmin / std::pow(1.0 - uni(urbg), 1.0 / exponent));
+        if(len > n / 4) len = n / 4;
+        for(std::size_t i = 0; i < len; ++i) {
+            tri.push_back({r, colDistr(urbg), uni(urbg)});
+        }
+    }
+    auto m = crs_matrix<double>::from_triplets(tri.begin(), tri.end(),
+                                               crs_keep_last{}, 0);
+    m.rows(n);
+    m.cols(n);
+    return m;
+}
+
+
+//-------------------------------------------------------------------
+sparse_vector<double>
+make_frontier(std::size_t n, double density)
+{
+    auto urbg = std::mt19937_64{7};
+    auto uni = std::uniform_real_distribution<double>{0.0, 1.0};
+
+    auto x = sparse_vector<double>{n};
+    for(std::size_t i = 0; i < n; ++i) {
+        if(uni(urbg) < density) x.push_back(i, 1.0);
+    }
+    return x;
+}
+
+
+//-------------------------------------------------------------------
+template<class Function>
+double milliseconds(Function&& f, int reps)
+{
+    using clock = std::chrono::steady_clock;
+    f();  //warm-up
+    const auto t0 = clock::now();
+    for(int i = 0; i < reps; ++i) f();
+    const auto t1 = clock::now();
+    return std::chrono::duration<double,std::milli>(t1 - t0).count() / reps;
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    constexpr std::size_t n = 1 << 20;
+    constexpr int reps = 5;
+
+    for(double exponent : {1.5, 2.5}) {
+        const auto m = make_power_law_matrix(n, 12.0, exponent);
+        auto engine = spmspv_engine<crs_matrix<double>>{m};
+
+        std::printf("\nrows: %zu  nnz: %zu  exponent: %.1f\n",
+                    m.rows(), m.size(), exponent);
+        std::printf("  %-10s %10s %10s %10s %10s %6s\n",
+                    "density", "push ms", "pull ms", "auto ms", "spmv ms", "auto");
+
+        auto dx = std::vector<double>{};
+        auto dy = std::vector<double>(n, 0.0);
+        auto y = sparse_vector<double>{};
+
+        for(double density : {1e-5, 1e-4, 1e-3, 1e-2, 0.05, 0.1, 0.3}) {
+            const auto x = make_frontier(n, density);
+            x.to_dense(dx);
+
+            const auto tpush = milliseconds([&]{
+                engine.multiply(x, y, spmspv_direction::push); }, reps);
+            const auto tpull = milliseconds([&]{
+                engine.multiply(x, y, spmspv_direction::pull); }, reps);
+            const auto tauto = milliseconds([&]{
+                engine.multiply(x, y); }, reps);
+            const auto tspmv = milliseconds([&]{
+                spmv(m, dx, dy); }, reps);
+
+            const bool push = engine.choose_direction(x) == spmspv_direction::push;
+            std::printf("  %-10g %10.3f %10.3f %10.3f %10.3f %6s\n",
+                        density, tpush, tpull, tauto, tspmv, push ? "push" : "pull");
+        }
+    }
+}
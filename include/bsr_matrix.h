@@ -0,0 +1,489 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_BSR_MATRIX_H_
+#define AMLIB_CONTAINERS_BSR_MATRIX_H_
+
+#include <cstddef>
+#include <type_traits>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <limits>
+
+#include "matrix_array.h"
+#include "crs_matrix.h"
+#include "parallel.h"
+
+
+namespace am {
+
+
+/*************************************************************************//***
+ *
+ * @brief block compressed row (BSR) sparse matrix:
+ *        stores dense (BlockRows x BlockCols) blocks contiguously
+ *        with one column index per block
+ *
+ * @details row and column indices of blocks are called 'block row' and
+ *          'block column'; element access via operator()(row,col) uses
+ *          scalar indices; positions inside of stored blocks that are not
+ *          part of the original sparsity pattern hold zeros
+ *
+ *****************************************************************************/
+template<
+    class ValueType,
+    std::size_t BlockRows,
+    std::size_t BlockCols = BlockRows,
+    class Allocator = std::allocator<ValueType>,
+    class ColIndexType = std::size_t,
+    class RowOffsetType = std::size_t
+>
+class bsr_matrix
+{
+    static_assert(BlockRows > 0 && BlockCols > 0,
+                  "block dimensions have to be positive");
+    static_assert(std::is_integral<ColIndexType>::value &&
+                  std::is_unsigned<ColIndexType>::value,
+                  "column index type has to be an unsigned integer type");
+    static_assert(std::is_integral<RowOffsetType>::value &&
+                  std::is_unsigned<RowOffsetType>::value,
+                  "row offset type has to be an unsigned integer type");
+
+public:
+    //---------------------------------------------------------------
+    // TYPES
+    //---------------------------------------------------------------
+    using value_type      = ValueType;
+    using block_type      = matrix_array<ValueType,BlockRows,BlockCols>;
+    using allocator_type  = Allocator;
+    using size_type       = std::size_t;
+    using col_index_type  = ColIndexType;
+    using row_offset_type = RowOffsetType;
+
+
+private:
+    template<class T>
+    using rebound_alloc =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+    using block_vector      = std::vector<block_type,rebound_alloc<block_type>>;
+    using col_index_vector  = std::vector<ColIndexType,
+                                          rebound_alloc<ColIndexType>>;
+    using row_offset_vector = std::vector<RowOffsetType,
+                                          rebound_alloc<RowOffsetType>>;
+
+
+public:
+    //-----------------------------------------------------
+    using iterator        = typename block_vector::iterator;
+    using const_iterator  = typename block_vector::const_iterator;
+    //-----------------------------------------------------
+    using block_storage      = block_vector;
+    using col_index_storage  = col_index_vector;
+    using row_offset_storage = row_offset_vector;
+
+
+    //---------------------------------------------------------------
+    // CONSTRUCTION / DESTRUCTION
+    //---------------------------------------------------------------
+    bsr_matrix():
+        blocks_{}, colidx_{}, rowbeg_{0}
+    {}
+
+    //-----------------------------------------------------
+    /** @brief  adopts BSR arrays (block row offsets hold
+     *          block_rows()+1 values); rows/cols are scalar dimensions
+     */
+    explicit
+    bsr_matrix(block_storage&& blocks,
+               col_index_storage&& colidx,
+               row_offset_storage&& rowbeg,
+               size_type rows, size_type cols)
+    :
+        blocks_(std::move(blocks)),
+        colidx_(std::move(colidx)),
+        rowbeg_(std::move(rowbeg)),
+        rows_{rows}, cols_{cols}
+    {
+        if(rowbeg_.empty()) rowbeg_.push_back(0);
+    }
+
+    //-----------------------------------------------------
+    /** @brief  converts a CRS matrix: every (BlockRows x BlockCols) tile
+     *          that contains at least one stored element becomes a block
+     */
+    template<class NA, class A, class CI, class RO>
+    explicit
+    bsr_matrix(const crs_matrix<value_type,NA,A,CI,RO>& m):
+        bsr_matrix{}
+    {
+        assign(m);
+    }
+
+
+    //---------------------------------------------------------------
+    // ASSIGNMENT
+    //---------------------------------------------------------------
+    template<class NA, class A, class CI, class RO>
+    void
+    assign(const crs_matrix<value_type,NA,A,CI,RO>& m)
+    {
+        rows_ = m.rows();
+        cols_ = m.cols();
+
+        const auto nbrows = (rows_ + BlockRows - 1) / BlockRows;
+        const auto val = m.data();
+        const auto col = m.col_index_data();
+        const auto beg = m.row_offset_data();
+
+        blocks_.clear();
+        colidx_.clear();
+        rowbeg_.assign(nbrows + 1, row_offset_type(0));
+
+        auto bcols = std::vector<size_type>{};
+
+        for(size_type br = 0; br < nbrows; ++br) {
+            const auto r0 = br * BlockRows;
+            const auto r1 = std::min(r0 + BlockRows, rows_);
+
+            //detect block columns of this block row
+            bcols.clear();
+            for(auto r = r0; r < r1; ++r) {
+                for(auto i = size_type(beg[r]); i < size_type(beg[r+1]); ++i) {
+                    const auto bc = size_type(col[i]) / BlockCols;
+                    if(bcols.empty() || bcols.back() != bc) bcols.push_back(bc);
+                }
+            }
+            std::sort(bcols.begin(), bcols.end());
+            bcols.erase(std::unique(bcols.begin(), bcols.end()), bcols.end());
+
+            const auto first = blocks_.size();
+            block_type zero;
+            zero.fill(value_type(0));
+            blocks_.resize(first + bcols.size(), zero);
+            for(auto bc : bcols) colidx_.push_back(col_index_type(bc));
+
+            //scatter values; column indices within a row are sorted
+            for(auto r = r0; r < r1; ++r) {
+                auto k = bcols.begin();
+                for(auto i = size_type(beg[r]); i < size_type(beg[r+1]); ++i) {
+                    const auto c = size_type(col[i]);
+                    while(*k < c / BlockCols) ++k;
+                    const auto b = first + size_type(k - bcols.begin());
+                    blocks_[b](r - r0, c - (*k) * BlockCols) = val[i];
+                }
+            }
+            rowbeg_[br+1] = row_offset_type(blocks_.size());
+        }
+    }
+
+
+    //---------------------------------------------------------------
+    // ELEMENT ACCESS
+    //---------------------------------------------------------------
+    /** @return pointer to block at (blockRow,blockCol) or nullptr */
+    const block_type*
+    find_block(size_type blockRow, size_type blockCol) const noexcept
+    {
+        if(blockRow >= block_rows() ||
+           blockCol > size_type(std::numeric_limits<col_index_type>::max()))
+        {
+            return nullptr;
+        }
+        const auto key = col_index_type(blockCol);
+        const auto b = colidx_.data() + rowbeg_[blockRow];
+        const auto e = colidx_.data() + rowbeg_[blockRow+1];
+        const auto it = adaptive_lower_bound(b, e, key);
+        return (it != e && *it == key)
+            ? blocks_.data() + (it - colidx_.data()) : nullptr;
+    }
+    //-----------------------------------------------------
+    block_type*
+    find_block(size_type blockRow, size_type blockCol) noexcept {
+        return const_cast<block_type*>(
+            static_cast<const bsr_matrix*>(this)->find_block(blockRow,blockCol));
+    }
+
+    //-----------------------------------------------------
+    /** @return true, if (row,col) lies in a stored block */
+    bool
+    has(size_type row, size_type col) const noexcept {
+        return find_block(row / BlockRows, col / BlockCols) != nullptr;
+    }
+
+    //-----------------------------------------------------
+    /** @return value at scalar index (row,col); zero if not stored */
+    value_type
+    operator () (size_type row, size_type col) const noexcept {
+        const auto b = find_block(row / BlockRows, col / BlockCols);
+        return b ? (*b)(row % BlockRows, col % BlockCols) : value_type(0);
+    }
+
+
+    //---------------------------------------------------------------
+    // DIRECT ACCESS TO BSR REPRESENTATION
+    //---------------------------------------------------------------
+    const block_type*
+    data() const noexcept {
+        return blocks_.data();
+    }
+    block_type*
+    data() noexcept {
+        return blocks_.data();
+    }
+    //-----------------------------------------------------
+    const col_index_type*
+    col_index_data() const noexcept {
+        return colidx_.data();
+    }
+    //-----------------------------------------------------
+    const row_offset_type*
+    row_offset_data() const noexcept {
+        return rowbeg_.data();
+    }
+
+
+    //---------------------------------------------------------------
+    // SIZE PROPERTIES
+    //---------------------------------------------------------------
+    /// @brief number of stored blocks
+    size_type size()  const noexcept { return blocks_.size(); }
+    bool      empty() const noexcept { return blocks_.empty(); }
+
+    /// @brief scalar dimensions
+    size_type rows() const noexcept { return rows_; }
+    size_type cols() const noexcept { return cols_; }
+
+    /// @brief dimensions in blocks
+    size_type block_rows() const noexcept { return rowbeg_.size() - 1; }
+    size_type block_cols() const noexcept {
+        return (cols_ + BlockCols - 1) / BlockCols;
+    }
+
+    //-----------------------------------------------------
+    size_type
+    row_size(size_type blockRow) const noexcept {
+        return size_type(rowbeg_[blockRow+1] - rowbeg_[blockRow]);
+    }
+
+
+    //---------------------------------------------------------------
+    // ITERATORS (over blocks)
+    //---------------------------------------------------------------
+    iterator       begin()        noexcept { return blocks_.begin(); }
+    const_iterator begin()  const noexcept { return blocks_.begin(); }
+    const_iterator cbegin() const noexcept { return blocks_.begin(); }
+    iterator       end()          noexcept { return blocks_.end(); }
+    const_iterator end()    const noexcept { return blocks_.end(); }
+    const_iterator cend()   const noexcept { return blocks_.end(); }
+
+    //-----------------------------------------------------
+    const_iterator
+    begin_row(size_type blockRow) const noexcept {
+        return blocks_.begin() + std::ptrdiff_t(rowbeg_[blockRow]);
+    }
+    const_iterator
+    end_row(size_type blockRow) const noexcept {
+        return blocks_.begin() + std::ptrdiff_t(rowbeg_[blockRow+1]);
+    }
+    //-----------------------------------------------------
+    const col_index_type*
+    begin_col_indices(size_type blockRow) const noexcept {
+        return colidx_.data() + rowbeg_[blockRow];
+    }
+    const col_index_type*
+    end_col_indices(size_type blockRow) const noexcept {
+        return colidx_.data() + rowbeg_[blockRow+1];
+    }
+
+
+    //---------------------------------------------------------------
+    friend void
+    swap(bsr_matrix& a, bsr_matrix& b) noexcept {
+        using std::swap;
+        swap(a.blocks_, b.blocks_);
+        swap(a.colidx_, b.colidx_);
+        swap(a.rowbeg_, b.rowbeg_);
+        swap(a.rows_,   b.rows_);
+        swap(a.cols_,   b.cols_);
+    }
+
+
+private:
+    //---------------------------------------------------------------
+    block_vector blocks_;
+    col_index_vector colidx_;
+    row_offset_vector rowbeg_;
+    size_type rows_ = 0;
+    size_type cols_ = 0;
+};
+
+
+
+/*************************************************************************//***
+ *
+ * @brief fraction of stored values among all values of the tiles that
+ *        a (blockRows x blockCols) blocking of 'm' would have to store;
+ *        values close to 1 indicate a block structure
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO>
+double
+block_fill_ratio(const crs_matrix<T,NA,A,CI,RO>& m,
+                 std::size_t blockRows, std::size_t blockCols)
+{
+    if(m.empty() || blockRows < 1 || blockCols < 1) return 0.0;
+
+    const auto col = m.col_index_data();
+    const auto beg = m.row_offset_data();
+    const auto rows = m.rows();
+
+    std::size_t numBlocks = 0;
+    auto bcols = std::vector<std::size_t>{};
+    for(std::size_t r0 = 0; r0 < rows; r0 += blockRows) {
+        bcols.clear();
+        for(auto r = r0, r1 = std::min(r0 + blockRows, rows); r < r1; ++r) {
+            for(auto i = std::size_t(beg[r]); i < std::size_t(beg[r+1]); ++i) {
+                bcols.push_back(std::size_t(col[i]) / blockCols);
+            }
+        }
+        std::sort(bcols.begin(), bcols.end());
+        numBlocks += std::size_t(
+            std::unique(bcols.begin(), bcols.end()) - bcols.begin());
+    }
+
+    return double(m.size()) / double(numBlocks * blockRows * blockCols);
+}
+
+
+
+namespace bsr_detail {
+
+//-------------------------------------------------------------------
+/// @brief y[r] = alpha * (A*x)[r] + beta * y[r] for all rows
+///        in block rows [first,last);
+///        x is only read up to A.cols() (partial last block column)
+template<class T, std::size_t R, std::size_t C, class A, class CI, class RO>
+void
+spmv_block_rows(const bsr_matrix<T,R,C,A,CI,RO>& m,
+                std::size_t first, std::size_t last,
+                const T* x, T* y, const T& alpha, const T& beta) noexcept
+{
+    const auto blocks = m.data();
+    const auto col = m.col_index_data();
+    const auto beg = m.row_offset_data();
+    const auto rows = m.rows();
+    const auto cols = m.cols();
+    const auto fullBlockCols = cols / C;
+
+    for(auto br = first; br < last; ++br) {
+        T acc[R];
+        for(std::size_t i = 0; i < R; ++i) acc[i] = T(0);
+
+        for(auto k = std::size_t(beg[br]); k < std::size_t(beg[br+1]); ++k) {
+            const T* b  = blocks[k].data();
+            const auto c0 = std::size_t(col[k]) * C;
+            const T* xs = x + c0;
+            if(std::size_t(col[k]) < fullBlockCols) {
+                for(std::size_t i = 0; i < R; ++i) {
+                    for(std::size_t j = 0; j < C; ++j) {
+                        acc[i] += b[i*C + j] * xs[j];
+                    }
+                }
+            }
+            else {
+                //last block column reaches beyond the end of x
+                const auto n = cols - c0;
+                for(std::size_t i = 0; i < R; ++i) {
+                    for(std::size_t j = 0; j < n; ++j) {
+                        acc[i] += b[i*C + j] * xs[j];
+                    }
+                }
+            }
+        }
+
+        const auto r0 = br * R;
+        const auto n = std::min(R, rows - r0);
+        if(beta == T(0)) {
+            for(std::size_t i = 0; i < n; ++i) y[r0+i] = alpha * acc[i];
+        } else {
+            for(std::size_t i = 0; i < n; ++i) y[r0+i] = alpha * acc[i] + beta * y[r0+i];
+        }
+    }
+}
+
+}  // namespace bsr_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief block sparse matrix - dense vector product
+ *        y = alpha * A * x + beta * y
+ *
+ * @param  x           has to hold at least A.cols() values
+ * @param  y           has to hold at least A.rows() values;
+ *                     is not read if beta == 0
+ * @param  numThreads  1 => serial; 0 => hardware concurrency;
+ *                     block rows are distributed so that every thread
+ *                     processes (about) the same number of blocks
+ *
+ * @details the fixed block size lets the compiler unroll and vectorize
+ *          the dense block - vector products
+ *
+ *****************************************************************************/
+template<class T, std::size_t R, std::size_t C, class A, class CI, class RO>
+void
+spmv(const bsr_matrix<T,R,C,A,CI,RO>& m, const T* x, T* y,
+     const T& alpha = T(1), const T& beta = T(0),
+     int numThreads = 1)
+{
+    const auto nbrows = m.block_rows();
+    if(nbrows < 1) return;
+
+    numThreads = effective_thread_count(numThreads);
+
+    if(numThreads < 2) {
+        bsr_detail::spmv_block_rows(m, 0, nbrows, x, y, alpha, beta);
+        return;
+    }
+
+    parallel_for_blocks(
+        weighted_partition(m.row_offset_data(), nbrows, numThreads),
+        [&](std::size_t first, std::size_t last, int) {
+            bsr_detail::spmv_block_rows(m, first, last, x, y, alpha, beta);
+        });
+}
+
+//-------------------------------------------------------------------
+/**
+ * @brief block sparse matrix - dense vector product
+ *        y = alpha * A * x + beta * y;
+ *        y is resized to A.rows() if it is too small
+ */
+template<class T, std::size_t R, std::size_t C, class A, class CI, class RO,
+         class VA>
+void
+spmv(const bsr_matrix<T,R,C,A,CI,RO>& m,
+     const std::vector<T,VA>& x, std::vector<T,VA>& y,
+     const T& alpha = T(1), const T& beta = T(0),
+     int numThreads = 1)
+{
+    if(y.size() < m.rows()) y.resize(m.rows(), T(0));
+    spmv(m, x.data(), y.data(), alpha, beta, numThreads);
+}
+
+
+}  // namespace am
+
+
+#endif
@@ -0,0 +1,401 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_BUFFERED_CRS_MATRIX_H_
+#define AMLIB_CONTAINERS_BUFFERED_CRS_MATRIX_H_
+
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+
+#include "crs_matrix.h"
+
+
+namespace am {
+
+
+/*************************************************************************//***
+ *
+ * @brief compressed row storage sparse matrix with a write buffer
+ *        for write-heavy workloads
+ *
+ * @details Insertions and erasures are recorded in an unsorted delta log
+ *          (one entry per pending (row,col) position) instead of shifting
+ *          the CRS arrays. Lookups consult the delta log first and the
+ *          CRS arrays second. compact() folds the delta into the CRS arrays
+ *          in a single linear merge pass; this happens automatically as
+ *          soon as the delta holds more entries than a configurable
+ *          fraction of the number of stored elements.
+ *
+ *****************************************************************************/
+template<
+    class ValueType,
+    class NAvalue = crs_matrix_static_value<ValueType,0>,
+    class Allocator = std::allocator<ValueType>,
+    class ColIndexType = std::size_t,
+    class RowOffsetType = std::size_t
+>
+class buffered_crs_matrix
+{
+public:
+    //---------------------------------------------------------------
+    // TYPES
+    //---------------------------------------------------------------
+    using matrix_type     = crs_matrix<ValueType,NAvalue,Allocator,
+                                       ColIndexType,RowOffsetType>;
+    using value_type      = ValueType;
+    using size_type       = typename matrix_type::size_type;
+    using col_index_type  = typename matrix_type::col_index_type;
+    using row_offset_type = typename matrix_type::row_offset_type;
+
+
+private:
+    //---------------------------------------------------------------
+    struct delta_entry {
+        size_type row;
+        size_type col;
+        value_type value;
+        bool erased;
+    };
+
+    struct position_hash {
+        std::size_t operator () (const std::pair<size_type,size_type>& p)
+            const noexcept
+        {
+            return std::size_t(p.first * 0x9E3779B97F4A7C15ull) ^
+                   std::size_t(p.second);
+        }
+    };
+
+    using delta_log   = std::vector<delta_entry>;
+    using delta_index = std::unordered_map<
+        std::pair<size_type,size_type>, std::size_t, position_hash>;
+
+
+public:
+    //---------------------------------------------------------------
+    // CONSTRUCTION / DESTRUCTION
+    //---------------------------------------------------------------
+    buffered_crs_matrix():
+        base_{}, log_{}, index_{}
+    {}
+
+    //-----------------------------------------------------
+    /** @brief  takes over the content of a CRS matrix;
+     *          only its declared number of columns is kept, so cols()
+     *          shrinks once the largest column index is erased and compacted
+     */
+    explicit
+    buffered_crs_matrix(matrix_type m):
+        base_(std::move(m)), log_{}, index_{}
+    {
+        size_ = base_.size();
+        declaredCols_ = base_.declared_cols();
+    }
+
+
+    //---------------------------------------------------------------
+    // BUFFER SETTINGS
+    //---------------------------------------------------------------
+    /** @brief  the delta is merged automatically as soon as it holds more
+     *          than max(fraction * size(), min_delta_size()) entries
+     */
+    void
+    max_delta_fraction(double fraction) {
+        maxDeltaFraction_ = (fraction > 0) ? fraction : 0;
+        compact_if_needed();
+    }
+    //-----------------------------------------------------
+    double
+    max_delta_fraction() const noexcept {
+        return maxDeltaFraction_;
+    }
+
+    //-----------------------------------------------------
+    void
+    min_delta_size(size_type n) {
+        minDeltaSize_ = n;
+        compact_if_needed();
+    }
+    //-----------------------------------------------------
+    size_type
+    min_delta_size() const noexcept {
+        return minDeltaSize_;
+    }
+
+    //-----------------------------------------------------
+    /** @return number of pending (not yet merged) updates
+     */
+    size_type
+    delta_size() const noexcept {
+        return log_.size();
+    }
+
+
+    //---------------------------------------------------------------
+    // MODIFY
+    //---------------------------------------------------------------
+    /** @brief  insert/modify value at (row,col)
+     *  @return true, if a new value has been inserted
+     *          false, if a value (that was already present) was modified
+     */
+    bool
+    insert(size_type row, size_type col, const value_type& val)
+    {
+        const bool stored = has(row,col);
+        record(row, col, val, false);
+        if(!stored) ++size_;
+        compact_if_needed();
+        return !stored;
+    }
+
+    //-----------------------------------------------------
+    /** @brief  erase value at (row,col)
+     *  @return true if an element was erased, false otherwise
+     */
+    bool
+    erase(size_type row, size_type col)
+    {
+        if(!has(row,col)) return false;
+        record(row, col, value_type(matrix_type::na_value()), true);
+        --size_;
+        compact_if_needed();
+        return true;
+    }
+
+    //-----------------------------------------------------
+    void
+    clear() {
+        base_.clear();
+        log_.clear();
+        index_.clear();
+        size_ = 0;
+        maxRow_ = 0;
+        maxCol_ = 0;
+        declaredCols_ = 0;
+    }
+
+    //-----------------------------------------------------
+    /** @brief  declares the logical number of columns
+     */
+    void
+    cols(size_type numCols) noexcept {
+        declaredCols_ = numCols;
+        base_.cols(numCols);
+    }
+
+
+    //---------------------------------------------------------------
+    // ELEMENT ACCESS
+    //---------------------------------------------------------------
+    /** @return true, if value at (row,col) is stored, false otherwise
+     */
+    bool
+    has(size_type row, size_type col) const
+    {
+        const auto it = index_.find(std::make_pair(row,col));
+        if(it != index_.end()) return !log_[it->second].erased;
+        return base_.has(row,col);
+    }
+
+    //-----------------------------------------------------
+    /** @return value at (row,col) if stored, n/a-value otherwise
+     */
+    value_type
+    operator () (size_type row, size_type col) const
+    {
+        const auto it = index_.find(std::make_pair(row,col));
+        if(it != index_.end()) {
+            const auto& e = log_[it->second];
+            return e.erased ? matrix_type::na_value() : e.value;
+        }
+        return base_(row,col);
+    }
+    //-----------------------------------------------------
+    /** @brief insert/modify value at (row,col)
+     */
+    void
+    operator () (size_type row, size_type col, const value_type& val)
+    {
+        insert(row, col, val);
+    }
+
+
+    //---------------------------------------------------------------
+    // MERGE
+    //---------------------------------------------------------------
+    /** @brief  folds all pending updates into the CRS arrays
+     *          in one linear merge pass
+     */
+    void
+    compact()
+    {
+        if(log_.empty()) return;
+
+        std::sort(log_.begin(), log_.end(),
+            [](const delta_entry& a, const delta_entry& b) {
+                return (a.row < b.row) || (a.row == b.row && a.col < b.col);
+            });
+
+        const auto rows = std::max(base_.rows(), maxRow_);
+        const auto bval = base_.begin();
+        const auto bcol = base_.col_index_data();
+        const auto bbeg = base_.row_offset_data();
+        const auto brows = base_.rows();
+
+        auto values = typename matrix_type::value_storage{};
+        auto colidx = typename matrix_type::col_index_storage{};
+        auto rowbeg = typename matrix_type::row_offset_storage(rows + 1);
+        values.reserve(size_);
+        colidx.reserve(size_);
+
+        auto d = log_.begin();
+        const auto dend = log_.end();
+
+        for(size_type r = 0; r < rows; ++r) {
+            rowbeg[r] = row_offset_type(values.size());
+
+            auto i = (r < brows) ? size_type(bbeg[r])   : size_type(0);
+            auto e = (r < brows) ? size_type(bbeg[r+1]) : size_type(0);
+
+            while(i < e || (d != dend && d->row == r)) {
+                if(d != dend && d->row == r &&
+                   (i == e || d->col <= size_type(bcol[i])))
+                {
+                    //update replaces stored element
+                    if(i < e && d->col == size_type(bcol[i])) ++i;
+                    if(!d->erased) {
+                        colidx.push_back(col_index_type(d->col));
+                        values.push_back(std::move(d->value));
+                    }
+                    ++d;
+                }
+                else {
+                    colidx.push_back(bcol[i]);
+                    values.push_back(std::move(bval[i]));
+                    ++i;
+                }
+            }
+        }
+        rowbeg[rows] = row_offset_type(values.size());
+
+        base_ = matrix_type{std::move(values), std::move(colidx),
+                            std::move(rowbeg)};
+        base_.cols(declaredCols_);
+
+        log_.clear();
+        index_.clear();
+        maxRow_ = 0;
+        maxCol_ = 0;
+    }
+
+    //-----------------------------------------------------
+    /** @return CRS matrix with all pending updates merged
+     */
+    const matrix_type&
+    compacted() {
+        compact();
+        return base_;
+    }
+
+
+    //---------------------------------------------------------------
+    // SIZE PROPERTIES
+    //---------------------------------------------------------------
+    size_type
+    size() const noexcept {
+        return size_;
+    }
+    //-----------------------------------------------------
+    bool
+    empty() const noexcept {
+        return size_ < 1;
+    }
+    //-----------------------------------------------------
+    size_type
+    rows() const noexcept {
+        return std::max(base_.rows(), maxRow_);
+    }
+    //-----------------------------------------------------
+    /** @return number of columns;
+     *          might be too large until pending erasures of the
+     *          elements with the largest column index are compacted
+     */
+    size_type
+    cols() const noexcept {
+        return std::max(base_.cols(), maxCol_);
+    }
+
+
+    //---------------------------------------------------------------
+    friend void
+    swap(buffered_crs_matrix& a, buffered_crs_matrix& b) noexcept {
+        using std::swap;
+        swap(a.base_, b.base_);
+        swap(a.log_, b.log_);
+        swap(a.index_, b.index_);
+        swap(a.size_, b.size_);
+        swap(a.maxRow_, b.maxRow_);
+        swap(a.maxCol_, b.maxCol_);
+        swap(a.declaredCols_, b.declaredCols_);
+        swap(a.maxDeltaFraction_, b.maxDeltaFraction_);
+        swap(a.minDeltaSize_, b.minDeltaSize_);
+    }
+
+
+private:
+    //---------------------------------------------------------------
+    void
+    record(size_type row, size_type col, const value_type& val, bool erased)
+    {
+        const auto ins = index_.emplace(std::make_pair(row,col), log_.size());
+        if(ins.second) {
+            log_.push_back(delta_entry{row, col, val, erased});
+        } else {
+            auto& e = log_[ins.first->second];
+            e.value = val;
+            e.erased = erased;
+        }
+        if(!erased) {
+            if(row >= maxRow_) maxRow_ = row + 1;
+            if(col >= maxCol_) maxCol_ = col + 1;
+        }
+    }
+
+    //---------------------------------------------------------------
+    void
+    compact_if_needed()
+    {
+        const auto limit = std::max(minDeltaSize_,
+            size_type(maxDeltaFraction_ * double(base_.size())));
+
+        if(log_.size() > limit) compact();
+    }
+
+
+    //---------------------------------------------------------------
+    matrix_type base_;
+    delta_log log_;
+    delta_index index_;
+    size_type size_ = 0;
+    size_type maxRow_ = 0;
+    size_type maxCol_ = 0;
+    size_type declaredCols_ = 0;
+    double maxDeltaFraction_ = 0.1;
+    size_type minDeltaSize_ = 1024;
+};
+
+
+}  // namespace am
+
+
+#endif
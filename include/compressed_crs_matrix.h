@@ -0,0 +1,500 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_COMPRESSED_CRS_MATRIX_H_
+#define AMLIB_CONTAINERS_COMPRESSED_CRS_MATRIX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <memory>
+#include <vector>
+#include <iterator>
+#include <utility>
+
+#include "crs_matrix.h"
+#include "parallel.h"
+
+
+namespace am {
+
+
+namespace crs_detail {
+
+//-------------------------------------------------------------------
+/// @brief appends 'x' as little-endian base-128 varint (7 bits per byte)
+template<class ByteVector>
+inline void
+append_varint(ByteVector& out, std::size_t x)
+{
+    while(x >= 0x80) {
+        out.push_back(std::uint8_t((x & 0x7f) | 0x80));
+        x >>= 7;
+    }
+    out.push_back(std::uint8_t(x));
+}
+
+//-------------------------------------------------------------------
+/// @brief decodes one varint and advances 'p'
+inline std::size_t
+read_varint(const std::uint8_t*& p) noexcept
+{
+    std::size_t b = *p++;
+    //fast path: deltas < 128 (the common case for clustered columns)
+    if(b < 0x80) return b;
+
+    std::size_t x = b & 0x7f;
+    int shift = 7;
+    do {
+        b = *p++;
+        x |= (b & 0x7f) << shift;
+        shift += 7;
+    } while(b >= 0x80);
+    return x;
+}
+
+}  // namespace crs_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief immutable CRS matrix with compressed column indices
+ *
+ * @details Column indices of each row are delta-encoded (first column as is,
+ *          then the gap to the previous column minus 1) and stored as
+ *          variable-length integers (7 bits per byte) in one byte stream.
+ *          Rows with clustered columns need 1 byte per index instead of
+ *          4 or 8. Values are stored uncompressed.
+ *          Elements are accessed through decoding row iterators;
+ *          random access to elements is linear in the row length.
+ *
+ *****************************************************************************/
+template<
+    class ValueType,
+    class NAvalue = crs_matrix_static_value<ValueType,0>,
+    class Allocator = std::allocator<ValueType>,
+    class RowOffsetType = std::size_t
+>
+class compressed_crs_matrix
+{
+    static_assert(std::is_integral<RowOffsetType>::value &&
+                  std::is_unsigned<RowOffsetType>::value,
+                  "row offset type has to be an unsigned integer type");
+
+    template<class T>
+    using rebound_alloc =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+    using value_vector      = std::vector<ValueType,Allocator>;
+    using byte_vector       = std::vector<std::uint8_t,
+                                          rebound_alloc<std::uint8_t>>;
+    using row_offset_vector = std::vector<RowOffsetType,
+                                          rebound_alloc<RowOffsetType>>;
+    using size_vector       = std::vector<std::size_t,
+                                          rebound_alloc<std::size_t>>;
+
+public:
+    //---------------------------------------------------------------
+    // TYPES
+    //---------------------------------------------------------------
+    using value_type      = ValueType;
+    using na_value_type   = NAvalue;
+    using allocator_type  = Allocator;
+    using size_type       = std::size_t;
+    using row_offset_type = RowOffsetType;
+
+
+    /*************************************************************************
+     *
+     * @brief forward iterator that decodes the column indices of one row
+     *
+     *************************************************************************/
+    class const_row_iterator
+    {
+        friend class compressed_crs_matrix;
+
+        const_row_iterator(const std::uint8_t* bytes,
+                           const value_type* val, const value_type* end) noexcept
+        :
+            p_{bytes}, val_{val}, end_{end}, col_{0}
+        {
+            if(val_ != end_) col_ = crs_detail::read_varint(p_);
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = ValueType;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const ValueType*;
+        using reference         = const ValueType&;
+
+        const_row_iterator() noexcept:
+            p_{nullptr}, val_{nullptr}, end_{nullptr}, col_{0}
+        {}
+
+        size_type  col()   const noexcept { return col_; }
+        reference  value() const noexcept { return *val_; }
+        reference  operator * () const noexcept { return *val_; }
+        pointer    operator -> () const noexcept { return val_; }
+
+        const_row_iterator&
+        operator ++ () noexcept {
+            ++val_;
+            if(val_ != end_) col_ += crs_detail::read_varint(p_) + 1;
+            return *this;
+        }
+        const_row_iterator
+        operator ++ (int) noexcept {
+            auto old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator == (const const_row_iterator& o) const noexcept {
+            return val_ == o.val_;
+        }
+        bool operator != (const const_row_iterator& o) const noexcept {
+            return val_ != o.val_;
+        }
+
+    private:
+        const std::uint8_t* p_;
+        const ValueType* val_;
+        const ValueType* end_;
+        size_type col_;
+    };
+
+
+    //---------------------------------------------------------------
+    // CONSTRUCTION / DESTRUCTION
+    //---------------------------------------------------------------
+    compressed_crs_matrix():
+        values_{}, bytes_{}, rowbeg_{0}, rowbyte_{0}
+    {}
+
+    //-----------------------------------------------------
+    template<class NA, class A, class CI, class RO>
+    explicit
+    compressed_crs_matrix(const crs_matrix<value_type,NA,A,CI,RO>& m):
+        compressed_crs_matrix{}
+    {
+        assign(m);
+    }
+
+
+    //---------------------------------------------------------------
+    // ASSIGNMENT
+    //---------------------------------------------------------------
+    template<class NA, class A, class CI, class RO>
+    void
+    assign(const crs_matrix<value_type,NA,A,CI,RO>& m)
+    {
+        const auto nrows = m.rows();
+        const auto nnz = m.size();
+        const auto col = m.col_index_data();
+        const auto beg = m.row_offset_data();
+
+        cols_ = m.cols();
+        srcIndexBytes_ = sizeof(CI);
+
+        values_.assign(m.data(), m.data() + nnz);
+
+        rowbeg_.resize(nrows + 1);
+        rowbyte_.resize(nrows + 1);
+        bytes_.clear();
+        bytes_.reserve(nnz);
+
+        rowbeg_[0] = 0;
+        rowbyte_[0] = 0;
+        for(size_type r = 0; r < nrows; ++r) {
+            auto prev = size_type(-1);
+            for(auto i = size_type(beg[r]); i < size_type(beg[r+1]); ++i) {
+                const auto c = size_type(col[i]);
+                crs_detail::append_varint(bytes_, c - prev - 1);
+                prev = c;
+            }
+            rowbeg_[r+1] = row_offset_type(beg[r+1]);
+            rowbyte_[r+1] = bytes_.size();
+        }
+        bytes_.shrink_to_fit();
+    }
+
+
+    //---------------------------------------------------------------
+    // CONVERSION
+    //---------------------------------------------------------------
+    /**
+     * @brief decompresses into a plain crs_matrix
+     *        (one pass, storage allocated exactly once)
+     * @throws std::out_of_range / std::length_error if the column indices /
+     *         the number of elements don't fit into Matrix' index types
+     */
+    template<class Matrix = crs_matrix<value_type,na_value_type>>
+    Matrix
+    to_crs_matrix(int numThreads = 1) const
+    {
+        using ci_t = typename Matrix::col_index_type;
+        using ro_t = typename Matrix::row_offset_type;
+
+        if(cols_ > 0) Matrix::check_col_index(cols_ - 1);
+        Matrix::check_nnz(size());
+
+        const auto nrows = rows();
+
+        auto values = typename Matrix::value_storage(
+                          values_.begin(), values_.end());
+        auto colidx = typename Matrix::col_index_storage(values_.size());
+        auto rowbeg = typename Matrix::row_offset_storage(nrows + 1);
+
+        for(size_type r = 0; r <= nrows; ++r) rowbeg[r] = ro_t(rowbeg_[r]);
+
+        const auto decode = [&](size_type first, size_type last, int) {
+            for(auto r = first; r < last; ++r) {
+                auto i = size_type(rowbeg_[r]);
+                for(auto it = begin_row(r), e = end_row(r); it != e; ++it, ++i) {
+                    colidx[i] = ci_t(it.col());
+                }
+            }
+        };
+
+        numThreads = effective_thread_count(numThreads);
+        if(numThreads < 2) {
+            decode(0, nrows, 0);
+        } else {
+            parallel_for_blocks(
+                weighted_partition(rowbeg_.data(), nrows, numThreads), decode);
+        }
+
+        auto m = Matrix{std::move(values), std::move(colidx), std::move(rowbeg)};
+        m.cols(cols_);
+        return m;
+    }
+
+
+    //---------------------------------------------------------------
+    // N/A VALUE
+    //---------------------------------------------------------------
+    static constexpr value_type
+    na_value() noexcept {
+        return na_value_type::value();
+    }
+
+
+    //---------------------------------------------------------------
+    // ELEMENT ACCESS
+    //---------------------------------------------------------------
+    /** @return value at (row,col); na_value() if not stored */
+    value_type
+    operator () (size_type row, size_type col) const noexcept
+    {
+        if(row >= rows()) return na_value();
+        for(auto it = begin_row(row), e = end_row(row); it != e; ++it) {
+            if(it.col() == col) return *it;
+            if(it.col() > col) break;
+        }
+        return na_value();
+    }
+
+    //-----------------------------------------------------
+    bool
+    has(size_type row, size_type col) const noexcept
+    {
+        if(row >= rows()) return false;
+        for(auto it = begin_row(row), e = end_row(row); it != e; ++it) {
+            if(it.col() == col) return true;
+            if(it.col() > col) break;
+        }
+        return false;
+    }
+
+
+    //---------------------------------------------------------------
+    // ROW ITERATORS
+    //---------------------------------------------------------------
+    const_row_iterator
+    begin_row(size_type row) const noexcept {
+        return const_row_iterator{bytes_.data() + rowbyte_[row],
+                                  values_.data() + rowbeg_[row],
+                                  values_.data() + rowbeg_[row+1]};
+    }
+    const_row_iterator
+    end_row(size_type row) const noexcept {
+        const auto e = values_.data() + rowbeg_[row+1];
+        return const_row_iterator{nullptr, e, e};
+    }
+
+
+    //---------------------------------------------------------------
+    // DIRECT ACCESS TO COMPRESSED REPRESENTATION
+    //---------------------------------------------------------------
+    const value_type*      data()            const noexcept { return values_.data(); }
+    const row_offset_type* row_offset_data() const noexcept { return rowbeg_.data(); }
+    /// @brief encoded column indices of all rows
+    const std::uint8_t*    index_data()      const noexcept { return bytes_.data(); }
+    /// @brief offsets of rows in index_data(); rows()+1 values
+    const size_type*       index_offset_data() const noexcept { return rowbyte_.data(); }
+
+
+    //---------------------------------------------------------------
+    // SIZE PROPERTIES
+    //---------------------------------------------------------------
+    size_type size()  const noexcept { return values_.size(); }
+    bool      empty() const noexcept { return values_.empty(); }
+    size_type rows()  const noexcept { return rowbeg_.size() - 1; }
+    size_type cols()  const noexcept { return cols_; }
+
+    size_type
+    row_size(size_type row) const noexcept {
+        return size_type(rowbeg_[row+1] - rowbeg_[row]);
+    }
+
+    //-----------------------------------------------------
+    /// @brief bytes of the encoded column indices including row offsets
+    size_type
+    index_bytes() const noexcept {
+        return bytes_.size() + rowbyte_.size() * sizeof(size_type);
+    }
+
+    /// @brief total bytes of all stored arrays
+    size_type
+    memory_bytes() const noexcept {
+        return values_.size() * sizeof(value_type) +
+               rowbeg_.size() * sizeof(row_offset_type) +
+               index_bytes();
+    }
+
+    /**
+     * @brief size of the column indices in the source crs_matrix
+     *        divided by index_bytes(); > 1 => compression saves memory
+     */
+    double
+    compression_ratio() const noexcept {
+        return bytes_.empty() ? 1.0
+             : double(size() * srcIndexBytes_) / double(index_bytes());
+    }
+
+
+    //---------------------------------------------------------------
+    friend void
+    swap(compressed_crs_matrix& a, compressed_crs_matrix& b) noexcept {
+        using std::swap;
+        swap(a.values_,        b.values_);
+        swap(a.bytes_,         b.bytes_);
+        swap(a.rowbeg_,        b.rowbeg_);
+        swap(a.rowbyte_,       b.rowbyte_);
+        swap(a.cols_,          b.cols_);
+        swap(a.srcIndexBytes_, b.srcIndexBytes_);
+    }
+
+
+private:
+    //---------------------------------------------------------------
+    value_vector values_;
+    byte_vector bytes_;
+    row_offset_vector rowbeg_;
+    size_vector rowbyte_;
+    size_type cols_ = 0;
+    size_type srcIndexBytes_ = sizeof(std::size_t);
+};
+
+
+
+namespace crs_detail {
+
+//-------------------------------------------------------------------
+/// @brief y = alpha * A * x + beta * y for all rows in [first,last)
+template<class T, class NA, class A, class RO>
+void
+spmv_compressed_rows(const compressed_crs_matrix<T,NA,A,RO>& m,
+                     std::size_t first, std::size_t last,
+                     const T* x, T* y, const T& alpha, const T& beta) noexcept
+{
+    const auto val = m.data();
+    const auto beg = m.row_offset_data();
+    const auto idx = m.index_data();
+    const auto ibeg = m.index_offset_data();
+
+    for(auto r = first; r < last; ++r) {
+        const std::uint8_t* p = idx + ibeg[r];
+        //first delta is the column itself: -1 + (c + 1) == c
+        auto c = std::size_t(-1);
+        T acc = T(0);
+        for(auto i = std::size_t(beg[r]); i < std::size_t(beg[r+1]); ++i) {
+            c += read_varint(p) + 1;
+            acc += val[i] * x[c];
+        }
+        y[r] = (beta == T(0)) ? alpha * acc : alpha * acc + beta * y[r];
+    }
+}
+
+}  // namespace crs_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief compressed CRS matrix - dense vector product
+ *        y = alpha * A * x + beta * y;
+ *        column indices are decoded on the fly
+ *
+ * @param  x           has to hold at least A.cols() values
+ * @param  y           has to hold at least A.rows() values;
+ *                     is not read if beta == 0
+ * @param  numThreads  1 => serial; 0 => hardware concurrency;
+ *                     rows are distributed so that every thread
+ *                     processes (about) the same number of non-zeros
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class RO>
+void
+spmv(const compressed_crs_matrix<T,NA,A,RO>& m, const T* x, T* y,
+     const T& alpha = T(1), const T& beta = T(0),
+     int numThreads = 1)
+{
+    const auto nrows = m.rows();
+    if(nrows < 1) return;
+
+    numThreads = effective_thread_count(numThreads);
+
+    if(numThreads < 2) {
+        crs_detail::spmv_compressed_rows(m, 0, nrows, x, y, alpha, beta);
+        return;
+    }
+
+    parallel_for_blocks(
+        weighted_partition(m.row_offset_data(), nrows, numThreads),
+        [&](std::size_t first, std::size_t last, int) {
+            crs_detail::spmv_compressed_rows(m, first, last, x, y, alpha, beta);
+        });
+}
+
+//-------------------------------------------------------------------
+/**
+ * @brief compressed CRS matrix - dense vector product
+ *        y = alpha * A * x + beta * y;
+ *        y is resized to A.rows() if it is too small
+ */
+template<class T, class NA, class A, class RO, class VA>
+void
+spmv(const compressed_crs_matrix<T,NA,A,RO>& m,
+     const std::vector<T,VA>& x, std::vector<T,VA>& y,
+     const T& alpha = T(1), const T& beta = T(0),
+     int numThreads = 1)
+{
+    if(y.size() < m.rows()) y.resize(m.rows(), T(0));
+    spmv(m, x.data(), y.data(), alpha, beta, numThreads);
+}
+
+
+}  // namespace am
+
+
+#endif
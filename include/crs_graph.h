@@ -0,0 +1,449 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_CRS_GRAPH_H_
+#define AMLIB_CONTAINERS_CRS_GRAPH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "crs_matrix.h"
+#include "crs_matrix_algorithms.h"
+#include "parallel.h"
+
+
+namespace am {
+
+
+/*************************************************************************//***
+ *
+ * @brief PageRank parameters
+ *
+ *****************************************************************************/
+struct pagerank_settings
+{
+    double damping = 0.85;
+    /// @brief stop as soon as the L1 norm of the rank change drops below
+    double tolerance = 1e-9;
+    std::size_t max_iterations = 100;
+    /// @brief 1 => serial; 0 => hardware concurrency
+    int num_threads = 1;
+};
+
+
+//-------------------------------------------------------------------
+struct pagerank_stats
+{
+    std::size_t iterations = 0;
+    bool converged = false;
+    /// @brief L1 norm of the rank change in the last iteration
+    double residual = 0;
+};
+
+
+
+/*************************************************************************//***
+ *
+ * @brief graph algorithms on the sparsity pattern of a crs_matrix
+ *        (row = vertex, column indices = out-neighbors; values are ignored)
+ *
+ * @details The engine keeps the transposed pattern (in-neighbors) and all
+ *          workspace arrays (BFS queues and frontier bitmaps, PageRank
+ *          vectors), so repeated runs don't reallocate them.
+ *          Parallel steps use the fork-join helpers in parallel.h, which
+ *          start and join threads for every parallel BFS level and for
+ *          each pass of a PageRank iteration; on small graphs this
+ *          overhead can outweigh the gain of using more threads.
+ *          The referenced matrix must outlive the engine.
+ *
+ *          bfs: direction-optimizing breadth-first search;
+ *               top-down steps expand a queue of frontier vertices,
+ *               bottom-up steps let every unvisited vertex look for a
+ *               parent in a frontier bitmap (via its in-neighbors) and
+ *               stop at the first hit;
+ *               switches to bottom-up when the edges leaving the frontier
+ *               exceed 1/alpha of the edges leaving unvisited vertices and
+ *               back to top-down when the frontier holds less than 1/beta
+ *               of all vertices; bottom-up steps run in parallel
+ *
+ *          pagerank: pull-based power iteration; each vertex sums the
+ *               contributions of its in-neighbors, so every thread only
+ *               writes its own block of vertices; the rank mass of vertices
+ *               without out-edges is spread evenly over all vertices
+ *
+ *****************************************************************************/
+template<class Matrix>
+class crs_graph
+{
+public:
+    //---------------------------------------------------------------
+    using matrix_type = Matrix;
+    using size_type   = std::size_t;
+
+    static constexpr size_type unreached = std::numeric_limits<size_type>::max();
+
+
+    //---------------------------------------------------------------
+    /** @brief builds the transposed pattern for in-neighbor access */
+    explicit
+    crs_graph(const matrix_type& a):
+        crs_graph(a, transpose(a))
+    {}
+
+    //-----------------------------------------------------
+    /** @param at  A^T (pass a copy of A if the graph is undirected) */
+    crs_graph(const matrix_type& a, matrix_type at):
+        a_(a), at_(std::move(at)),
+        n_{std::max(a.rows(), a.cols())},
+        parent_(n_, unreached), depth_(n_, unreached),
+        queue_{}, nextQueue_{},
+        frontier_((n_ + 63) / 64, 0), next_((n_ + 63) / 64, 0),
+        rank_{}, nextRank_{}, contrib_{}
+    {
+        queue_.reserve(n_);
+        nextQueue_.reserve(n_);
+    }
+
+
+    //---------------------------------------------------------------
+    size_type vertices() const noexcept { return n_; }
+    size_type edges()    const noexcept { return a_.size(); }
+
+    //-----------------------------------------------------
+    size_type
+    out_degree(size_type v) const noexcept {
+        if(v >= a_.rows()) return 0;
+        const auto beg = a_.row_offset_data();
+        return size_type(beg[v+1] - beg[v]);
+    }
+    //-----------------------------------------------------
+    size_type
+    in_degree(size_type v) const noexcept {
+        if(v >= at_.rows()) return 0;
+        const auto beg = at_.row_offset_data();
+        return size_type(beg[v+1] - beg[v]);
+    }
+
+
+    //---------------------------------------------------------------
+    // BREADTH-FIRST SEARCH
+    //---------------------------------------------------------------
+    void bfs_alpha(double alpha) noexcept { alpha_ = alpha; }
+    double bfs_alpha() const noexcept { return alpha_; }
+
+    void bfs_beta(double beta) noexcept { beta_ = beta; }
+    double bfs_beta() const noexcept { return beta_; }
+
+    //-----------------------------------------------------
+    /**
+     * @brief  breadth-first search from 'source';
+     *         results are available through parent() and depth()
+     * @return number of reached vertices (including the source)
+     */
+    size_type
+    bfs(size_type source, int numThreads = 1)
+    {
+        topDownSteps_ = 0;
+        bottomUpSteps_ = 0;
+        std::fill(parent_.begin(), parent_.end(), unreached);
+        std::fill(depth_.begin(), depth_.end(), unreached);
+        if(source >= n_) return 0;
+
+        numThreads = effective_thread_count(numThreads);
+        //blocks are aligned to bitmap words => no shared words between threads
+        auto bounds = uniform_partition(size_type(0), frontier_.size(), numThreads);
+        for(auto& b : bounds) b = std::min(b * 64, n_);
+        partial_.assign(2 * (bounds.size() - 1), 0);
+
+        parent_[source] = source;
+        depth_[source] = 0;
+        queue_.clear();
+        queue_.push_back(source);
+
+        size_type reached = 1;
+        size_type frontierSize = 1;
+        //edges leaving the frontier / leaving unvisited vertices
+        size_type frontierEdges = out_degree(source);
+        size_type unvisitedEdges = edges() - frontierEdges;
+        bool bottomUp = false;
+
+        for(size_type level = 1; frontierSize > 0; ++level) {
+            if(!bottomUp &&
+               double(frontierEdges) > double(unvisitedEdges) / alpha_)
+            {
+                queue_to_bitmap();
+                bottomUp = true;
+            }
+            else if(bottomUp && double(frontierSize) < double(n_) / beta_) {
+                bitmap_to_queue();
+                bottomUp = false;
+            }
+
+            if(bottomUp) {
+                bottom_up_step(level, bounds);
+                frontierSize = 0;
+                frontierEdges = 0;
+                for(size_type i = 0; i < partial_.size(); i += 2) {
+                    frontierSize  += partial_[i];
+                    frontierEdges += partial_[i+1];
+                }
+                ++bottomUpSteps_;
+            } else {
+                frontierEdges = top_down_step(level);
+                frontierSize = queue_.size();
+                ++topDownSteps_;
+            }
+            reached += frontierSize;
+            unvisitedEdges -= std::min(unvisitedEdges, frontierEdges);
+        }
+        return reached;
+    }
+
+    //-----------------------------------------------------
+    /// @return BFS tree parent of v (source: itself) or 'unreached'
+    size_type parent(size_type v) const noexcept { return parent_[v]; }
+    /// @return BFS level of v (source: 0) or 'unreached'
+    size_type depth(size_type v)  const noexcept { return depth_[v]; }
+
+    const std::vector<size_type>& parents() const noexcept { return parent_; }
+    const std::vector<size_type>& depths()  const noexcept { return depth_; }
+
+    /// @brief number of steps of each kind in the last bfs run
+    size_type bfs_top_down_steps()  const noexcept { return topDownSteps_; }
+    size_type bfs_bottom_up_steps() const noexcept { return bottomUpSteps_; }
+
+
+    //---------------------------------------------------------------
+    // PAGERANK
+    //---------------------------------------------------------------
+    /**
+     * @brief  computes PageRank scores (summing up to 1);
+     *         results are available through ranks()
+     */
+    pagerank_stats
+    pagerank(const pagerank_settings& settings = pagerank_settings{})
+    {
+        pagerank_stats stats;
+        if(n_ < 1) return stats;
+
+        const auto n = n_;
+        const auto d = settings.damping;
+        const auto tbeg = at_.row_offset_data();
+        const auto tcol = at_.col_index_data();
+        const auto inRows = at_.rows();
+
+        rank_.assign(n, 1.0 / double(n));
+        nextRank_.assign(n, 0.0);
+        contrib_.resize(n);
+
+        //vertices are distributed by in-degree (= pull work)
+        auto bounds = std::vector<size_type>{};
+        if(inRows == n) {
+            bounds = weighted_partition(tbeg, n,
+                         effective_thread_count(settings.num_threads));
+        } else {
+            bounds = uniform_partition(size_type(0), n,
+                         effective_thread_count(settings.num_threads));
+        }
+        const auto parts = bounds.size() - 1;
+        //per part: L1 change, rank mass of vertices without out-edges
+        auto partial = std::vector<double>(2 * parts, 0.0);
+
+        double dangling = 0;
+        for(size_type v = 0; v < n; ++v) {
+            const auto deg = out_degree(v);
+            contrib_[v] = deg > 0 ? rank_[v] / double(deg) : 0.0;
+            if(deg < 1) dangling += rank_[v];
+        }
+
+        while(stats.iterations < settings.max_iterations) {
+            const auto base = (1.0 - d + d * dangling) / double(n);
+
+            //pull: new rank of every vertex from the contributions
+            //of its in-neighbors (read across all blocks)
+            parallel_for_blocks(bounds, [&](size_type first, size_type last, int part) {
+                double change = 0;
+                for(size_type v = first; v < last; ++v) {
+                    double sum = 0;
+                    if(v < inRows) {
+                        for(auto j = tbeg[v]; j < tbeg[v+1]; ++j) {
+                            sum += contrib_[size_type(tcol[j])];
+                        }
+                    }
+                    const auto r = base + d * sum;
+                    change += std::abs(r - rank_[v]);
+                    nextRank_[v] = r;
+                }
+                partial[2 * size_type(part)] = change;
+            });
+
+            //contributions for the next iteration; separate pass, because
+            //the pull pass above reads contrib_ of all vertices
+            parallel_for_blocks(bounds, [&](size_type first, size_type last, int part) {
+                double mass = 0;
+                for(size_type v = first; v < last; ++v) {
+                    const auto deg = out_degree(v);
+                    if(deg > 0) {
+                        contrib_[v] = nextRank_[v] / double(deg);
+                    } else {
+                        mass += nextRank_[v];
+                    }
+                }
+                partial[2 * size_type(part) + 1] = mass;
+            });
+
+            stats.residual = 0;
+            dangling = 0;
+            for(size_type i = 0; i < parts; ++i) {
+                stats.residual += partial[2*i];
+                dangling += partial[2*i + 1];
+            }
+            rank_.swap(nextRank_);
+            ++stats.iterations;
+
+            if(stats.residual < settings.tolerance) {
+                stats.converged = true;
+                break;
+            }
+        }
+        return stats;
+    }
+
+    //-----------------------------------------------------
+    const std::vector<double>& ranks() const noexcept { return rank_; }
+
+
+private:
+    //---------------------------------------------------------------
+    static bool
+    test_bit(const std::vector<std::uint64_t>& bits, size_type v) noexcept {
+        return (bits[v / 64] >> (v % 64)) & 1;
+    }
+    static void
+    set_bit(std::vector<std::uint64_t>& bits, size_type v) noexcept {
+        bits[v / 64] |= std::uint64_t(1) << (v % 64);
+    }
+
+    //-----------------------------------------------------
+    void
+    queue_to_bitmap() noexcept {
+        std::fill(frontier_.begin(), frontier_.end(), 0);
+        for(const auto v : queue_) set_bit(frontier_, v);
+    }
+    //-----------------------------------------------------
+    void
+    bitmap_to_queue() noexcept {
+        queue_.clear();
+        for(size_type w = 0; w < frontier_.size(); ++w) {
+            auto bits = frontier_[w];
+            for(size_type b = 0; bits != 0; ++b, bits >>= 1) {
+                if(bits & 1) queue_.push_back(w * 64 + b);
+            }
+        }
+    }
+
+    //---------------------------------------------------------------
+    /// @return number of edges leaving the new frontier
+    size_type
+    top_down_step(size_type level) noexcept
+    {
+        const auto col = a_.col_index_data();
+        const auto beg = a_.row_offset_data();
+        const auto rows = a_.rows();
+
+        size_type edges = 0;
+        nextQueue_.clear();
+        for(const auto u : queue_) {
+            if(u >= rows) continue;
+            for(auto j = beg[u]; j < beg[u+1]; ++j) {
+                const auto v = size_type(col[j]);
+                if(parent_[v] == unreached) {
+                    parent_[v] = u;
+                    depth_[v] = level;
+                    nextQueue_.push_back(v);
+                    edges += out_degree(v);
+                }
+            }
+        }
+        queue_.swap(nextQueue_);
+        return edges;
+    }
+
+    //---------------------------------------------------------------
+    void
+    bottom_up_step(size_type level, const std::vector<size_type>& bounds)
+    {
+        const auto col = at_.col_index_data();
+        const auto beg = at_.row_offset_data();
+        const auto rows = at_.rows();
+
+        parallel_for_blocks(bounds, [&](size_type first, size_type last, int part) {
+            size_type found = 0;
+            size_type edges = 0;
+            std::fill(next_.begin() + std::ptrdiff_t(first / 64),
+                      next_.begin() + std::ptrdiff_t((last + 63) / 64), 0);
+
+            for(size_type v = first; v < std::min(last, rows); ++v) {
+                if(parent_[v] != unreached) continue;
+                for(auto j = beg[v]; j < beg[v+1]; ++j) {
+                    const auto u = size_type(col[j]);
+                    if(test_bit(frontier_, u)) {
+                        parent_[v] = u;
+                        depth_[v] = level;
+                        set_bit(next_, v);
+                        ++found;
+                        edges += out_degree(v);
+                        break;
+                    }
+                }
+            }
+            partial_[2 * size_type(part)] = found;
+            partial_[2 * size_type(part) + 1] = edges;
+        });
+
+        frontier_.swap(next_);
+    }
+
+
+    //---------------------------------------------------------------
+    const matrix_type& a_;
+    matrix_type at_;
+    size_type n_;
+    //BFS
+    std::vector<size_type> parent_;
+    std::vector<size_type> depth_;
+    std::vector<size_type> queue_;
+    std::vector<size_type> nextQueue_;
+    std::vector<std::uint64_t> frontier_;
+    std::vector<std::uint64_t> next_;
+    std::vector<size_type> partial_;
+    double alpha_ = 14;
+    double beta_ = 24;
+    size_type topDownSteps_ = 0;
+    size_type bottomUpSteps_ = 0;
+    //PageRank
+    std::vector<double> rank_;
+    std::vector<double> nextRank_;
+    std::vector<double> contrib_;
+};
+
+template<class Matrix>
+constexpr typename crs_graph<Matrix>::size_type crs_graph<Matrix>::unreached;
+
+
+}  // namespace am
+
+
+#endif
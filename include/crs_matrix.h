@@ -18,6 +18,13 @@
 #include <algorithm>
 #include <numeric>
 #include <utility>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <exception>
+
+#include "parallel.h"
+#include "crs_search.h"
 
 
 namespace am {
@@ -35,30 +42,154 @@ struct crs_matrix_static_value {
 
 
 
+/*************************************************************************//***
+ *
+ * @brief (row, column, value) triplet used for bulk construction
+ *
+ *****************************************************************************/
+template<class ValueType, class Index = std::size_t>
+struct crs_triplet {
+    Index row;
+    Index col;
+    ValueType value;
+};
+
+
+
+/*************************************************************************//***
+ *
+ * @brief combiner for duplicate entries: the value that appears
+ *        later in the input replaces the earlier one (same as insert)
+ *
+ *****************************************************************************/
+struct crs_keep_last {
+    template<class T>
+    const T& operator () (const T&, const T& b) const noexcept { return b; }
+};
+
+
+
+namespace crs_detail {
+
+//-------------------------------------------------------------------
+template<class T>
+inline T
+magnitude(const T& x, std::true_type /*signed*/) {
+    return (x < T(0)) ? T(-x) : x;
+}
+template<class T>
+inline T
+magnitude(const T& x, std::false_type /*signed*/) {
+    return x;
+}
+/// @brief absolute value for signed and floating point types
+template<class T>
+inline T
+magnitude(const T& x) {
+    return magnitude(x, std::integral_constant<bool,
+                        std::is_signed<T>::value ||
+                        std::is_floating_point<T>::value>{});
+}
+
+}  // namespace crs_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief memory footprint and row length distribution of a crs_matrix
+ *
+ * @details row length percentiles use the nearest-rank definition;
+ *          spmv_bytes is the minimum number of bytes a matrix-vector
+ *          product y = A*x has to move: all three CRS arrays, every
+ *          element of x once and every element of y once
+ *
+ *****************************************************************************/
+struct crs_matrix_stats
+{
+    std::size_t rows = 0;
+    std::size_t cols = 0;
+    std::size_t nnz = 0;
+
+    std::size_t value_bytes = 0;
+    std::size_t value_bytes_reserved = 0;
+    std::size_t col_index_bytes = 0;
+    std::size_t col_index_bytes_reserved = 0;
+    std::size_t row_offset_bytes = 0;
+    std::size_t row_offset_bytes_reserved = 0;
+
+    std::size_t empty_rows = 0;
+    std::size_t min_row_length = 0;
+    std::size_t max_row_length = 0;
+    double mean_row_length = 0;
+    std::size_t median_row_length = 0;
+    std::size_t p90_row_length = 0;
+    std::size_t p99_row_length = 0;
+
+    std::size_t spmv_bytes = 0;
+
+    std::size_t bytes_used() const noexcept {
+        return value_bytes + col_index_bytes + row_offset_bytes;
+    }
+    std::size_t bytes_reserved() const noexcept {
+        return value_bytes_reserved + col_index_bytes_reserved +
+               row_offset_bytes_reserved;
+    }
+};
+
+
+
 /*************************************************************************//***
  *
  * @brief compressed row storage sparse matrix
  *
- * @tparam ValueType  content type
- * @tparam NAvalue    determines the (static) value to be returned for
- *                    "empty" elements (usually zero for numeric matrices)
+ * @tparam ValueType     content type
+ * @tparam NAvalue       determines the (static) value to be returned for
+ *                       "empty" elements (usually zero for numeric matrices)
  * @tparam Allocator
+ * @tparam ColIndexType  integer type used for storing column indices
+ *                       (e.g. std::uint32_t to halve index memory)
+ * @tparam RowOffsetType integer type used for storing row offsets;
+ *                       has to be able to represent the number of
+ *                       stored elements
  *
  * @details internal representation of (N x M) matrix:
  *          [value1,            ..., valueM              ] : M
  *          [col_index(value1), ..., col_index(valueM)   ] : M
  *          [start_of_row1, ..., start_of_rowN, #elements] : N+1
  *
+ *          The number of columns is the larger of an (optional) declared
+ *          column count and the column extent of the stored elements.
+ *          The extent is maintained by all modifying operations;
+ *          it is only recomputed (in O(N)) after the element(s) with
+ *          the largest column index were removed.
+ *
  *****************************************************************************/
 template<
     class ValueType,
     class NAvalue = crs_matrix_static_value<ValueType,0>,
-    class Allocator = std::allocator<ValueType>
+    class Allocator = std::allocator<ValueType>,
+    class ColIndexType = std::size_t,
+    class RowOffsetType = std::size_t
 >
 class crs_matrix
 {
-    using value_vector = std::vector<ValueType,Allocator>;
-    using index_vector  = std::vector<typename value_vector::size_type,Allocator>;
+    static_assert(std::is_integral<ColIndexType>::value &&
+                  std::is_unsigned<ColIndexType>::value,
+                  "column index type has to be an unsigned integer type");
+    static_assert(std::is_integral<RowOffsetType>::value &&
+                  std::is_unsigned<RowOffsetType>::value,
+                  "row offset type has to be an unsigned integer type");
+
+    template<class T>
+    using rebound_alloc =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+    using value_vector      = std::vector<ValueType,Allocator>;
+    using col_index_vector  = std::vector<ColIndexType,
+                                          rebound_alloc<ColIndexType>>;
+    using row_offset_vector = std::vector<RowOffsetType,
+                                          rebound_alloc<RowOffsetType>>;
 
 
     //---------------------------------------------------------------
@@ -123,15 +254,202 @@ public:
     using const_pointer   = typename value_vector::const_pointer;
     //-----------------------------------------------------
     using size_type       = typename value_vector::size_type;
+    using col_index_type  = ColIndexType;
+    using row_offset_type = RowOffsetType;
     //-----------------------------------------------------
     using iterator        = typename value_vector::iterator;
     using const_iterator  = typename value_vector::const_iterator;
     //-----------------------------------------------------
-    using index_iterator  = typename index_vector::const_iterator;
+    using col_index_iterator  = typename col_index_vector::const_iterator;
+    using row_offset_iterator = typename row_offset_vector::const_iterator;
+    using index_iterator      = col_index_iterator;
     //-----------------------------------------------------
-    using row_range       = iter_range_t_<iterator,size_type>;
-    using const_row_range = iter_range_t_<const_iterator,size_type>;
-    using index_range     = iter_range_t_<index_iterator,typename index_vector::size_type>;
+    using row_range        = iter_range_t_<iterator,size_type>;
+    using const_row_range  = iter_range_t_<const_iterator,size_type>;
+    using index_range      = iter_range_t_<col_index_iterator,size_type>;
+    using row_offset_range = iter_range_t_<row_offset_iterator,size_type>;
+    //-----------------------------------------------------
+    using value_storage      = value_vector;
+    using col_index_storage  = col_index_vector;
+    using row_offset_storage = row_offset_vector;
+
+
+    //---------------------------------------------------------------
+    /**
+     * @brief (row, column, value) of one stored element
+     */
+    template<class Reference>
+    struct nonzero_t_ {
+        size_type row;
+        size_type col;
+        Reference value;
+    };
+
+
+    //---------------------------------------------------------------
+    /**
+     * @brief iterates over all stored elements of a row range
+     *        and keeps track of their row and column indices;
+     *        O(1) per step (amortized over all rows)
+     */
+    template<class ValuePointer, class Reference>
+    class nonzero_iterator_t_
+    {
+    public:
+        //proxy iterator: dereferencing yields a temporary (row,col,value)
+        //=> can't satisfy the forward iterator reference requirements
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = nonzero_t_<Reference>;
+        using reference         = value_type;
+        using pointer           = void;
+        using difference_type   = std::ptrdiff_t;
+
+        nonzero_iterator_t_() = default;
+
+        explicit
+        nonzero_iterator_t_(const row_offset_type* rowbeg,
+                            const col_index_type* colidx,
+                            ValuePointer values,
+                            size_type pos, size_type row,
+                            size_type lastRow) noexcept
+        :
+            rowbeg_{rowbeg}, colidx_{colidx}, values_{values},
+            pos_{pos}, row_{row}, lastRow_{lastRow}
+        {
+            skip_empty_rows();
+        }
+
+        //---------------------------------------------------------------
+        size_type row()    const noexcept { return row_; }
+        size_type col()    const noexcept { return size_type(colidx_[pos_]); }
+        Reference value()  const noexcept { return values_[pos_]; }
+        /// @brief position in the value array
+        size_type offset() const noexcept { return pos_; }
+
+        value_type operator * () const noexcept {
+            return value_type{row_, col(), values_[pos_]};
+        }
+
+        //---------------------------------------------------------------
+        nonzero_iterator_t_& operator ++ () noexcept {
+            ++pos_;
+            skip_empty_rows();
+            return *this;
+        }
+        nonzero_iterator_t_ operator ++ (int) noexcept {
+            auto old = *this;
+            ++*this;
+            return old;
+        }
+
+        //---------------------------------------------------------------
+        bool operator == (const nonzero_iterator_t_& other) const noexcept {
+            return pos_ == other.pos_;
+        }
+        bool operator != (const nonzero_iterator_t_& other) const noexcept {
+            return pos_ != other.pos_;
+        }
+        difference_type
+        operator - (const nonzero_iterator_t_& other) const noexcept {
+            return difference_type(pos_) - difference_type(other.pos_);
+        }
+
+    private:
+        void skip_empty_rows() noexcept {
+            while(row_ < lastRow_ && size_type(rowbeg_[row_+1]) <= pos_) ++row_;
+        }
+
+        const row_offset_type* rowbeg_ = nullptr;
+        const col_index_type* colidx_ = nullptr;
+        ValuePointer values_ = nullptr;
+        size_type pos_ = 0;
+        size_type row_ = 0;
+        size_type lastRow_ = 0;
+    };
+
+
+    //---------------------------------------------------------------
+    /**
+     * @brief all stored elements of the rows [first,last)
+     */
+    template<class ValuePointer, class Reference>
+    class nonzero_range_t_
+    {
+    public:
+        using iterator  = nonzero_iterator_t_<ValuePointer,Reference>;
+        using size_type = typename crs_matrix::size_type;
+
+        nonzero_range_t_() = default;
+
+        explicit
+        nonzero_range_t_(const row_offset_type* rowbeg,
+                         const col_index_type* colidx,
+                         ValuePointer values,
+                         size_type firstRow, size_type lastRow) noexcept
+        :
+            rowbeg_{rowbeg}, colidx_{colidx}, values_{values},
+            firstRow_{firstRow}, lastRow_{lastRow}
+        {}
+
+        //---------------------------------------------------------------
+        iterator begin() const noexcept {
+            return iterator{rowbeg_, colidx_, values_,
+                            offset(firstRow_), firstRow_, lastRow_};
+        }
+        iterator end() const noexcept {
+            return iterator{rowbeg_, colidx_, values_,
+                            offset(lastRow_), lastRow_, lastRow_};
+        }
+
+        //---------------------------------------------------------------
+        size_type first_row() const noexcept { return firstRow_; }
+        size_type last_row()  const noexcept { return lastRow_; }
+
+        size_type size() const noexcept {
+            return offset(lastRow_) - offset(firstRow_);
+        }
+        bool empty() const noexcept { return size() < 1; }
+
+        //---------------------------------------------------------------
+        /**
+         * @brief splits range at row boundaries into (at most) 'parts'
+         *        sub-ranges with roughly equal numbers of elements
+         */
+        std::vector<nonzero_range_t_>
+        split(int parts) const
+        {
+            auto ranges = std::vector<nonzero_range_t_>{};
+            if(firstRow_ >= lastRow_) return ranges;
+
+            const auto bounds = weighted_partition(
+                rowbeg_ + firstRow_, lastRow_ - firstRow_, parts);
+
+            ranges.reserve(bounds.size() - 1);
+            for(std::size_t i = 0; i + 1 < bounds.size(); ++i) {
+                ranges.emplace_back(rowbeg_, colidx_, values_,
+                                    firstRow_ + bounds[i],
+                                    firstRow_ + bounds[i+1]);
+            }
+            return ranges;
+        }
+
+    private:
+        size_type offset(size_type row) const noexcept {
+            return rowbeg_ ? size_type(rowbeg_[row]) : 0;
+        }
+
+        const row_offset_type* rowbeg_ = nullptr;
+        const col_index_type* colidx_ = nullptr;
+        ValuePointer values_ = nullptr;
+        size_type firstRow_ = 0;
+        size_type lastRow_ = 0;
+    };
+
+    //-----------------------------------------------------
+    using nonzero_range       = nonzero_range_t_<value_type*,reference>;
+    using const_nonzero_range = nonzero_range_t_<const value_type*,const_reference>;
+    using nonzero_iterator       = typename nonzero_range::iterator;
+    using const_nonzero_iterator = typename const_nonzero_range::iterator;
 
 
     //---------------------------------------------------------------
@@ -151,9 +469,11 @@ public:
     crs_matrix(std::initializer_list<value_type> il):
         values_(il),
         colidx_(values_.size()),
-        rowbeg_{0, values_.size()}
+        rowbeg_{row_offset_type(0), row_offset_type(values_.size())}
     {
-        std::iota(colidx_.begin(), colidx_.end(), size_type(0));
+        check_dense_row(values_.size());
+        std::iota(colidx_.begin(), colidx_.end(), col_index_type(0));
+        colExtent_ = values_.size();
     }
 
     //-----------------------------------------------------
@@ -162,9 +482,11 @@ public:
     crs_matrix(const value_vector& v):
         values_(v),
         colidx_(values_.size()),
-        rowbeg_{0, values_.size()}
+        rowbeg_{row_offset_type(0), row_offset_type(values_.size())}
     {
-        std::iota(colidx_.begin(), colidx_.end(), size_type(0));
+        check_dense_row(values_.size());
+        std::iota(colidx_.begin(), colidx_.end(), col_index_type(0));
+        colExtent_ = values_.size();
     }
 
     //-----------------------------------------------------
@@ -173,9 +495,11 @@ public:
     crs_matrix(value_vector&& v):
         values_(std::move(v)),
         colidx_(values_.size()),
-        rowbeg_{0, values_.size()}
+        rowbeg_{row_offset_type(0), row_offset_type(values_.size())}
     {
-        std::iota(colidx_.begin(), colidx_.end(), size_type(0));
+        check_dense_row(values_.size());
+        std::iota(colidx_.begin(), colidx_.end(), col_index_type(0));
+        colExtent_ = values_.size();
     }
 
     //-----------------------------------------------------
@@ -185,9 +509,30 @@ public:
     crs_matrix(InputIterator first, InputEndIterator last):
         values_(first,last),
         colidx_(values_.size()),
-        rowbeg_{0, values_.size()}
+        rowbeg_{row_offset_type(0), row_offset_type(values_.size())}
     {
-        std::iota(colidx_.begin(), colidx_.end(), size_type(0));
+        check_dense_row(values_.size());
+        std::iota(colidx_.begin(), colidx_.end(), col_index_type(0));
+        colExtent_ = values_.size();
+    }
+
+
+    //-----------------------------------------------------
+    /** @brief  constructs matrix from raw CRS arrays (taking ownership)
+     *          'rowbeg' has to hold (rows+1) ascending offsets starting
+     *          with 0 and ending with values.size();
+     *          column indices have to be sorted ascending within each row
+     */
+    crs_matrix(value_storage&& values,
+               col_index_storage&& colidx,
+               row_offset_storage&& rowbeg)
+    :
+        values_(std::move(values)),
+        colidx_(std::move(colidx)),
+        rowbeg_(std::move(rowbeg))
+    {
+        if(rowbeg_.empty()) rowbeg_.push_back(0);
+        update_col_extent();
     }
 
 
@@ -216,6 +561,117 @@ public:
     }
 
 
+    //---------------------------------------------------------------
+    // BULK CONSTRUCTION
+    //---------------------------------------------------------------
+    /**
+     * @brief  builds matrix from an unsorted range of (row,col,value)
+     *         triplets (elements need members 'row', 'col' and 'value')
+     *         in O(nnz log(row length)) without going through insert()
+     *
+     * @param  combine     merges values of duplicate (row,col) entries:
+     *                     stored = combine(stored, later)
+     * @param  numThreads  number of threads used for sorting rows
+     *                     (0 => hardware concurrency)
+     *
+     * @details rows are bucketed by a counting sort, then each row is
+     *          sorted by column index and duplicates are merged;
+     *          duplicates are combined in input order
+     */
+    template<class ForwardIterator, class Combine = crs_keep_last>
+    static crs_matrix
+    from_triplets(ForwardIterator first, ForwardIterator last,
+                  Combine combine = Combine{}, int numThreads = 1)
+    {
+        using entry = std::pair<col_index_type,value_type>;
+
+        //count entries per row
+        size_type nrows = 0;
+        size_type ncols = 0;
+        size_type nnz = 0;
+        for(auto i = first; i != last; ++i, ++nnz) {
+            if(size_type(i->row) >= nrows) nrows = size_type(i->row) + 1;
+            if(size_type(i->col) >= ncols) ncols = size_type(i->col) + 1;
+        }
+        if(nnz < 1) return crs_matrix{};
+        check_col_index(ncols - 1);
+        check_nnz(nnz);
+
+        auto rowbeg = row_offset_vector(nrows + 1, row_offset_type(0));
+        for(auto i = first; i != last; ++i) ++rowbeg[size_type(i->row) + 1];
+        std::partial_sum(rowbeg.begin(), rowbeg.end(), rowbeg.begin());
+
+        //bucket (stable) by row
+        auto entries = std::vector<entry>(nnz);
+        {
+            auto fill = row_offset_vector(rowbeg.begin(), rowbeg.end() - 1);
+            for(auto i = first; i != last; ++i) {
+                auto& e = entries[fill[size_type(i->row)]++];
+                e.first  = col_index_type(i->col);
+                e.second = i->value;
+            }
+        }
+
+        //sort each row by column and merge duplicates in place
+        auto rowlen = std::vector<size_type>(nrows, size_type(0));
+
+        const auto sort_rows = [&](size_type rfirst, size_type rlast, int) {
+            for(size_type r = rfirst; r < rlast; ++r) {
+                const auto b = entries.begin() + rowbeg[r];
+                const auto e = entries.begin() + rowbeg[r+1];
+                if(b == e) continue;
+
+                std::stable_sort(b, e, [](const entry& x, const entry& y) {
+                    return x.first < y.first; });
+
+                auto out = b;
+                for(auto i = b + 1; i != e; ++i) {
+                    if(i->first == out->first) {
+                        out->second = combine(out->second, i->second);
+                    } else {
+                        ++out;
+                        if(out != i) *out = std::move(*i);
+                    }
+                }
+                rowlen[r] = size_type(std::distance(b, out)) + 1;
+            }
+        };
+
+        numThreads = effective_thread_count(numThreads);
+        if(numThreads > 1) {
+            parallel_for_blocks(
+                weighted_partition(rowbeg.data(), nrows, numThreads),
+                sort_rows);
+        } else {
+            sort_rows(0, nrows, 0);
+        }
+
+        //compact into CRS arrays
+        const auto total = std::accumulate(rowlen.begin(), rowlen.end(),
+                                           size_type(0));
+        auto values = value_vector{};
+        auto colidx = col_index_vector{};
+        values.reserve(total);
+        colidx.reserve(total);
+
+        for(size_type r = 0; r < nrows; ++r) {
+            auto i = entries.begin() + rowbeg[r];
+            const auto e = i + rowlen[r];
+            rowbeg[r] = row_offset_type(values.size());
+            for(; i != e; ++i) {
+                colidx.push_back(i->first);
+                values.push_back(std::move(i->second));
+            }
+        }
+        rowbeg[nrows] = row_offset_type(values.size());
+
+        auto m = crs_matrix{std::move(values), std::move(colidx),
+                            std::move(rowbeg)};
+        m.colExtent_ = ncols;
+        return m;
+    }
+
+
     //---------------------------------------------------------------
     // ASSIGNMENT
     //---------------------------------------------------------------
@@ -224,13 +680,18 @@ public:
     template<class InputIterator, class InputEndIterator>
     void assign(InputIterator first, InputEndIterator last)
     {
-        values_.assign(first,last);
+        auto values = value_vector(first,last);
+        check_dense_row(values.size());
+        values_ = std::move(values);
 
         colidx_.resize(values_.size());
-        std::iota(colidx_.begin(), colidx_.end(), size_type(0));
+        std::iota(colidx_.begin(), colidx_.end(), col_index_type(0));
 
         rowbeg_.clear();
-        rowbeg_.push_back(0, values_.size());
+        rowbeg_.push_back(row_offset_type(0));
+        rowbeg_.push_back(row_offset_type(values_.size()));
+
+        colExtent_ = values_.size();
     }
 
     //-----------------------------------------------------
@@ -238,13 +699,17 @@ public:
      */
     void assign(const value_vector& v)
     {
+        check_dense_row(v.size());
         values_ = v;
 
         colidx_.resize(values_.size());
-        std::iota(colidx_.begin(), colidx_.end(), size_type(0));
+        std::iota(colidx_.begin(), colidx_.end(), col_index_type(0));
 
         rowbeg_.clear();
-        rowbeg_.push_back(0, values_.size());
+        rowbeg_.push_back(row_offset_type(0));
+        rowbeg_.push_back(row_offset_type(values_.size()));
+
+        colExtent_ = values_.size();
     }
 
     //-----------------------------------------------------
@@ -252,13 +717,17 @@ public:
      */
     void assign(value_vector&& v)
     {
+        check_dense_row(v.size());
         values_ = std::move(v);
 
         colidx_.resize(values_.size());
-        std::iota(colidx_.begin(), colidx_.end(), size_type(0));
+        std::iota(colidx_.begin(), colidx_.end(), col_index_type(0));
 
         rowbeg_.clear();
-        rowbeg_.push_back(0, values_.size());
+        rowbeg_.push_back(row_offset_type(0));
+        rowbeg_.push_back(row_offset_type(values_.size()));
+
+        colExtent_ = values_.size();
     }
 
 
@@ -279,19 +748,26 @@ public:
     void
     row_sizes(InputIterator first, InputEndIterator last)
     {
-        rowbeg_.clear();
-        rowbeg_.push_back(0);
-        auto ci = colidx_.begin();
+        auto rowbeg = row_offset_vector(1, row_offset_type(0));
         size_type i = *first;
         for(; first != last && i < values_.size(); ) {
-            std::iota(ci, ci + *first, size_type(0));
-            rowbeg_.push_back(i);
-            ci += *first;
+            rowbeg.push_back(row_offset_type(i));
             ++first;
             i += *first;
         }
-        std::iota(ci, colidx_.end(), size_type(0));
-        rowbeg_.push_back(values_.size());
+        rowbeg.push_back(row_offset_type(values_.size()));
+
+        for(size_type r = 1; r < rowbeg.size(); ++r) {
+            check_dense_row(size_type(rowbeg[r] - rowbeg[r-1]));
+        }
+        rowbeg_ = std::move(rowbeg);
+
+        for(size_type r = 1; r < rowbeg_.size(); ++r) {
+            std::iota(colidx_.begin() + rowbeg_[r-1],
+                      colidx_.begin() + rowbeg_[r], col_index_type(0));
+        }
+
+        update_col_extent();
     }
 
 
@@ -325,20 +801,26 @@ public:
         //equal to the number of elements in the row
         using std::distance;
         const auto n = distance(first, last);
-        if(n != row_size(row)) return false;
-        if(n < 0) return true;
+        if(n < 0 || size_type(n) != row_size(row)) return false;
+        if(n < 1) return true;
 
         //the input values have to be sorted in ascending order
-        for(auto i = first, j = i+1; j != last; ++i, ++j) {
-            if(*i >= *j) return false;
+        auto maxCol = first;
+        for(auto j = std::next(first); j != last; ++maxCol, ++j) {
+            if(*maxCol >= *j) return false;
         }
+        check_col_index(size_type(*maxCol));
+
+        const bool shrink = bounds_col_extent(colidx_[rowbeg_[row+1] - 1]);
 
         //copy input values
         for(auto i = colidx_.begin() + rowbeg_[row],
                  e = colidx_.begin() + rowbeg_[row+1]; i != e; ++i, ++first)
         {
-            *i = *first;
+            *i = col_index_type(*first);
         }
+        if(shrink) update_col_extent();
+        note_col(colidx_[rowbeg_[row+1] - 1]);
         return true;
     }
 
@@ -351,11 +833,87 @@ public:
     {
         if(!row_in_range(row) || by == 0) return;
 
+        const bool shrink = by < 0 &&
+                            bounds_col_extent(colidx_[rowbeg_[row+1] - 1]);
+
         for(auto i = colidx_.begin() + rowbeg_[row],
                  e = colidx_.begin() + rowbeg_[row+1]; i != e; ++i)
         {
-            *i += by;
+            *i = col_index_type(std::ptrdiff_t(*i) + by);
+        }
+
+        if(shrink) update_col_extent();
+        if(by > 0) note_col(colidx_[rowbeg_[row+1] - 1]);
+    }
+
+
+    //-----------------------------------------------------
+    /** @brief  reorders rows and columns:
+     *          new(i,j) = old(rowPerm[i], colPerm[j])
+     *
+     * @param   rowPerm  permutation of [0,rows()); rowPerm[i] = old index
+     *                   of new row i
+     * @param   colPerm  permutation of [0,cols()); colPerm[j] = old index
+     *                   of new column j
+     *
+     * @details rebuilds all CRS arrays in one pass over the stored elements;
+     *          only the (short) rows are sorted by their new column indices
+     */
+    template<class RowPermutation, class ColPermutation>
+    void
+    permute(const RowPermutation& rowPerm, const ColPermutation& colPerm)
+    {
+        const auto nrows = rows();
+        const auto ncols = cols();
+
+        //old column => new column
+        auto newCol = std::vector<col_index_type>(ncols);
+        for(size_type j = 0; j < ncols; ++j) {
+            newCol[size_type(colPerm[j])] = col_index_type(j);
+        }
+
+        auto values = value_storage(values_.get_allocator());
+        auto colidx = col_index_storage(colidx_.get_allocator());
+        auto rowbeg = row_offset_storage(rowbeg_.get_allocator());
+        values.reserve(values_.size());
+        colidx.reserve(colidx_.size());
+        rowbeg.reserve(nrows + 1);
+        rowbeg.push_back(row_offset_type(0));
+
+        auto order = std::vector<std::pair<col_index_type,size_type>>{};
+
+        for(size_type i = 0; i < nrows; ++i) {
+            const auto r = size_type(rowPerm[i]);
+            order.clear();
+            for(auto k = size_type(rowbeg_[r]); k < size_type(rowbeg_[r+1]); ++k) {
+                order.emplace_back(newCol[size_type(colidx_[k])], k);
+            }
+            std::sort(order.begin(), order.end());
+            for(const auto& x : order) {
+                colidx.push_back(x.first);
+                values.push_back(std::move(values_[x.second]));
+            }
+            rowbeg.push_back(row_offset_type(values.size()));
         }
+
+        values_.swap(values);
+        colidx_.swap(colidx);
+        rowbeg_.swap(rowbeg);
+
+        declaredCols_ = ncols;
+        update_col_extent();
+    }
+
+    //-----------------------------------------------------
+    /** @brief  reorders rows: new row i = old row rowPerm[i]
+     */
+    template<class RowPermutation>
+    void
+    permute_rows(const RowPermutation& rowPerm)
+    {
+        auto colPerm = std::vector<size_type>(cols());
+        std::iota(colPerm.begin(), colPerm.end(), size_type(0));
+        permute(rowPerm, colPerm);
     }
 
 
@@ -367,7 +925,9 @@ public:
         values_.clear();
         colidx_.clear();
         rowbeg_.erase(rowbeg_.begin()+1, rowbeg_.end());
-        rowbeg_.front() = size_type(0);
+        rowbeg_.front() = row_offset_type(0);
+        declaredCols_ = 0;
+        colExtent_ = 0;
     }
 
     //-----------------------------------------------------
@@ -379,18 +939,22 @@ public:
     erase(const_iterator it)
     {
         using std::distance;
-        const auto c = distance(values_.begin(), it);
+        const auto c = distance(values_.cbegin(), it);
 
+        const bool shrink = bounds_col_extent(colidx_[c]);
         colidx_.erase(colidx_.begin() + c);
 
-        //decrease row begins
-        for(auto p = std::lower_bound(rowbeg_.begin(), rowbeg_.end(), c);
+        //decrease begins of all rows after the erased element
+        for(auto p = std::upper_bound(rowbeg_.begin(), rowbeg_.end(),
+                                      row_offset_type(c));
             p != rowbeg_.end(); ++p)
         {
             --(*p);
         }
 
-        return values_.erase(it);
+        const auto next = values_.erase(it);
+        if(shrink) update_col_extent();
+        return next;
     }
     //-----------------------------------------------------
     /**
@@ -437,6 +1001,11 @@ public:
 
         if(n < 1) return false;
 
+        bool shrink = false;
+        for(auto i = rowbeg_[first]; i < rowbeg_[last] && !shrink; ++i) {
+            shrink = bounds_col_extent(colidx_[i]);
+        }
+
         values_.erase(values_.begin() + rowbeg_[first],
                       values_.begin() + rowbeg_[last]);
 
@@ -446,12 +1015,60 @@ public:
         rowbeg_.erase(rowbeg_.begin() + first, rowbeg_.begin() + last);
 
         for(size_type i = first; i < rowbeg_.size(); ++i) {
-            rowbeg_[i] -= n;
+            rowbeg_[i] = row_offset_type(rowbeg_[i] - n);
         }
 
+        if(shrink) update_col_extent();
         return true;
     }
 
+    //-----------------------------------------------------
+    /**
+     * @brief   erases all elements for which pred(row,col,value) is true
+     *          in one linear compaction pass
+     *
+     * @details numThreads != 1 evaluates the predicate and compacts
+     *          row blocks in parallel (0 => hardware concurrency), then
+     *          closes the gaps between blocks; in this case 'pred' must be
+     *          thread-safe and must not throw;
+     *          if 'pred' throws in the sequential case, all elements it
+     *          hasn't been called for yet are kept, the matrix stays
+     *          consistent and the exception is rethrown;
+     *          value_type only has to be move assignable
+     *
+     * @return  number of erased elements
+     */
+    template<class Predicate>
+    size_type
+    erase_if(Predicate&& pred, int numThreads = 1)
+    {
+        const auto nrows = rows();
+        if(values_.empty() || nrows < 1) return 0;
+
+        numThreads = effective_thread_count(numThreads);
+        const auto removed = (numThreads > 1)
+            ? erase_if_parallel(pred, numThreads)
+            : erase_if_sequential(pred);
+
+        if(removed > 0) update_col_extent();
+        return removed;
+    }
+
+    //-----------------------------------------------------
+    /**
+     * @brief   erases all elements with |value| <= threshold
+     * @return  number of erased elements
+     */
+    size_type
+    prune(const value_type& threshold, int numThreads = 1)
+    {
+        return erase_if(
+            [&threshold](size_type, size_type, const value_type& v) {
+                return !(threshold < crs_detail::magnitude(v));
+            },
+            numThreads);
+    }
+
 
     //---------------------------------------------------------------
     // ASSIGN / INSERT VALUE
@@ -466,14 +1083,18 @@ public:
     std::pair<iterator,bool>
     insert(size_type row, size_type col, const value_type& val)
     {
+        check_col_index(col);
+
         //add row(s) at the end
         if(row + 1 >= rowbeg_.size()) {
+            check_nnz(values_.size() + 1);
+            note_col(col);
             values_.push_back(val);
-            colidx_.push_back(col);
+            colidx_.push_back(col_index_type(col));
             auto add = (row + 2) - rowbeg_.size();
             rowbeg_.reserve(rowbeg_.size() + add);
             rowbeg_.insert(rowbeg_.end(), add-1, rowbeg_.back());
-            rowbeg_.push_back(rowbeg_.back() + 1);
+            rowbeg_.push_back(row_offset_type(rowbeg_.back() + 1));
             return std::pair<iterator,bool>{values_.end()-1,true};
         }
 
@@ -488,14 +1109,16 @@ public:
             return std::pair<iterator,bool>{it,false};
         }
         //new value first in the new row or row empty
-        else if(col < *cb || cb == ce) {
+        else if(cb == ce || col < *cb) {
             it += rowbeg_[row];
-            colidx_.insert(cb, col);
+            check_nnz(values_.size() + 1);
+            colidx_.insert(cb, col_index_type(col));
         }
         //new value last in the row?
         else if(col > *(ce-1)) {
             it += rowbeg_[row+1];
-            colidx_.insert(ce, col);
+            check_nnz(values_.size() + 1);
+            colidx_.insert(ce, col_index_type(col));
         }
         //value within row
         else {
@@ -510,10 +1133,12 @@ public:
                 return std::pair<iterator,bool>{it,false};
             }
             //not found =! insert col index for new value
-            colidx_.insert(cit, col);
+            check_nnz(values_.size() + 1);
+            colidx_.insert(cit, col_index_type(col));
         }
         //insert new value
         it = values_.insert(it, val);
+        note_col(col);
 
         //increase row begin for all rows > row
         for(auto i = rowbeg_.begin() + row + 1; i != rowbeg_.end(); ++i)
@@ -533,14 +1158,18 @@ public:
     std::pair<iterator,bool>
     insert(size_type row, size_type col, value_type&& val)
     {
+        check_col_index(col);
+
         //add row(s) at the end
         if(row + 1 >= rowbeg_.size()) {
+            check_nnz(values_.size() + 1);
+            note_col(col);
             values_.push_back(std::move(val));
-            colidx_.push_back(col);
+            colidx_.push_back(col_index_type(col));
             auto add = (row + 2) - rowbeg_.size();
             rowbeg_.reserve(rowbeg_.size() + add);
             rowbeg_.insert(rowbeg_.end(), add-1, rowbeg_.back());
-            rowbeg_.push_back(rowbeg_.back() + 1);
+            rowbeg_.push_back(row_offset_type(rowbeg_.back() + 1));
             return std::pair<iterator,bool>{values_.end()-1,true};
         }
 
@@ -555,14 +1184,16 @@ public:
             return std::pair<iterator,bool>{it,false};
         }
         //new value first in the new row or row empty
-        else if(col < *cb || cb == ce) {
+        else if(cb == ce || col < *cb) {
             it += rowbeg_[row];
-            colidx_.insert(cb, col);
+            check_nnz(values_.size() + 1);
+            colidx_.insert(cb, col_index_type(col));
         }
         //new value last in the row?
         else if(col > *(ce-1)) {
             it += rowbeg_[row+1];
-            colidx_.insert(ce, col);
+            check_nnz(values_.size() + 1);
+            colidx_.insert(ce, col_index_type(col));
         }
         //value within row
         else {
@@ -577,10 +1208,12 @@ public:
                 return std::pair<iterator,bool>{it,false};
             }
             //not found =! insert col index for new value
-            colidx_.insert(cit, col);
+            check_nnz(values_.size() + 1);
+            colidx_.insert(cit, col_index_type(col));
         }
         //insert new value
         it = values_.insert(it, std::move(val));
+        note_col(col);
 
         //increase row begin for all rows > row
         for(auto i = rowbeg_.begin() + row + 1; i != rowbeg_.end(); ++i)
@@ -591,6 +1224,35 @@ public:
     }
 
 
+    //---------------------------------------------------------------
+    // INDEX TYPE RANGE CHECKS (for bulk builders)
+    //---------------------------------------------------------------
+    /// @brief throws if 'col' can't be represented by col_index_type
+    static void
+    check_col_index(size_type col) {
+        if(col > size_type(std::numeric_limits<col_index_type>::max())) {
+            throw std::out_of_range{"crs_matrix: column index exceeds "
+                                    "range of col_index_type"};
+        }
+    }
+    //-----------------------------------------------------
+    /// @brief throws if 'nnz' elements can't be addressed by row_offset_type
+    static void
+    check_nnz(size_type nnz) {
+        if(nnz > size_type(std::numeric_limits<row_offset_type>::max())) {
+            throw std::length_error{"crs_matrix: number of elements exceeds "
+                                    "range of row_offset_type"};
+        }
+    }
+    //-----------------------------------------------------
+    /// @brief throws if a dense row of 'n' elements can't be represented
+    static void
+    check_dense_row(size_type n) {
+        check_nnz(n);
+        if(n > 0) check_col_index(n - 1);
+    }
+
+
     //---------------------------------------------------------------
     // N/A VALUE
     //---------------------------------------------------------------
@@ -664,11 +1326,11 @@ public:
     data() const noexcept {
         return values_.data();
     }
-    const size_type*
+    const col_index_type*
     col_index_data() const noexcept {
         return colidx_.data();
     }
-    const size_type*
+    const row_offset_type*
     row_offset_data() const noexcept {
         return rowbeg_.data();
     }
@@ -692,22 +1354,22 @@ public:
     //-----------------------------------------------------
     /** @return const iterator to begin of column index storage
      */
-    index_iterator
+    col_index_iterator
     begin_col_indices() const noexcept {
         return colidx_.begin();
     }
     //-----------------------------------------------------
-    index_iterator
+    col_index_iterator
     end_col_indices() const noexcept {
         return colidx_.end();
     }
     //-----------------------------------------------------
-    index_iterator
+    col_index_iterator
     begin_col_indices(size_type row) const noexcept {
         return colidx_.begin() + rowbeg_[row];
     }
     //-----------------------------------------------------
-    index_iterator
+    col_index_iterator
     end_col_indices(size_type row) const noexcept {
         return colidx_.begin() + rowbeg_[row+1];
     }
@@ -723,21 +1385,21 @@ public:
     //-----------------------------------------------------
     /** @return const iterator to begin of row offset storage
      */
-    index_iterator
+    row_offset_iterator
     begin_row_offsets() const noexcept {
         return rowbeg_.begin();
     }
     //-----------------------------------------------------
-    index_iterator
+    row_offset_iterator
     end_row_offsets() const noexcept {
         return rowbeg_.end();
     }
     //-----------------------------------------------------
     /** @return iterator range to row offsets storage
      */
-    index_range
+    row_offset_range
     row_offsets() const noexcept {
-        return index_range{rowbeg_.begin(), rowbeg_.end()};
+        return row_offset_range{rowbeg_.begin(), rowbeg_.end()};
     }
 
 
@@ -747,14 +1409,15 @@ public:
     size_type
     col_index_of(const_iterator it) const noexcept {
         using std::distance;
-        return colidx_[distance(values_.begin(), it)];
+        return size_type(colidx_[distance(values_.begin(), it)]);
     }
     //-----------------------------------------------------
     size_type
     row_index_of(const_iterator it) const noexcept {
         using std::distance;
         const auto c = size_type(distance(values_.begin(), it));
-        const auto p = std::upper_bound(rowbeg_.begin(), rowbeg_.end(), c);
+        const auto p = std::upper_bound(rowbeg_.begin(), rowbeg_.end(),
+                                        row_offset_type(c));
         const auto r = size_type(distance(rowbeg_.begin(), p));
         return (r > 0) ? r-1 : 0;
     }
@@ -763,9 +1426,11 @@ public:
     index_of(const_iterator it) const noexcept {
         using std::distance;
         const auto c = size_type(distance(values_.begin(), it));
-        const auto p = std::upper_bound(rowbeg_.begin(), rowbeg_.end(), c);
+        const auto p = std::upper_bound(rowbeg_.begin(), rowbeg_.end(),
+                                        row_offset_type(c));
         const auto r = size_type(distance(rowbeg_.begin(), p));
-        return std::pair<size_type,size_type>{(r > 0) ? r-1 : 0, colidx_[c]};
+        return std::pair<size_type,size_type>{
+            (r > 0) ? r-1 : 0, size_type(colidx_[c])};
     }
 
 
@@ -799,9 +1464,150 @@ public:
     //-----------------------------------------------------
     size_type
     cols() const noexcept {
-        return empty()
-            ? 0
-            : *std::max_element(colidx_.begin(), colidx_.end()) + 1;
+        return std::max(declaredCols_, col_extent());
+    }
+    //-----------------------------------------------------
+    /** @return number of columns set with cols(numCols);
+     *          0, if no number of columns has been declared
+     */
+    size_type
+    declared_cols() const noexcept {
+        return declaredCols_;
+    }
+    //-----------------------------------------------------
+    /** @return number of columns needed to hold all stored elements
+     */
+    size_type
+    col_extent() const noexcept {
+        return colExtent_;
+    }
+
+
+    //---------------------------------------------------------------
+    // STATISTICS
+    //---------------------------------------------------------------
+    /**
+     * @brief memory footprint and row length distribution
+     *
+     * @param  numThreads  1 => serial; 0 => hardware concurrency
+     *
+     * @details one pass over the row offsets; every thread builds an
+     *          exact histogram of the row lengths < 256 and collects the
+     *          lengths of all longer rows, so all percentiles are exact
+     */
+    crs_matrix_stats
+    stats(int numThreads = 1) const
+    {
+        constexpr size_type histSize = 256;
+
+        struct partial_stats {
+            std::vector<size_type> hist;
+            std::vector<size_type> longRows;
+            size_type empty = 0;
+            size_type minLen = std::numeric_limits<size_type>::max();
+            size_type maxLen = 0;
+        };
+
+        crs_matrix_stats s;
+        s.rows = rows();
+        s.cols = cols();
+        s.nnz  = size();
+
+        s.value_bytes               = values_.size() * sizeof(value_type);
+        s.value_bytes_reserved      = values_.capacity() * sizeof(value_type);
+        s.col_index_bytes           = colidx_.size() * sizeof(col_index_type);
+        s.col_index_bytes_reserved  = colidx_.capacity() * sizeof(col_index_type);
+        s.row_offset_bytes          = rowbeg_.size() * sizeof(row_offset_type);
+        s.row_offset_bytes_reserved = rowbeg_.capacity() * sizeof(row_offset_type);
+
+        s.spmv_bytes = s.bytes_used() + (s.rows + s.cols) * sizeof(value_type);
+
+        if(s.rows < 1) return s;
+
+        const auto bounds = uniform_partition(size_type(0), size_type(s.rows),
+                                              effective_thread_count(numThreads));
+
+        auto parts = std::vector<partial_stats>(bounds.size() - 1);
+        for(auto& p : parts) p.hist.resize(histSize, 0);
+
+        parallel_for_blocks(bounds, [&](size_type first, size_type last, int i) {
+            auto& p = parts[size_type(i)];
+            for(size_type r = first; r < last; ++r) {
+                const auto len = size_type(rowbeg_[r+1] - rowbeg_[r]);
+                if(len < histSize) ++p.hist[len]; else p.longRows.push_back(len);
+                if(len < p.minLen) p.minLen = len;
+                if(len > p.maxLen) p.maxLen = len;
+            }
+            p.empty = p.hist[0];
+        });
+
+        auto hist = std::vector<size_type>(histSize, 0);
+        auto longRows = std::vector<size_type>{};
+        s.min_row_length = std::numeric_limits<std::size_t>::max();
+        for(const auto& p : parts) {
+            for(size_type i = 0; i < histSize; ++i) hist[i] += p.hist[i];
+            longRows.insert(longRows.end(), p.longRows.begin(), p.longRows.end());
+            s.empty_rows += p.empty;
+            s.min_row_length = std::min(s.min_row_length, std::size_t(p.minLen));
+            s.max_row_length = std::max(s.max_row_length, std::size_t(p.maxLen));
+        }
+        s.mean_row_length = double(s.nnz) / double(s.rows);
+
+        //nearest rank: smallest length with at least ceil(q * rows) rows <= it
+        const auto percentile = [&](double q) -> std::size_t {
+            auto rank = size_type(q * double(s.rows));
+            if(double(rank) < q * double(s.rows)) ++rank;
+            if(rank < 1) rank = 1;
+            size_type seen = 0;
+            for(size_type i = 0; i < histSize; ++i) {
+                seen += hist[i];
+                if(seen >= rank) return i;
+            }
+            const auto nth = longRows.begin() + std::ptrdiff_t(rank - seen - 1);
+            std::nth_element(longRows.begin(), nth, longRows.end());
+            return *nth;
+        };
+        s.median_row_length = percentile(0.5);
+        s.p90_row_length    = percentile(0.9);
+        s.p99_row_length    = percentile(0.99);
+
+        return s;
+    }
+
+
+    //---------------------------------------------------------------
+    // SET SIZE
+    //---------------------------------------------------------------
+    /** @brief  declares the logical number of columns;
+     *          cols() will never be smaller than the
+     *          column extent of the stored elements though
+     */
+    void
+    cols(size_type numCols) noexcept {
+        declaredCols_ = numCols;
+    }
+    //-----------------------------------------------------
+    /** @brief  sets the number of rows;
+     *          all elements in rows >= numRows are erased
+     */
+    void
+    rows(size_type numRows)
+    {
+        const auto n = rows();
+        if(numRows > n) {
+            rowbeg_.resize(numRows + 1, rowbeg_.back());
+        }
+        else if(numRows < n) {
+            const auto keep = rowbeg_[numRows];
+            bool shrink = false;
+            for(auto i = keep; i < rowbeg_.back() && !shrink; ++i) {
+                shrink = bounds_col_extent(colidx_[i]);
+            }
+            values_.erase(values_.begin() + keep, values_.end());
+            colidx_.erase(colidx_.begin() + keep, colidx_.end());
+            rowbeg_.resize(numRows + 1);
+            if(shrink) update_col_extent();
+        }
     }
 
 
@@ -810,7 +1616,7 @@ public:
     //---------------------------------------------------------------
     size_type
     row_size(size_type row) const noexcept {
-        return rowbeg_[row+1] - rowbeg_[row];
+        return size_type(rowbeg_[row+1] - rowbeg_[row]);
     }
     //-----------------------------------------------------
     bool
@@ -930,12 +1736,81 @@ public:
     }
 
 
+    //---------------------------------------------------------------
+    // NONZERO ITERATION
+    //---------------------------------------------------------------
+    /** @return range over (row, column, value) of all stored elements
+     *          in the rows [firstRow,lastRow)
+     */
+    nonzero_range
+    nonzeros(size_type firstRow, size_type lastRow) noexcept {
+        clamp_row_range(firstRow, lastRow);
+        return nonzero_range{row_offsets_or_null(), colidx_.data(),
+                             values_.data(), firstRow, lastRow};
+    }
+    //-----------------------------------------------------
+    const_nonzero_range
+    nonzeros(size_type firstRow, size_type lastRow) const noexcept {
+        clamp_row_range(firstRow, lastRow);
+        return const_nonzero_range{row_offsets_or_null(), colidx_.data(),
+                                   values_.data(), firstRow, lastRow};
+    }
+    //-----------------------------------------------------
+    const_nonzero_range
+    cnonzeros(size_type firstRow, size_type lastRow) const noexcept {
+        return nonzeros(firstRow, lastRow);
+    }
+
+    //-----------------------------------------------------
+    /** @return range over (row, column, value) of all stored elements
+     */
+    nonzero_range
+    nonzeros() noexcept {
+        return nonzeros(0, rows());
+    }
+    //-----------------------------------------------------
+    const_nonzero_range
+    nonzeros() const noexcept {
+        return nonzeros(0, rows());
+    }
+    //-----------------------------------------------------
+    const_nonzero_range
+    cnonzeros() const noexcept {
+        return nonzeros(0, rows());
+    }
+
+    //-----------------------------------------------------
+    /** @return iterator to the first stored element in row 'row' or,
+     *          if that row is empty, in one of the following rows
+     */
+    nonzero_iterator
+    begin_nonzeros(size_type row = 0) noexcept {
+        return nonzeros(row, rows()).begin();
+    }
+    const_nonzero_iterator
+    begin_nonzeros(size_type row = 0) const noexcept {
+        return nonzeros(row, rows()).begin();
+    }
+    //-----------------------------------------------------
+    nonzero_iterator
+    end_nonzeros() noexcept {
+        return nonzeros().end();
+    }
+    const_nonzero_iterator
+    end_nonzeros() const noexcept {
+        return nonzeros().end();
+    }
+
+
     //---------------------------------------------------------------
     friend void
     swap(crs_matrix& a, crs_matrix& b) noexcept {
+        using std::swap;
         swap(a.values_, b.values_);
         swap(a.colidx_, b.colidx_);
         swap(a.rowbeg_, b.rowbeg_);
+        swap(a.declaredCols_,   b.declaredCols_);
+        swap(a.colExtent_,      b.colExtent_);
     }
 
 
@@ -997,30 +1872,174 @@ private:
     size_type
     offset(size_type row, size_type col) const noexcept
     {
-        using std::distance;
+        if(!row_in_range(row) ||
+           col > size_type(std::numeric_limits<col_index_type>::max()))
+        {
+            return values_.size();
+        }
 
-        if(!row_in_range(row)) return values_.size();
+        const auto key = col_index_type(col);
+        const auto b = colidx_.data() + rowbeg_[row];
+        const auto e = colidx_.data() + rowbeg_[row+1];
+        const auto it = adaptive_lower_bound(b, e, key);
+
+        return (it != e && *it == key)
+            ? size_type(it - colidx_.data())
+            : values_.size();
+    }
 
-        const auto b = colidx_.begin() + rowbeg_[row];
-        if(col == *b) return rowbeg_[row];
-        if(col < *b)  return values_.size();
 
-        const auto e = colidx_.begin() + rowbeg_[row+1];
+    //---------------------------------------------------------------
+    template<class Predicate>
+    size_type
+    erase_if_sequential(Predicate& pred)
+    {
+        const auto nrows = rows();
+        //after an exception in 'pred' all remaining elements are kept,
+        //so that the compaction can be finished before rethrowing
+        std::exception_ptr error;
+        size_type w = 0;
+        auto rb = size_type(rowbeg_[0]);
+        for(size_type r = 0; r < nrows; ++r) {
+            const auto re = size_type(rowbeg_[r+1]);
+            rowbeg_[r] = row_offset_type(w);
+            for(auto i = rb; i < re; ++i) {
+                bool erase = false;
+                if(!error) {
+                    try {
+                        erase = pred(r, size_type(colidx_[i]), values_[i]);
+                    }
+                    catch(...) {
+                        error = std::current_exception();
+                    }
+                }
+                if(!erase) {
+                    if(w != i) {
+                        values_[w] = std::move(values_[i]);
+                        colidx_[w] = colidx_[i];
+                    }
+                    ++w;
+                }
+            }
+            rb = re;
+        }
+        rowbeg_[nrows] = row_offset_type(w);
 
-        const auto it = std::lower_bound(b, e, col);
-//        const auto it = std::find(b, e, col);
+        const auto removed = values_.size() - w;
+        values_.erase(values_.begin() + w, values_.end());
+        colidx_.erase(colidx_.begin() + w, colidx_.end());
 
-        return (it != e && *it == col)
-            ? rowbeg_[row] + size_type(distance(b,it))
-            : values_.size();
+        if(error) {
+            if(removed > 0) update_col_extent();
+            std::rethrow_exception(error);
+        }
+        return removed;
+    }
+
+    //---------------------------------------------------------------
+    template<class Predicate>
+    size_type
+    erase_if_parallel(Predicate& pred, int numThreads)
+    {
+        const auto nrows = rows();
+        const auto bounds = weighted_partition(rowbeg_.data(), nrows, numThreads);
+
+        //evaluate predicate, count survivors per row and compact them
+        //to the front of each block (in place: blocks don't overlap)
+        auto newbeg = row_offset_storage(nrows + 1, row_offset_type(0),
+                                         rowbeg_.get_allocator());
+
+        parallel_for_blocks(bounds, [&](size_type first, size_type last, int) {
+            auto w = size_type(rowbeg_[first]);
+            for(auto r = first; r < last; ++r) {
+                row_offset_type n = 0;
+                for(auto i = size_type(rowbeg_[r]); i < size_type(rowbeg_[r+1]); ++i) {
+                    if(!pred(r, size_type(colidx_[i]), values_[i])) {
+                        if(w != i) {
+                            values_[w] = std::move(values_[i]);
+                            colidx_[w] = colidx_[i];
+                        }
+                        ++w;
+                        ++n;
+                    }
+                }
+                newbeg[r+1] = n;
+            }
+        });
+
+        std::partial_sum(newbeg.begin(), newbeg.end(), newbeg.begin());
+        const auto survivors = size_type(newbeg[nrows]);
+        const auto removed = values_.size() - survivors;
+        if(removed < 1) return 0;
+
+        //close the gaps between blocks; a block's destination never lies
+        //behind its source => forward moves in block order are safe
+        for(size_type b = 0; b + 1 < bounds.size(); ++b) {
+            const auto src = size_type(rowbeg_[bounds[b]]);
+            const auto dst = size_type(newbeg[bounds[b]]);
+            const auto n = size_type(newbeg[bounds[b+1]]) - dst;
+            if(src != dst && n > 0) {
+                std::move(values_.begin() + src, values_.begin() + src + n,
+                          values_.begin() + dst);
+                std::copy(colidx_.begin() + src, colidx_.begin() + src + n,
+                          colidx_.begin() + dst);
+            }
+        }
+        values_.erase(values_.begin() + survivors, values_.end());
+        colidx_.erase(colidx_.begin() + survivors, colidx_.end());
+        rowbeg_.swap(newbeg);
+        return removed;
+    }
+
+    //---------------------------------------------------------------
+    void
+    clamp_row_range(size_type& firstRow, size_type& lastRow) const noexcept {
+        if(lastRow > rows()) lastRow = rows();
+        if(firstRow > lastRow) firstRow = lastRow;
+    }
+    //-----------------------------------------------------
+    const row_offset_type*
+    row_offsets_or_null() const noexcept {
+        return rowbeg_.empty() ? nullptr : rowbeg_.data();
+    }
+
+
+    //---------------------------------------------------------------
+    /// @brief registers a (new) column index of a stored element
+    void
+    note_col(size_type col) noexcept {
+        if(col >= colExtent_) colExtent_ = col + 1;
+    }
+    //-----------------------------------------------------
+    /// @brief true, if removing an element in column 'col'
+    ///        might reduce the column extent
+    bool
+    bounds_col_extent(size_type col) const noexcept {
+        return col + 1 >= colExtent_;
+    }
+    //-----------------------------------------------------
+    /// @brief recomputes the column extent from the stored elements;
+    ///        column indices are sorted => last element of each row
+    void
+    update_col_extent() noexcept {
+        colExtent_ = 0;
+        for(size_type r = 0, n = rows(); r < n; ++r) {
+            if(rowbeg_[r] < rowbeg_[r+1]) {
+                const auto c = size_type(colidx_[rowbeg_[r+1] - 1]) + 1;
+                if(c > colExtent_) colExtent_ = c;
+            }
+        }
     }
 
 
     //---------------------------------------------------------------
 
     value_vector values_;
-    index_vector colidx_;
-    index_vector rowbeg_;
+    col_index_vector colidx_;
+    row_offset_vector rowbeg_;
+    size_type declaredCols_ = 0;
+    //number of columns needed to hold all stored elements
+    size_type colExtent_ = 0;
 };
 
 
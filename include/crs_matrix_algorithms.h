@@ -0,0 +1,768 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_CRS_MATRIX_ALGORITHMS_H_
+#define AMLIB_CONTAINERS_CRS_MATRIX_ALGORITHMS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <type_traits>
+#include <memory>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#endif
+
+#include "crs_matrix.h"
+#include "parallel.h"
+
+
+namespace am {
+
+namespace crs_detail {
+
+
+/*****************************************************************************
+ *
+ * @brief dot product of one compressed row with a dense vector
+ *
+ *****************************************************************************/
+template<class T, class Index>
+inline T
+sparse_dot(const T* val, const Index* col, std::size_t n, const T* x) noexcept
+{
+    auto sum = T(0);
+    for(std::size_t i = 0; i < n; ++i) {
+        sum += val[i] * x[col[i]];
+    }
+    return sum;
+}
+
+
+#if defined(__AVX2__)
+
+//-------------------------------------------------------------------
+inline double
+sparse_dot(const double* val, const std::uint64_t* col, std::size_t n,
+           const double* x) noexcept
+{
+    std::size_t i = 0;
+    auto acc = _mm256_setzero_pd();
+    for(; i + 4 <= n; i += 4) {
+        const auto idx = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(col + i));
+        const auto xv = _mm256_i64gather_pd(x, idx, 8);
+        acc = _mm256_add_pd(acc,
+                  _mm256_mul_pd(_mm256_loadu_pd(val + i), xv));
+    }
+    alignas(32) double part[4];
+    _mm256_store_pd(part, acc);
+    auto sum = (part[0] + part[1]) + (part[2] + part[3]);
+    for(; i < n; ++i) sum += val[i] * x[col[i]];
+    return sum;
+}
+
+//-------------------------------------------------------------------
+inline float
+sparse_dot(const float* val, const std::uint64_t* col, std::size_t n,
+           const float* x) noexcept
+{
+    std::size_t i = 0;
+    auto acc = _mm_setzero_ps();
+    for(; i + 4 <= n; i += 4) {
+        const auto idx = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(col + i));
+        const auto xv = _mm256_i64gather_ps(x, idx, 4);
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(val + i), xv));
+    }
+    alignas(16) float part[4];
+    _mm_store_ps(part, acc);
+    auto sum = (part[0] + part[1]) + (part[2] + part[3]);
+    for(; i < n; ++i) sum += val[i] * x[col[i]];
+    return sum;
+}
+
+//-------------------------------------------------------------------
+inline double
+sparse_dot(const double* val, const std::uint32_t* col, std::size_t n,
+           const double* x) noexcept
+{
+    std::size_t i = 0;
+    auto acc = _mm256_setzero_pd();
+    for(; i + 4 <= n; i += 4) {
+        //zero-extend to 64 bit => the full unsigned 32 bit range is valid
+        const auto idx = _mm256_cvtepu32_epi64(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(col + i)));
+        const auto xv = _mm256_i64gather_pd(x, idx, 8);
+        acc = _mm256_add_pd(acc,
+                  _mm256_mul_pd(_mm256_loadu_pd(val + i), xv));
+    }
+    alignas(32) double part[4];
+    _mm256_store_pd(part, acc);
+    auto sum = (part[0] + part[1]) + (part[2] + part[3]);
+    for(; i < n; ++i) sum += val[i] * x[col[i]];
+    return sum;
+}
+
+//-------------------------------------------------------------------
+inline float
+sparse_dot(const float* val, const std::uint32_t* col, std::size_t n,
+           const float* x) noexcept
+{
+    std::size_t i = 0;
+    auto acc = _mm_setzero_ps();
+    for(; i + 4 <= n; i += 4) {
+        const auto idx = _mm256_cvtepu32_epi64(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(col + i)));
+        const auto xv = _mm256_i64gather_ps(x, idx, 4);
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(val + i), xv));
+    }
+    alignas(16) float part[4];
+    _mm_store_ps(part, acc);
+    auto sum = (part[0] + part[1]) + (part[2] + part[3]);
+    for(; i < n; ++i) sum += val[i] * x[col[i]];
+    return sum;
+}
+
+#endif
+
+
+//-------------------------------------------------------------------
+/// @brief y[r] = alpha * (A*x)[r] + beta * y[r]  for all r in [first,last)
+template<class T, class NA, class A, class CI, class RO>
+void
+spmv_rows(const crs_matrix<T,NA,A,CI,RO>& m,
+          typename crs_matrix<T,NA,A,CI,RO>::size_type first,
+          typename crs_matrix<T,NA,A,CI,RO>::size_type last,
+          const T* x, T* y, const T& alpha, const T& beta) noexcept
+{
+    const auto val = m.data();
+    const auto col = m.col_index_data();
+    const auto beg = m.row_offset_data();
+
+    if(beta == T(0)) {
+        for(auto r = first; r < last; ++r) {
+            y[r] = alpha * sparse_dot(val + beg[r], col + beg[r],
+                                      std::size_t(beg[r+1] - beg[r]), x);
+        }
+    } else {
+        for(auto r = first; r < last; ++r) {
+            y[r] = alpha * sparse_dot(val + beg[r], col + beg[r],
+                                      std::size_t(beg[r+1] - beg[r]), x)
+                 + beta * y[r];
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------
+/// @brief dense accumulator for one output row of a sparse product;
+///        covers the full column range
+template<class T, class Index>
+class dense_row_accumulator
+{
+public:
+    explicit
+    dense_row_accumulator(std::size_t cols = 0):
+        acc_(cols, T(0)), mark_(cols, false),
+        touched_{}
+    {}
+
+    void add(Index col, const T& v) {
+        if(!mark_[col]) {
+            mark_[col] = true;
+            acc_[col] = v;
+            touched_.push_back(col);
+        } else {
+            acc_[col] += v;
+        }
+    }
+
+    void mark(Index col) {
+        if(!mark_[col]) {
+            mark_[col] = true;
+            touched_.push_back(col);
+        }
+    }
+
+    std::size_t size() const noexcept { return touched_.size(); }
+
+    /// @brief writes sorted (column,value) entries and resets accumulator
+    template<class ColOut, class ValOut>
+    void flush(ColOut cols, ValOut vals) {
+        std::sort(touched_.begin(), touched_.end());
+        for(const auto c : touched_) {
+            *cols = c; ++cols;
+            *vals = std::move(acc_[c]); ++vals;
+            mark_[c] = false;
+        }
+        touched_.clear();
+    }
+
+    void reset() {
+        for(const auto c : touched_) mark_[c] = false;
+        touched_.clear();
+    }
+
+private:
+    std::vector<T> acc_;
+    std::vector<bool> mark_;
+    std::vector<Index> touched_;
+};
+
+
+
+//-------------------------------------------------------------------
+/// @brief open addressing hash accumulator for one output row of a
+///        sparse product; for rows that touch few columns of a wide matrix
+template<class T, class Index>
+class hash_row_accumulator
+{
+public:
+    hash_row_accumulator():
+        keys_(), vals_(), occupied_(), used_(), mask_(0)
+    {}
+
+    /// @brief prepares table for (at most) n distinct keys
+    void prepare(std::size_t n) {
+        std::size_t cap = 16;
+        while(cap < 2*n) cap *= 2;
+        if(cap > keys_.size()) {
+            keys_.resize(cap);
+            vals_.resize(cap);
+            occupied_.assign(cap, false);
+        }
+        mask_ = keys_.size() - 1;
+    }
+
+    void add(Index col, const T& v) {
+        const auto slot = find_slot(col);
+        if(!occupied_[slot]) {
+            occupied_[slot] = true;
+            keys_[slot] = col;
+            vals_[slot] = v;
+            used_.push_back(slot);
+        } else {
+            vals_[slot] += v;
+        }
+    }
+
+    void mark(Index col) {
+        const auto slot = find_slot(col);
+        if(!occupied_[slot]) {
+            occupied_[slot] = true;
+            keys_[slot] = col;
+            used_.push_back(slot);
+        }
+    }
+
+    std::size_t size() const noexcept { return used_.size(); }
+
+    /// @brief writes sorted (column,value) entries and resets accumulator
+    template<class ColOut, class ValOut>
+    void flush(ColOut cols, ValOut vals) {
+        std::sort(used_.begin(), used_.end(),
+            [this](std::size_t a, std::size_t b) {
+                return keys_[a] < keys_[b];
+            });
+        for(const auto s : used_) {
+            *cols = keys_[s]; ++cols;
+            *vals = std::move(vals_[s]); ++vals;
+            occupied_[s] = false;
+        }
+        used_.clear();
+    }
+
+    void reset() {
+        for(const auto s : used_) occupied_[s] = false;
+        used_.clear();
+    }
+
+private:
+    std::size_t find_slot(Index col) const noexcept {
+        auto slot = std::size_t(
+            (std::uint64_t(col) * 0x9E3779B97F4A7C15ull) >> 7) & mask_;
+        while(occupied_[slot] && keys_[slot] != col) {
+            slot = (slot + 1) & mask_;
+        }
+        return slot;
+    }
+
+    //occupancy is kept separately: every Index value is a valid column
+    std::vector<Index> keys_;
+    std::vector<T> vals_;
+    std::vector<bool> occupied_;
+    std::vector<std::size_t> used_;
+    std::size_t mask_;
+};
+
+
+
+//-------------------------------------------------------------------
+/// @brief use a hash accumulator if a row touches only a small
+///        fraction of all columns
+template<class Index>
+inline bool
+use_hash_accumulator(Index flops, Index cols) noexcept
+{
+    return (flops * 16) < cols;
+}
+
+
+
+//-------------------------------------------------------------------
+/// @brief number of entries of the merge of two sorted index lists
+///        (union or intersection of both patterns)
+template<bool intersect, class Index>
+std::size_t
+merged_row_size(const Index* a, const Index* aend,
+                const Index* b, const Index* bend) noexcept
+{
+    std::size_t common = 0;
+    const auto na = std::size_t(aend - a);
+    const auto nb = std::size_t(bend - b);
+    while(a != aend && b != bend) {
+        if(*a < *b)      { ++a; }
+        else if(*b < *a) { ++b; }
+        else             { ++a; ++b; ++common; }
+    }
+    return intersect ? common : (na + nb - common);
+}
+
+
+//-------------------------------------------------------------------
+/// @brief two-pointer merge of two sorted rows;
+///        entries missing from one row are read as 'na'
+template<bool intersect, class T, class Index, class Op>
+void
+merge_row(const Index* acol, const Index* aend, const T* aval,
+          const Index* bcol, const Index* bend, const T* bval,
+          const T& na, Op& op, Index* cout, T* vout)
+{
+    while(acol != aend && bcol != bend) {
+        if(*acol < *bcol) {
+            if(!intersect) { *cout++ = *acol; *vout++ = op(*aval, na); }
+            ++acol; ++aval;
+        }
+        else if(*bcol < *acol) {
+            if(!intersect) { *cout++ = *bcol; *vout++ = op(na, *bval); }
+            ++bcol; ++bval;
+        }
+        else {
+            *cout++ = *acol; *vout++ = op(*aval, *bval);
+            ++acol; ++aval; ++bcol; ++bval;
+        }
+    }
+    if(intersect) return;
+    for(; acol != aend; ++acol, ++aval) { *cout++ = *acol; *vout++ = op(*aval, na); }
+    for(; bcol != bend; ++bcol, ++bval) { *cout++ = *bcol; *vout++ = op(na, *bval); }
+}
+
+
+//-------------------------------------------------------------------
+/// @brief elementwise combination of two matrices;
+///        a count pass determines the exact size of every output row,
+///        so the result is allocated only once
+template<bool intersect, class T, class NA, class A, class CI, class RO, class Op>
+crs_matrix<T,NA,A,CI,RO>
+merge(const crs_matrix<T,NA,A,CI,RO>& a, const crs_matrix<T,NA,A,CI,RO>& b,
+      Op op, int numThreads)
+{
+    using matrix_t  = crs_matrix<T,NA,A,CI,RO>;
+    using size_type = typename matrix_t::size_type;
+
+    const size_type rows = std::max(a.rows(), b.rows());
+    const size_type cols = std::max(a.cols(), b.cols());
+    if(rows < 1) return matrix_t{};
+
+    const auto arows = a.rows();
+    const auto brows = b.rows();
+    const auto aval = a.data();
+    const auto acol = a.col_index_data();
+    const auto abeg = a.row_offset_data();
+    const auto bval = b.data();
+    const auto bcol = b.col_index_data();
+    const auto bbeg = b.row_offset_data();
+
+    //row r of a: [acol + abeg[r], acol + aend(r))
+    const auto abegin = [&](size_type r) { return r < arows ? abeg[r] : RO(0); };
+    const auto aend   = [&](size_type r) { return r < arows ? abeg[r+1] : RO(0); };
+    const auto bbegin = [&](size_type r) { return r < brows ? bbeg[r] : RO(0); };
+    const auto bend   = [&](size_type r) { return r < brows ? bbeg[r+1] : RO(0); };
+
+    //balance threads by the combined number of input entries per row
+    auto work = std::vector<size_type>(rows + 1, size_type(0));
+    for(size_type r = 0; r < rows; ++r) {
+        work[r+1] = work[r] + size_type(aend(r) - abegin(r))
+                            + size_type(bend(r) - bbegin(r));
+    }
+    numThreads = effective_thread_count(numThreads);
+    const auto bounds = weighted_partition(work.data(), rows, numThreads);
+
+    //count pass
+    auto rowbeg = typename matrix_t::row_offset_storage(rows + 1, RO(0));
+
+    parallel_for_blocks(bounds, [&](size_type first, size_type last, int) {
+        for(size_type r = first; r < last; ++r) {
+            rowbeg[r+1] = RO(merged_row_size<intersect>(
+                acol + abegin(r), acol + aend(r),
+                bcol + bbegin(r), bcol + bend(r)));
+        }
+    });
+
+    std::partial_sum(rowbeg.begin(), rowbeg.end(), rowbeg.begin());
+
+    //merge pass
+    const auto nnz = size_type(rowbeg[rows]);
+    auto values = typename matrix_t::value_storage(nnz);
+    auto colidx = typename matrix_t::col_index_storage(nnz);
+    const auto na = matrix_t::na_value();
+
+    parallel_for_blocks(bounds, [&](size_type first, size_type last, int) {
+        auto rowOp = op;
+        for(size_type r = first; r < last; ++r) {
+            merge_row<intersect>(
+                acol + abegin(r), acol + aend(r), aval + abegin(r),
+                bcol + bbegin(r), bcol + bend(r), bval + bbegin(r),
+                na, rowOp, colidx.data() + rowbeg[r], values.data() + rowbeg[r]);
+        }
+    });
+
+    auto c = matrix_t{std::move(values), std::move(colidx), std::move(rowbeg)};
+    c.cols(cols);
+    return c;
+}
+
+
+}  // namespace crs_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief sparse matrix - dense vector product  y = alpha * A * x + beta * y
+ *
+ * @param  x           has to hold at least A.cols() values
+ * @param  y           has to hold at least A.rows() values;
+ *                     is not read if beta == 0
+ * @param  numThreads  1 => serial; 0 => hardware concurrency;
+ *                     rows are distributed so that every thread
+ *                     processes (about) the same number of non-zeros
+ *
+ * @details the n/a value of the matrix is treated as zero
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO>
+void
+spmv(const crs_matrix<T,NA,A,CI,RO>& m, const T* x, T* y,
+     const T& alpha = T(1), const T& beta = T(0),
+     int numThreads = 1)
+{
+    using size_type = typename crs_matrix<T,NA,A,CI,RO>::size_type;
+
+    const size_type rows = m.rows();
+    if(rows < 1) return;
+
+    numThreads = effective_thread_count(numThreads);
+
+    if(numThreads < 2) {
+        crs_detail::spmv_rows(m, 0, rows, x, y, alpha, beta);
+        return;
+    }
+
+    parallel_for_blocks(
+        weighted_partition(m.row_offset_data(), rows, numThreads),
+        [&](size_type first, size_type last, int) {
+            crs_detail::spmv_rows(m, first, last, x, y, alpha, beta);
+        });
+}
+
+//-------------------------------------------------------------------
+/**
+ * @brief sparse matrix - dense vector product  y = alpha * A * x + beta * y
+ *        y is resized to A.rows() if it is too small
+ */
+template<class T, class NA, class A, class CI, class RO, class VA>
+void
+spmv(const crs_matrix<T,NA,A,CI,RO>& m,
+     const std::vector<T,VA>& x, std::vector<T,VA>& y,
+     const T& alpha = T(1), const T& beta = T(0),
+     int numThreads = 1)
+{
+    if(y.size() < m.rows()) y.resize(m.rows(), T(0));
+    spmv(m, x.data(), y.data(), alpha, beta, numThreads);
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief sparse matrix - sparse matrix product  C = A * B
+ *
+ * @param  numThreads  1 => serial; 0 => hardware concurrency
+ *
+ * @details row-by-row (Gustavson) product:
+ *          a symbolic pass computes the exact size of each row of C,
+ *          a numeric pass accumulates each row in either a dense or a
+ *          hash-based accumulator (chosen per row based on the number of
+ *          multiply-adds of that row) and writes it directly into the
+ *          CRS arrays of C;
+ *          rows are distributed between threads by their multiply-add count;
+ *          the n/a value is treated as zero
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO>
+crs_matrix<T,NA,A,CI,RO>
+spgemm(const crs_matrix<T,NA,A,CI,RO>& a, const crs_matrix<T,NA,A,CI,RO>& b,
+       int numThreads = 1)
+{
+    using matrix_t  = crs_matrix<T,NA,A,CI,RO>;
+    using size_type = typename matrix_t::size_type;
+    using col_t     = typename matrix_t::col_index_type;
+    using offset_t  = typename matrix_t::row_offset_type;
+    using dense_acc = crs_detail::dense_row_accumulator<T,col_t>;
+    using hash_acc  = crs_detail::hash_row_accumulator<T,col_t>;
+
+    const size_type rows  = a.rows();
+    const size_type brows = b.rows();
+    const size_type cols  = b.cols();
+
+    if(rows < 1 || cols < 1 || a.empty()) {
+        auto c = matrix_t{};
+        c.rows(rows);
+        c.cols(cols);
+        return c;
+    }
+
+    const auto aval = a.data();
+    const auto acol = a.col_index_data();
+    const auto abeg = a.row_offset_data();
+    const auto bval = b.data();
+    const auto bcol = b.col_index_data();
+    const auto bbeg = b.row_offset_data();
+
+    //upper bound of each row's length = number of multiply-adds
+    auto flops = std::vector<size_type>(rows + 1, size_type(0));
+    for(size_type r = 0; r < rows; ++r) {
+        size_type f = 0;
+        for(auto j = abeg[r]; j < abeg[r+1]; ++j) {
+            const auto k = acol[j];
+            if(k < brows) f += bbeg[k+1] - bbeg[k];
+        }
+        flops[r+1] = flops[r] + f;
+    }
+
+    numThreads = effective_thread_count(numThreads);
+    const auto bounds = weighted_partition(flops.data(), rows, numThreads);
+
+    //one accumulator set per thread (dense ones are created on demand)
+    const auto parts = bounds.size() - 1;
+    auto dense = std::vector<std::unique_ptr<dense_acc>>(parts);
+    auto hash  = std::vector<hash_acc>(parts);
+
+    const auto dense_for = [&](int part) -> dense_acc& {
+        auto& p = dense[std::size_t(part)];
+        if(!p) p.reset(new dense_acc(cols));
+        return *p;
+    };
+
+    //applies op(accumulator, A index, B index) to all products of row r
+    const auto scan_row = [&](size_type r, auto& acc, auto&& op) {
+        for(auto j = abeg[r]; j < abeg[r+1]; ++j) {
+            const auto k = acol[j];
+            if(k >= brows) continue;
+            for(auto l = bbeg[k]; l < bbeg[k+1]; ++l) op(acc, j, l);
+        }
+    };
+
+    const auto mark = [&](auto& acc, size_type, size_type l) {
+        acc.mark(bcol[l]);
+    };
+    const auto add = [&](auto& acc, size_type j, size_type l) {
+        acc.add(bcol[l], aval[j] * bval[l]);
+    };
+
+    //symbolic pass: exact row sizes
+    //(summed up in size_type: the total might not fit offset_t)
+    auto rowlen = std::vector<size_type>(rows + 1, size_type(0));
+
+    parallel_for_blocks(bounds, [&](size_type first, size_type last, int part) {
+        for(size_type r = first; r < last; ++r) {
+            const auto f = flops[r+1] - flops[r];
+            if(crs_detail::use_hash_accumulator(f, cols)) {
+                auto& acc = hash[std::size_t(part)];
+                acc.prepare(f);
+                scan_row(r, acc, mark);
+                rowlen[r+1] = acc.size();
+                acc.reset();
+            } else {
+                auto& acc = dense_for(part);
+                scan_row(r, acc, mark);
+                rowlen[r+1] = acc.size();
+                acc.reset();
+            }
+        }
+    });
+
+    std::partial_sum(rowlen.begin(), rowlen.end(), rowlen.begin());
+    matrix_t::check_nnz(rowlen[rows]);
+
+    auto rowbeg = typename matrix_t::row_offset_storage(rows + 1);
+    for(size_type r = 0; r <= rows; ++r) rowbeg[r] = offset_t(rowlen[r]);
+
+    //numeric pass
+    const auto nnz = rowbeg[rows];
+    auto values = typename matrix_t::value_storage(nnz);
+    auto colidx = typename matrix_t::col_index_storage(nnz);
+
+    parallel_for_blocks(bounds, [&](size_type first, size_type last, int part) {
+        for(size_type r = first; r < last; ++r) {
+            const auto f = flops[r+1] - flops[r];
+            const auto cout = colidx.begin() + rowbeg[r];
+            const auto vout = values.begin() + rowbeg[r];
+            if(crs_detail::use_hash_accumulator(f, cols)) {
+                auto& acc = hash[std::size_t(part)];
+                acc.prepare(f);
+                scan_row(r, acc, add);
+                acc.flush(cout, vout);
+            } else {
+                auto& acc = dense_for(part);
+                scan_row(r, acc, add);
+                acc.flush(cout, vout);
+            }
+        }
+    });
+
+    auto c = matrix_t{std::move(values), std::move(colidx), std::move(rowbeg)};
+    c.cols(cols);
+    return c;
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief transposed matrix A^T
+ *
+ * @details counting sort by column in O(rows + cols + nnz);
+ *          rows of A are visited in ascending order, so the column indices
+ *          within every row of A^T are sorted without extra work
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO>
+crs_matrix<T,NA,A,CI,RO>
+transpose(const crs_matrix<T,NA,A,CI,RO>& m)
+{
+    using matrix_t  = crs_matrix<T,NA,A,CI,RO>;
+    using size_type = typename matrix_t::size_type;
+
+    const size_type rows = m.rows();
+    const size_type cols = m.cols();
+    const size_type nnz  = m.size();
+
+    const auto val = m.data();
+    const auto col = m.col_index_data();
+    const auto beg = m.row_offset_data();
+
+    auto rowbeg = typename matrix_t::row_offset_storage(cols + 1, RO(0));
+    for(size_type i = 0; i < nnz; ++i) ++rowbeg[size_type(col[i]) + 1];
+    std::partial_sum(rowbeg.begin(), rowbeg.end(), rowbeg.begin());
+
+    auto values = typename matrix_t::value_storage(nnz);
+    auto colidx = typename matrix_t::col_index_storage(nnz);
+    auto pos = std::vector<size_type>(rowbeg.begin(), rowbeg.end() - 1);
+
+    for(size_type r = 0; r < rows; ++r) {
+        for(auto i = size_type(beg[r]); i < size_type(beg[r+1]); ++i) {
+            const auto o = pos[size_type(col[i])]++;
+            values[o] = val[i];
+            colidx[o] = CI(r);
+        }
+    }
+
+    auto t = matrix_t{std::move(values), std::move(colidx), std::move(rowbeg)};
+    t.cols(rows);
+    return t;
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief elementwise combination  C(r,c) = op(A(r,c), B(r,c))
+ *        for all (r,c) that are present in A or in B
+ *
+ * @param  op          binary function (value, value) -> value;
+ *                     entries missing from one of the operands are
+ *                     passed as the n/a value; every thread gets its own copy
+ * @param  numThreads  1 => serial; 0 => hardware concurrency
+ *
+ * @details two-pointer merge of the sorted column indices of each row
+ *          in O(rows + nnz(A) + nnz(B)); the result has the larger of
+ *          both shapes
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO, class Op>
+crs_matrix<T,NA,A,CI,RO>
+merge(const crs_matrix<T,NA,A,CI,RO>& a, const crs_matrix<T,NA,A,CI,RO>& b,
+      Op op, int numThreads = 1)
+{
+    return crs_detail::merge<false>(a, b, std::move(op), numThreads);
+}
+
+
+//-------------------------------------------------------------------
+/// @brief  C = A + B
+template<class T, class NA, class A, class CI, class RO>
+crs_matrix<T,NA,A,CI,RO>
+elementwise_add(const crs_matrix<T,NA,A,CI,RO>& a,
+                const crs_matrix<T,NA,A,CI,RO>& b,
+                int numThreads = 1)
+{
+    return crs_detail::merge<false>(a, b,
+        [](const T& x, const T& y) { return T(x + y); }, numThreads);
+}
+
+
+//-------------------------------------------------------------------
+/// @brief  C = A - B
+template<class T, class NA, class A, class CI, class RO>
+crs_matrix<T,NA,A,CI,RO>
+elementwise_subtract(const crs_matrix<T,NA,A,CI,RO>& a,
+                     const crs_matrix<T,NA,A,CI,RO>& b,
+                     int numThreads = 1)
+{
+    return crs_detail::merge<false>(a, b,
+        [](const T& x, const T& y) { return T(x - y); }, numThreads);
+}
+
+
+//-------------------------------------------------------------------
+/// @brief  C = A .* B (Hadamard product);
+///         only entries present in both A and B are stored
+template<class T, class NA, class A, class CI, class RO>
+crs_matrix<T,NA,A,CI,RO>
+elementwise_multiply(const crs_matrix<T,NA,A,CI,RO>& a,
+                     const crs_matrix<T,NA,A,CI,RO>& b,
+                     int numThreads = 1)
+{
+    return crs_detail::merge<true>(a, b,
+        [](const T& x, const T& y) { return T(x * y); }, numThreads);
+}
+
+
+}  // namespace am
+
+
+#endif
@@ -0,0 +1,287 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_CRS_MATRIX_DENSE_H_
+#define AMLIB_CONTAINERS_CRS_MATRIX_DENSE_H_
+
+#include <cstddef>
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "crs_matrix.h"
+#include "dynamic_matrix.h"
+#include "parallel.h"
+
+
+namespace am {
+
+
+namespace crs_detail {
+
+//-------------------------------------------------------------------
+/// @brief C[r,:] = alpha * A[r,:] * B + beta * C[r,:]  for r in [first,last)
+///        B and C are row-major with 'k' columns
+template<class T, class NA, class A, class CI, class RO>
+void
+spmm_rows(const crs_matrix<T,NA,A,CI,RO>& a,
+          std::size_t first, std::size_t last,
+          const T* b, T* c, std::size_t k,
+          const T& alpha, const T& beta) noexcept
+{
+    const auto val = a.data();
+    const auto col = a.col_index_data();
+    const auto beg = a.row_offset_data();
+
+    for(auto r = first; r < last; ++r) {
+        T* crow = c + r*k;
+        if(beta == T(0)) {
+            std::fill(crow, crow + k, T(0));
+        } else if(beta != T(1)) {
+            for(std::size_t j = 0; j < k; ++j) crow[j] *= beta;
+        }
+        //each stored element scales one contiguous row of B
+        for(auto i = std::size_t(beg[r]); i < std::size_t(beg[r+1]); ++i) {
+            const T av = alpha * val[i];
+            const T* brow = b + std::size_t(col[i]) * k;
+            for(std::size_t j = 0; j < k; ++j) {
+                crow[j] += av * brow[j];
+            }
+        }
+    }
+}
+
+}  // namespace crs_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief sparse matrix - dense matrix product  C = alpha * A * B + beta * C
+ *
+ * @param  b           has to have at least A.cols() rows
+ * @param  c           is resized to (A.rows() x B.cols()) if its shape
+ *                     doesn't match; then it is not read
+ * @param  numThreads  1 => serial; 0 => hardware concurrency;
+ *                     rows are distributed so that every thread
+ *                     processes (about) the same number of non-zeros
+ *
+ * @details every sparse row is read once and updates a whole row of C;
+ *          the row-major layout of dynamic_matrix makes these row updates
+ *          contiguous (and vectorizable);
+ *          the n/a value of A is treated as zero
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO, class DA>
+void
+spmm(const crs_matrix<T,NA,A,CI,RO>& a,
+     const dynamic_matrix<T,DA>& b, dynamic_matrix<T,DA>& c,
+     const T& alpha = T(1), T beta = T(0),
+     int numThreads = 1)
+{
+    const auto rows = a.rows();
+    const auto k = b.cols();
+
+    if(c.rows() != rows || c.cols() != k) {
+        c.resize(rows, k, T(0));
+        beta = T(0);
+    }
+    if(rows < 1 || k < 1) return;
+
+    numThreads = effective_thread_count(numThreads);
+
+    const T* pb = b.begin();
+    T* pc = c.begin();
+
+    if(numThreads < 2) {
+        crs_detail::spmm_rows(a, 0, rows, pb, pc, k, alpha, beta);
+        return;
+    }
+
+    parallel_for_blocks(
+        weighted_partition(a.row_offset_data(), rows, numThreads),
+        [&](std::size_t first, std::size_t last, int) {
+            crs_detail::spmm_rows(a, first, last, pb, pc, k, alpha, beta);
+        });
+}
+
+//-------------------------------------------------------------------
+/**
+ * @brief sparse matrix - dense matrix product  C = A * B
+ */
+template<class T, class NA, class A, class CI, class RO, class DA>
+dynamic_matrix<T,DA>
+spmm(const crs_matrix<T,NA,A,CI,RO>& a, const dynamic_matrix<T,DA>& b,
+     int numThreads = 1)
+{
+    auto c = dynamic_matrix<T,DA>{};
+    spmm(a, b, c, T(1), T(0), numThreads);
+    return c;
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief  builds a CRS matrix from all elements of a dense matrix
+ *         for which keep(row, col, value) returns true
+ *
+ * @param  numThreads  1 => serial; 0 => hardware concurrency
+ *
+ * @details two passes over the dense matrix, both parallel over row blocks:
+ *          the first one counts the kept elements per row, the second one
+ *          fills the exactly preallocated CRS arrays;
+ *          'keep' is called twice per element and must not throw
+ *
+ * @throws std::out_of_range / std::length_error if the column indices /
+ *         the number of kept elements don't fit into Matrix' index types
+ *
+ *****************************************************************************/
+template<class Matrix, class T, class DA, class Predicate>
+Matrix
+dense_to_crs(const dynamic_matrix<T,DA>& d, Predicate&& keep,
+             int numThreads = 1)
+{
+    using value_storage      = typename Matrix::value_storage;
+    using col_index_storage  = typename Matrix::col_index_storage;
+    using row_offset_storage = typename Matrix::row_offset_storage;
+    using ci_t = typename Matrix::col_index_type;
+    using ro_t = typename Matrix::row_offset_type;
+
+    const auto rows = d.rows();
+    const auto cols = d.cols();
+    const T* pd = d.begin();
+
+    //per-row counts and column indices have to fit into the index types
+    Matrix::check_dense_row(cols);
+
+    numThreads = effective_thread_count(numThreads);
+
+    //count pass: rowbeg[r+1] = number of kept elements in row r
+    auto rowbeg = row_offset_storage(rows + 1, ro_t(0));
+    parallel_for_blocks(std::size_t(0), rows, numThreads,
+        [&](std::size_t first, std::size_t last, int) {
+            for(auto r = first; r < last; ++r) {
+                const T* row = pd + r*cols;
+                std::size_t n = 0;
+                for(std::size_t c = 0; c < cols; ++c) {
+                    n += std::size_t(bool(keep(r, c, row[c])));
+                }
+                rowbeg[r+1] = ro_t(n);
+            }
+        });
+
+    std::size_t nnz = 0;
+    for(std::size_t r = 1; r <= rows; ++r) nnz += std::size_t(rowbeg[r]);
+    Matrix::check_nnz(nnz);
+    std::partial_sum(rowbeg.begin(), rowbeg.end(), rowbeg.begin());
+
+    //fill pass
+    auto values = value_storage(nnz);
+    auto colidx = col_index_storage(nnz);
+
+    parallel_for_blocks(std::size_t(0), rows, numThreads,
+        [&](std::size_t first, std::size_t last, int) {
+            for(auto r = first; r < last; ++r) {
+                const T* row = pd + r*cols;
+                auto o = std::size_t(rowbeg[r]);
+                for(std::size_t c = 0; c < cols; ++c) {
+                    if(keep(r, c, row[c])) {
+                        values[o] = row[c];
+                        colidx[o] = ci_t(c);
+                        ++o;
+                    }
+                }
+            }
+        });
+
+    auto m = Matrix{std::move(values), std::move(colidx), std::move(rowbeg)};
+    m.cols(cols);
+    return m;
+}
+
+//-------------------------------------------------------------------
+/**
+ * @brief  builds a crs_matrix from all elements of a dense matrix
+ *         with a magnitude greater than 'threshold'
+ */
+template<class T, class DA>
+crs_matrix<T>
+dense_to_crs(const dynamic_matrix<T,DA>& d,
+             const typename dynamic_matrix<T,DA>::value_type& threshold = T(0),
+             int numThreads = 1)
+{
+    return dense_to_crs<crs_matrix<T>>(d,
+        [&threshold](std::size_t, std::size_t, const T& x) {
+            return threshold < crs_detail::magnitude(x);
+        },
+        numThreads);
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief  writes all elements of a CRS matrix into a dense matrix;
+ *         positions without stored element get the n/a value of 'm'
+ *
+ * @param  d           is resized to (m.rows() x m.cols()) if its shape
+ *                     doesn't match
+ * @param  numThreads  1 => serial; 0 => hardware concurrency;
+ *                     rows are scattered in parallel
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO, class DA>
+void
+crs_to_dense(const crs_matrix<T,NA,A,CI,RO>& m, dynamic_matrix<T,DA>& d,
+             int numThreads = 1)
+{
+    const auto rows = m.rows();
+    const auto cols = m.cols();
+
+    if(d.rows() != rows || d.cols() != cols) {
+        d.resize(rows, cols, m.na_value());
+    }
+    if(rows < 1 || cols < 1) return;
+
+    const auto val = m.data();
+    const auto col = m.col_index_data();
+    const auto beg = m.row_offset_data();
+    T* pd = d.begin();
+
+    parallel_for_blocks(std::size_t(0), rows, effective_thread_count(numThreads),
+        [&](std::size_t first, std::size_t last, int) {
+            for(auto r = first; r < last; ++r) {
+                T* row = pd + r*cols;
+                std::fill(row, row + cols, m.na_value());
+                for(auto i = std::size_t(beg[r]); i < std::size_t(beg[r+1]); ++i) {
+                    row[col[i]] = val[i];
+                }
+            }
+        });
+}
+
+//-------------------------------------------------------------------
+template<class T, class NA, class A, class CI, class RO>
+dynamic_matrix<T>
+crs_to_dense(const crs_matrix<T,NA,A,CI,RO>& m, int numThreads = 1)
+{
+    auto d = dynamic_matrix<T>{};
+    crs_to_dense(m, d, numThreads);
+    return d;
+}
+
+
+}  // namespace am
+
+
+#endif
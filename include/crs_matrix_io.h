@@ -0,0 +1,1241 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_CRS_MATRIX_IO_H_
+#define AMLIB_CONTAINERS_CRS_MATRIX_IO_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <ios>
+#include <locale>
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+#include <utility>
+#include <limits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  define AM_CRS_MATRIX_USE_MMAP
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#include "crs_matrix.h"
+#include "parallel.h"
+
+
+namespace am {
+
+
+/*****************************************************************************
+ *
+ * EXCEPTIONS
+ *
+ *****************************************************************************/
+struct crs_matrix_io_error :
+    public std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+
+
+namespace crs_detail {
+
+
+/*****************************************************************************
+ *
+ * @brief header of the binary CRS file format
+ *
+ * @details layout: [header | values | column indices | row offsets]
+ *          every array starts at a file offset that is a multiple of 64;
+ *          all numbers are stored in the byte order of the writer
+ *
+ *****************************************************************************/
+struct crs_binary_header
+{
+    static constexpr std::uint32_t current_version() noexcept { return 1; }
+    static constexpr std::uint32_t byte_order_mark() noexcept { return 0x01020304u; }
+    static constexpr std::size_t alignment() noexcept { return 64; }
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t valueSize;
+    std::uint32_t colIndexSize;
+    std::uint32_t rowOffsetSize;
+    std::uint32_t reserved0;
+    std::uint64_t rows;
+    std::uint64_t cols;
+    std::uint64_t nnz;
+    std::uint64_t reserved1;
+
+    //---------------------------------------------------------------
+    static const char* magic_string() noexcept { return "AMCRSMAT"; }
+
+    //---------------------------------------------------------------
+    static constexpr std::uint64_t
+    aligned(std::uint64_t offset) noexcept {
+        return ((offset + alignment() - 1) / alignment()) * alignment();
+    }
+
+    std::uint64_t values_offset() const noexcept {
+        return aligned(sizeof(crs_binary_header));
+    }
+    std::uint64_t col_index_offset() const noexcept {
+        return aligned(values_offset() + nnz * valueSize);
+    }
+    std::uint64_t row_offset_offset() const noexcept {
+        return aligned(col_index_offset() + nnz * colIndexSize);
+    }
+    std::uint64_t file_size() const noexcept {
+        return row_offset_offset() + (rows + 1) * rowOffsetSize;
+    }
+
+    //---------------------------------------------------------------
+    template<class ValueType, class ColIndexType, class RowOffsetType>
+    static crs_binary_header
+    make(std::uint64_t rows, std::uint64_t cols, std::uint64_t nnz) noexcept
+    {
+        crs_binary_header h;
+        std::memcpy(h.magic, magic_string(), sizeof(h.magic));
+        h.version       = current_version();
+        h.byteOrder     = byte_order_mark();
+        h.valueSize     = std::uint32_t(sizeof(ValueType));
+        h.colIndexSize  = std::uint32_t(sizeof(ColIndexType));
+        h.rowOffsetSize = std::uint32_t(sizeof(RowOffsetType));
+        h.reserved0     = 0;
+        h.rows          = rows;
+        h.cols          = cols;
+        h.nnz           = nnz;
+        h.reserved1     = 0;
+        return h;
+    }
+
+    //---------------------------------------------------------------
+    /// @brief throws if header doesn't match the requested types
+    template<class ValueType, class ColIndexType, class RowOffsetType>
+    void
+    validate() const
+    {
+        if(std::memcmp(magic, magic_string(), sizeof(magic)) != 0)
+            throw crs_matrix_io_error{"crs_matrix: not a binary CRS file"};
+
+        if(version != current_version())
+            throw crs_matrix_io_error{"crs_matrix: unsupported file version"};
+
+        if(byteOrder != byte_order_mark())
+            throw crs_matrix_io_error{"crs_matrix: file has different byte order"};
+
+        if(valueSize     != sizeof(ValueType) ||
+           colIndexSize  != sizeof(ColIndexType) ||
+           rowOffsetSize != sizeof(RowOffsetType))
+        {
+            throw crs_matrix_io_error{"crs_matrix: file has different element types"};
+        }
+
+        //all arrays have to be addressable => file_size() can't overflow
+        const auto maxBytes =
+            std::uint64_t(std::numeric_limits<std::size_t>::max()) / 4;
+
+        if(nnz > maxBytes / (valueSize + colIndexSize) ||
+           rows >= maxBytes / rowOffsetSize ||
+           nnz > std::uint64_t(std::numeric_limits<RowOffsetType>::max()))
+        {
+            throw crs_matrix_io_error{"crs_matrix: invalid number of rows or elements"};
+        }
+    }
+};
+
+static_assert(sizeof(crs_binary_header) == 64,
+              "crs_binary_header has to be exactly 64 bytes long");
+
+
+//-------------------------------------------------------------------
+/// @brief throws if row offsets don't start with 0, aren't ascending
+///        or don't end with the number of elements
+template<class RowOffsetType>
+void
+validate_row_offsets(const RowOffsetType* rowbeg,
+                     std::uint64_t rows, std::uint64_t nnz)
+{
+    bool ok = rowbeg[0] == RowOffsetType(0) &&
+              std::uint64_t(rowbeg[rows]) == nnz;
+
+    for(std::uint64_t r = 0; r < rows && ok; ++r) {
+        ok = rowbeg[r] <= rowbeg[r+1];
+    }
+    if(!ok) throw crs_matrix_io_error{"crs_matrix: invalid row offsets"};
+}
+
+
+//-------------------------------------------------------------------
+/// @brief throws if the column indices of a row aren't strictly
+///        ascending or not smaller than the number of columns;
+///        requires valid row offsets
+template<class ColIndexType, class RowOffsetType>
+void
+validate_col_indices(const ColIndexType* colidx,
+                     const RowOffsetType* rowbeg,
+                     std::uint64_t rows, std::uint64_t cols)
+{
+    for(std::uint64_t r = 0; r < rows; ++r) {
+        const auto end = std::uint64_t(rowbeg[r+1]);
+        for(auto i = std::uint64_t(rowbeg[r]); i < end; ++i) {
+            if(std::uint64_t(colidx[i]) >= cols ||
+               (i > std::uint64_t(rowbeg[r]) && colidx[i-1] >= colidx[i]))
+            {
+                throw crs_matrix_io_error{"crs_matrix: invalid column indices"};
+            }
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------
+/// @brief number of bytes from the current position to the end of the
+///        stream or -1 if the stream isn't seekable
+inline std::streamoff
+remaining_bytes(std::istream& is)
+{
+    const auto pos = is.tellg();
+    if(pos == std::istream::pos_type(-1)) return -1;
+    is.seekg(0, std::ios::end);
+    const auto end = is.tellg();
+    is.seekg(pos);
+    if(end == std::istream::pos_type(-1) || !is) {
+        is.clear();
+        is.seekg(pos);
+        return -1;
+    }
+    return end - pos;
+}
+
+
+//-------------------------------------------------------------------
+/// @brief reads 'n' array elements into 'v' in bounded steps
+///        => a corrupt count fails with "unexpected end of file"
+///        instead of one huge allocation
+template<class Vector>
+void
+read_array(std::istream& is, Vector& v, std::uint64_t n)
+{
+    using value_t = typename Vector::value_type;
+    constexpr std::uint64_t chunk = (std::uint64_t(1) << 24) / sizeof(value_t) + 1;
+
+    v.clear();
+    while(v.size() < n) {
+        const auto pos = std::uint64_t(v.size());
+        const auto k = std::min(n - pos, chunk);
+        v.resize(std::size_t(pos + k));
+        if(!is.read(reinterpret_cast<char*>(v.data() + pos),
+                    std::streamsize(k * sizeof(value_t))))
+        {
+            throw crs_matrix_io_error{"crs_matrix: unexpected end of file"};
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------
+template<class Ostream>
+void
+write_padding(Ostream& os, std::uint64_t from, std::uint64_t to)
+{
+    static const char zeros[crs_binary_header::alignment()] = {};
+    if(to > from) os.write(zeros, std::streamsize(to - from));
+}
+
+
+}  // namespace crs_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief writes matrix in versioned binary format
+ *        (can be memory-mapped with am::mapped_crs_matrix)
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO>
+void
+write_binary(std::ostream& os, const crs_matrix<T,NA,A,CI,RO>& m)
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "binary CRS I/O requires a trivially copyable value type");
+
+    using header_t = crs_detail::crs_binary_header;
+
+    const auto h = header_t::template make<T,CI,RO>(m.rows(), m.cols(), m.size());
+
+    os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    crs_detail::write_padding(os, sizeof(h), h.values_offset());
+
+    os.write(reinterpret_cast<const char*>(m.data()),
+             std::streamsize(h.nnz * sizeof(T)));
+    crs_detail::write_padding(os, h.values_offset() + h.nnz * sizeof(T),
+                                  h.col_index_offset());
+
+    os.write(reinterpret_cast<const char*>(m.col_index_data()),
+             std::streamsize(h.nnz * sizeof(CI)));
+    crs_detail::write_padding(os, h.col_index_offset() + h.nnz * sizeof(CI),
+                                  h.row_offset_offset());
+
+    os.write(reinterpret_cast<const char*>(m.row_offset_data()),
+             std::streamsize((h.rows + 1) * sizeof(RO)));
+
+    if(!os) throw crs_matrix_io_error{"crs_matrix: write failed"};
+}
+
+//-------------------------------------------------------------------
+template<class T, class NA, class A, class CI, class RO>
+void
+write_binary(const std::string& filename, const crs_matrix<T,NA,A,CI,RO>& m)
+{
+    std::ofstream os{filename, std::ios::out | std::ios::binary};
+    if(!os) throw crs_matrix_io_error{"crs_matrix: could not open " + filename};
+    write_binary(os, m);
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief reads matrix written by write_binary (copying)
+ *
+ * @tparam Matrix  crs_matrix type with the same value and index types
+ *                 as the one that was written
+ *
+ *****************************************************************************/
+template<class Matrix>
+Matrix
+read_binary(std::istream& is)
+{
+    using value_type = typename Matrix::value_type;
+    using col_type   = typename Matrix::col_index_type;
+    using off_type   = typename Matrix::row_offset_type;
+    using header_t   = crs_detail::crs_binary_header;
+
+    static_assert(std::is_trivially_copyable<value_type>::value,
+                  "binary CRS I/O requires a trivially copyable value type");
+
+    header_t h;
+    if(!is.read(reinterpret_cast<char*>(&h), sizeof(h)))
+        throw crs_matrix_io_error{"crs_matrix: could not read file header"};
+
+    h.template validate<value_type,col_type,off_type>();
+
+    //bound the array sizes by the stream size (if known)
+    const auto remaining = crs_detail::remaining_bytes(is);
+    const bool sizeKnown = remaining >= 0;
+    if(sizeKnown && std::uint64_t(remaining) < h.file_size() - sizeof(h))
+        throw crs_matrix_io_error{"crs_matrix: unexpected end of file"};
+
+    const auto skip_to = [&](std::uint64_t pos, std::uint64_t target) {
+        if(target > pos) is.ignore(std::streamsize(target - pos));
+    };
+
+    auto values = typename Matrix::value_storage{};
+    auto colidx = typename Matrix::col_index_storage{};
+    auto rowbeg = typename Matrix::row_offset_storage{};
+    if(sizeKnown) {
+        values.reserve(std::size_t(h.nnz));
+        colidx.reserve(std::size_t(h.nnz));
+        rowbeg.reserve(std::size_t(h.rows + 1));
+    }
+
+    skip_to(sizeof(h), h.values_offset());
+    crs_detail::read_array(is, values, h.nnz);
+
+    skip_to(h.values_offset() + h.nnz * sizeof(value_type), h.col_index_offset());
+    crs_detail::read_array(is, colidx, h.nnz);
+
+    skip_to(h.col_index_offset() + h.nnz * sizeof(col_type), h.row_offset_offset());
+    crs_detail::read_array(is, rowbeg, h.rows + 1);
+
+    crs_detail::validate_row_offsets(rowbeg.data(), h.rows, h.nnz);
+
+    auto m = Matrix{std::move(values), std::move(colidx), std::move(rowbeg)};
+    m.cols(typename Matrix::size_type(h.cols));
+    return m;
+}
+
+//-------------------------------------------------------------------
+template<class Matrix>
+Matrix
+read_binary(const std::string& filename)
+{
+    std::ifstream is{filename, std::ios::in | std::ios::binary};
+    if(!is) throw crs_matrix_io_error{"crs_matrix: could not open " + filename};
+    return read_binary<Matrix>(is);
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief read-only CRS matrix view of a memory-mapped binary CRS file
+ *        (see write_binary); nothing is copied on construction
+ *
+ * @details falls back to reading the whole file into memory on
+ *          platforms without mmap
+ *
+ *****************************************************************************/
+template<
+    class ValueType,
+    class NAvalue = crs_matrix_static_value<ValueType,0>,
+    class ColIndexType = std::size_t,
+    class RowOffsetType = std::size_t
+>
+class mapped_crs_matrix
+{
+    using header_t = crs_detail::crs_binary_header;
+
+public:
+    //---------------------------------------------------------------
+    // TYPES
+    //---------------------------------------------------------------
+    using value_type      = ValueType;
+    using na_value_type   = NAvalue;
+    using size_type       = std::size_t;
+    using col_index_type  = ColIndexType;
+    using row_offset_type = RowOffsetType;
+    //-----------------------------------------------------
+    using const_reference = const value_type&;
+    using const_pointer   = const value_type*;
+    using const_iterator  = const value_type*;
+    using iterator        = const_iterator;
+    using col_index_iterator = const col_index_type*;
+
+
+    //---------------------------------------------------------------
+    /**
+     * @brief range definition helper
+     */
+    template<class Iterator>
+    class iter_range_t_
+    {
+    public:
+        constexpr explicit
+        iter_range_t_(Iterator beg, Iterator end) noexcept : beg_{beg}, end_{end} {}
+
+        constexpr Iterator begin() const noexcept { return beg_; }
+        constexpr Iterator end()   const noexcept { return end_; }
+
+        bool empty() const noexcept { return (beg_ == end_); }
+        size_type size() const noexcept { return size_type(end_ - beg_); }
+
+    private:
+        Iterator beg_;
+        Iterator end_;
+    };
+
+    using const_row_range = iter_range_t_<const_iterator>;
+    using index_range     = iter_range_t_<col_index_iterator>;
+
+
+    //---------------------------------------------------------------
+    // CONSTRUCTION / DESTRUCTION
+    //---------------------------------------------------------------
+    /** @brief  maps a binary CRS file
+     *
+     * @details By default only the header, the file size and the first and
+     *          last row offsets are checked, so that opening a file doesn't
+     *          touch every page of it. With 'validate = true' all row offsets
+     *          and all column indices (ascending within each row and smaller
+     *          than cols()) are checked as well; this reads the whole index
+     *          part of the file.
+     */
+    explicit
+    mapped_crs_matrix(const std::string& filename, bool validate = false)
+    {
+        static_assert(std::is_trivially_copyable<value_type>::value,
+                      "binary CRS I/O requires a trivially copyable value type");
+        map(filename);
+
+        if(bytes_ < sizeof(header_t)) {
+            unmap();
+            throw crs_matrix_io_error{"crs_matrix: file too small " + filename};
+        }
+
+        header_t h;
+        std::memcpy(&h, mem_, sizeof(h));
+        try {
+            h.template validate<value_type,col_index_type,row_offset_type>();
+            if(bytes_ < h.file_size()) {
+                throw crs_matrix_io_error{"crs_matrix: truncated file " + filename};
+            }
+            const auto rowbeg = reinterpret_cast<const row_offset_type*>(
+                                    mem_ + h.row_offset_offset());
+            if(validate) {
+                crs_detail::validate_row_offsets(rowbeg, h.rows, h.nnz);
+                crs_detail::validate_col_indices(
+                    reinterpret_cast<const col_index_type*>(
+                        mem_ + h.col_index_offset()),
+                    rowbeg, h.rows, h.cols);
+            }
+            else if(rowbeg[0] != row_offset_type(0) ||
+                    std::uint64_t(rowbeg[h.rows]) != h.nnz)
+            {
+                throw crs_matrix_io_error{"crs_matrix: invalid row offsets"};
+            }
+        }
+        catch(...) {
+            unmap();
+            throw;
+        }
+
+        rows_ = size_type(h.rows);
+        cols_ = size_type(h.cols);
+        nnz_  = size_type(h.nnz);
+        values_ = reinterpret_cast<const value_type*>(mem_ + h.values_offset());
+        colidx_ = reinterpret_cast<const col_index_type*>(mem_ + h.col_index_offset());
+        rowbeg_ = reinterpret_cast<const row_offset_type*>(mem_ + h.row_offset_offset());
+    }
+
+    //-----------------------------------------------------
+    mapped_crs_matrix(const mapped_crs_matrix&) = delete;
+
+    mapped_crs_matrix(mapped_crs_matrix&& src) noexcept {
+        swap(*this, src);
+    }
+
+    //-----------------------------------------------------
+    mapped_crs_matrix& operator = (const mapped_crs_matrix&) = delete;
+
+    mapped_crs_matrix& operator = (mapped_crs_matrix&& src) noexcept {
+        swap(*this, src);
+        return *this;
+    }
+
+    //-----------------------------------------------------
+    ~mapped_crs_matrix() {
+        unmap();
+    }
+
+
+    //---------------------------------------------------------------
+    // N/A VALUE
+    //---------------------------------------------------------------
+    static constexpr value_type
+    na_value() noexcept {
+        return na_value_type::value();
+    }
+
+
+    //---------------------------------------------------------------
+    // MATRIX ELEMENT ACCESS
+    //---------------------------------------------------------------
+    bool
+    has(size_type row, size_type col) const noexcept {
+        return offset(row,col) < nnz_;
+    }
+    //-----------------------------------------------------
+    const_iterator
+    find(size_type row, size_type col) const noexcept {
+        return values_ + offset(row,col);
+    }
+    //-----------------------------------------------------
+    value_type
+    operator () (size_type row, size_type col) const noexcept {
+        const auto o = offset(row,col);
+        return (o < nnz_) ? values_[o] : na_value();
+    }
+    //-----------------------------------------------------
+    const_reference
+    operator [] (size_type index) const noexcept {
+        return values_[index];
+    }
+
+
+    //---------------------------------------------------------------
+    // DIRECT ACCESS TO CRS REPRESENTATION
+    //---------------------------------------------------------------
+    const value_type*
+    data() const noexcept {
+        return values_;
+    }
+    const col_index_type*
+    col_index_data() const noexcept {
+        return colidx_;
+    }
+    const row_offset_type*
+    row_offset_data() const noexcept {
+        return rowbeg_;
+    }
+
+    //-----------------------------------------------------
+    col_index_iterator
+    begin_col_indices() const noexcept {
+        return colidx_;
+    }
+    col_index_iterator
+    end_col_indices() const noexcept {
+        return colidx_ + nnz_;
+    }
+    col_index_iterator
+    begin_col_indices(size_type row) const noexcept {
+        return colidx_ + rowbeg_[row];
+    }
+    col_index_iterator
+    end_col_indices(size_type row) const noexcept {
+        return colidx_ + rowbeg_[row+1];
+    }
+    index_range
+    col_indices() const noexcept {
+        return index_range{begin_col_indices(), end_col_indices()};
+    }
+
+
+    //---------------------------------------------------------------
+    // SIZE PROPERTIES
+    //---------------------------------------------------------------
+    size_type size()  const noexcept { return nnz_; }
+    bool      empty() const noexcept { return nnz_ < 1; }
+    size_type rows()  const noexcept { return rows_; }
+    size_type cols()  const noexcept { return cols_; }
+
+    //-----------------------------------------------------
+    size_type
+    row_size(size_type row) const noexcept {
+        return size_type(rowbeg_[row+1] - rowbeg_[row]);
+    }
+    bool
+    row_empty(size_type row) const noexcept {
+        return row_size(row) < 1;
+    }
+
+
+    //---------------------------------------------------------------
+    // ITERATORS
+    //---------------------------------------------------------------
+    const_iterator begin()  const noexcept { return values_; }
+    const_iterator cbegin() const noexcept { return values_; }
+    const_iterator end()    const noexcept { return values_ + nnz_; }
+    const_iterator cend()   const noexcept { return values_ + nnz_; }
+
+    //-----------------------------------------------------
+    const_iterator
+    begin_row(size_type row) const noexcept {
+        return values_ + rowbeg_[row];
+    }
+    const_iterator
+    end_row(size_type row) const noexcept {
+        return values_ + rowbeg_[row+1];
+    }
+    const_row_range
+    row(size_type row) const noexcept {
+        return const_row_range{begin_row(row), end_row(row)};
+    }
+
+
+    //---------------------------------------------------------------
+    friend void
+    swap(mapped_crs_matrix& a, mapped_crs_matrix& b) noexcept {
+        using std::swap;
+        swap(a.mem_,    b.mem_);
+        swap(a.bytes_,  b.bytes_);
+        swap(a.rows_,   b.rows_);
+        swap(a.cols_,   b.cols_);
+        swap(a.nnz_,    b.nnz_);
+        swap(a.values_, b.values_);
+        swap(a.colidx_, b.colidx_);
+        swap(a.rowbeg_, b.rowbeg_);
+    }
+
+
+private:
+    //---------------------------------------------------------------
+    size_type
+    offset(size_type row, size_type col) const noexcept
+    {
+        if(row >= rows_ ||
+           col > size_type(std::numeric_limits<col_index_type>::max()))
+        {
+            return nnz_;
+        }
+        const auto key = col_index_type(col);
+        const auto b = colidx_ + rowbeg_[row];
+        const auto e = colidx_ + rowbeg_[row+1];
+        const auto it = adaptive_lower_bound(b, e, key);
+        return (it != e && *it == key) ? size_type(it - colidx_) : nnz_;
+    }
+
+    //---------------------------------------------------------------
+    void
+    map(const std::string& filename)
+    {
+#ifdef AM_CRS_MATRIX_USE_MMAP
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+        if(fd < 0) throw crs_matrix_io_error{"crs_matrix: could not open " + filename};
+
+        struct stat st;
+        if(::fstat(fd, &st) != 0 || st.st_size < 1) {
+            ::close(fd);
+            throw crs_matrix_io_error{"crs_matrix: could not read " + filename};
+        }
+        bytes_ = size_type(st.st_size);
+
+        void* p = ::mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(p == MAP_FAILED) {
+            bytes_ = 0;
+            throw crs_matrix_io_error{"crs_matrix: could not map " + filename};
+        }
+        mem_ = static_cast<const char*>(p);
+#else
+        std::ifstream is{filename, std::ios::in | std::ios::binary | std::ios::ate};
+        if(!is) throw crs_matrix_io_error{"crs_matrix: could not open " + filename};
+        const auto end = is.tellg();
+        if(end == std::ifstream::pos_type(-1) || end < 1)
+            throw crs_matrix_io_error{"crs_matrix: could not read " + filename};
+        is.seekg(0);
+        auto p = static_cast<char*>(::operator new(size_type(end)));
+        if(!is.read(p, std::streamsize(end))) {
+            ::operator delete(p);
+            throw crs_matrix_io_error{"crs_matrix: could not read " + filename};
+        }
+        bytes_ = size_type(end);
+        mem_ = p;
+#endif
+    }
+
+    //---------------------------------------------------------------
+    void
+    unmap() noexcept
+    {
+        if(!mem_) return;
+#ifdef AM_CRS_MATRIX_USE_MMAP
+        ::munmap(const_cast<char*>(mem_), bytes_);
+#else
+        ::operator delete(const_cast<char*>(mem_));
+#endif
+        mem_ = nullptr;
+        bytes_ = 0;
+    }
+
+
+    //---------------------------------------------------------------
+    const char* mem_ = nullptr;
+    size_type bytes_ = 0;
+    size_type rows_ = 0;
+    size_type cols_ = 0;
+    size_type nnz_ = 0;
+    const value_type* values_ = nullptr;
+    const col_index_type* colidx_ = nullptr;
+    const row_offset_type* rowbeg_ = nullptr;
+};
+
+
+
+namespace crs_detail {
+
+
+/*****************************************************************************
+ *
+ * MATRIX MARKET HELPERS
+ *
+ *****************************************************************************/
+struct matrix_market_format {
+    bool pattern = false;
+    bool integer = false;
+    bool symmetric = false;
+    bool skew = false;
+};
+
+
+//-------------------------------------------------------------------
+inline std::string
+to_lower(std::string s)
+{
+    for(auto& c : s) c = char(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+
+//-------------------------------------------------------------------
+inline matrix_market_format
+parse_matrix_market_banner(const std::string& line)
+{
+    char object[64] = {}, layout[64] = {}, field[64] = {}, symmetry[64] = {};
+
+    if(line.compare(0, 14, "%%MatrixMarket") != 0 ||
+       std::sscanf(line.c_str() + 14, "%63s %63s %63s %63s",
+                   object, layout, field, symmetry) != 4)
+    {
+        throw crs_matrix_io_error{"matrix market: invalid banner"};
+    }
+    if(to_lower(object) != "matrix" || to_lower(layout) != "coordinate") {
+        throw crs_matrix_io_error{"matrix market: only sparse (coordinate) "
+                                  "matrices are supported"};
+    }
+
+    matrix_market_format fmt;
+
+    const auto f = to_lower(field);
+    if(f == "pattern")      fmt.pattern = true;
+    else if(f == "integer") fmt.integer = true;
+    else if(f != "real" && f != "double") {
+        throw crs_matrix_io_error{"matrix market: unsupported field " + f};
+    }
+
+    const auto s = to_lower(symmetry);
+    if(s == "symmetric")           fmt.symmetric = true;
+    else if(s == "skew-symmetric") fmt.symmetric = fmt.skew = true;
+    else if(s != "general") {
+        throw crs_matrix_io_error{"matrix market: unsupported symmetry " + s};
+    }
+    return fmt;
+}
+
+
+//-------------------------------------------------------------------
+/// @brief skips spaces and tabs; false if the line ends
+inline bool
+skip_blanks(const char*& p) noexcept
+{
+    while(*p == ' ' || *p == '\t') ++p;
+    return *p != '\n' && *p != '\r' && *p != '\0';
+}
+
+//-------------------------------------------------------------------
+/// @brief parses decimal digits; advances 'p';
+///        false if there are no digits or if 'x' would overflow
+template<class UInt>
+inline bool
+parse_digits(const char*& p, UInt& x) noexcept
+{
+    if(*p < '0' || *p > '9') return false;
+    UInt v = 0;
+    for(; *p >= '0' && *p <= '9'; ++p) {
+        const auto d = UInt(*p - '0');
+        if(v > (std::numeric_limits<UInt>::max() - d) / 10) return false;
+        v = UInt(v * 10 + d);
+    }
+    x = v;
+    return true;
+}
+
+//-------------------------------------------------------------------
+/// @brief parses unsigned decimal; advances 'p';
+///        false if no digits or on overflow
+inline bool
+parse_uint(const char*& p, std::size_t& x) noexcept
+{
+    return skip_blanks(p) && parse_digits(p, x);
+}
+
+
+//-------------------------------------------------------------------
+/// @brief parses and formats floating point numbers with the classic
+///        "C" locale, so that neither depends on the global locale
+class classic_float_format
+{
+    using getter = std::num_get<char,const char*>;
+    using putter = std::num_put<char,char*>;
+
+public:
+    classic_float_format():
+        ios_{nullptr}
+    {
+        ios_.imbue(std::locale{std::locale{std::locale::classic(), new getter{}},
+                               new putter{}});
+        ios_.precision(std::numeric_limits<double>::max_digits10);
+        get_ = &std::use_facet<getter>(ios_.getloc());
+        put_ = &std::use_facet<putter>(ios_.getloc());
+    }
+
+    classic_float_format(const classic_float_format&) = delete;
+    classic_float_format& operator = (const classic_float_format&) = delete;
+
+    /// @brief parses number starting at 'p'; advances 'p';
+    ///        false if there is no (representable) number
+    bool
+    parse(const char*& p, const char* last, double& x)
+    {
+        //num_get doesn't know inf/nan
+        if(parse_special(p, last, x)) return true;
+
+        auto err = std::ios_base::goodbit;
+        double v = 0;
+        const auto e = get_->get(p, last, ios_, err, v);
+        if((err & std::ios_base::failbit) || e == p) return false;
+        x = v;
+        p = e;
+        return true;
+    }
+
+    /// @brief writes 'x' with max_digits10 significant digits to 'out'
+    ///        (which has to hold at least 32 characters)
+    /// @return end of the written characters
+    char*
+    format(char* out, double x) {
+        return put_->put(out, ios_, ' ', x);
+    }
+
+private:
+    static bool
+    parse_special(const char*& p, const char* last, double& x) noexcept
+    {
+        auto q = p;
+        const bool neg = q < last && *q == '-';
+        if(q < last && (*q == '-' || *q == '+')) ++q;
+
+        const auto starts_with = [&](const char* word) {
+            auto r = q;
+            for(; *word != '\0'; ++word, ++r) {
+                if(r >= last || std::tolower(static_cast<unsigned char>(*r)) != *word)
+                    return false;
+            }
+            q = r;
+            return true;
+        };
+
+        if(starts_with("inf")) {
+            starts_with("inity");
+            x = neg ? -std::numeric_limits<double>::infinity()
+                    :  std::numeric_limits<double>::infinity();
+        }
+        else if(starts_with("nan")) {
+            x = std::numeric_limits<double>::quiet_NaN();
+        }
+        else {
+            return false;
+        }
+        p = q;
+        return true;
+    }
+
+    std::ios ios_;
+    const getter* get_ = nullptr;
+    const putter* put_ = nullptr;
+};
+
+
+//-------------------------------------------------------------------
+/// @brief parses signed decimal; false if no digits or if the value
+///        isn't representable by T
+template<class T>
+inline bool
+parse_value(const char*& p, const char*, classic_float_format&,
+            T& x, std::true_type /*integral*/) noexcept
+{
+    if(!skip_blanks(p)) return false;
+    bool neg = *p == '-';
+    if(*p == '-' || *p == '+') ++p;
+
+    std::uintmax_t mag = 0;
+    if(!parse_digits(p, mag)) return false;
+    if(mag == 0) neg = false;
+
+    const auto maxMag = std::uintmax_t(std::numeric_limits<T>::max());
+    if(neg) {
+        if(!std::numeric_limits<T>::is_signed || mag - 1 > maxMag) return false;
+        x = T(-std::intmax_t(mag - 1) - 1);
+    } else {
+        if(mag > maxMag) return false;
+        x = T(mag);
+    }
+    return true;
+}
+
+/// @brief parses floating point number independent of the global locale
+template<class T>
+inline bool
+parse_value(const char*& p, const char* last, classic_float_format& num,
+            T& x, std::false_type /*integral*/)
+{
+    if(!skip_blanks(p)) return false;
+    double v = 0;
+    if(!num.parse(p, last, v)) return false;
+    x = T(v);
+    return true;
+}
+
+
+//-------------------------------------------------------------------
+/**
+ * @brief parses the entry lines in [first,last) (which has to end
+ *        with a complete line) and appends 1 or 2 triplets per line
+ * @return false on malformed input
+ */
+template<class T>
+bool
+parse_matrix_market_entries(const char* first, const char* last,
+                            const matrix_market_format& fmt,
+                            std::size_t rows, std::size_t cols,
+                            std::vector<crs_triplet<T>>& out,
+                            std::size_t& count)
+{
+    using is_int = std::integral_constant<bool,std::is_integral<T>::value>;
+
+    classic_float_format num;
+    count = 0;
+    auto p = first;
+    while(p < last) {
+        //skip blank lines and comments
+        while(p < last && std::isspace(static_cast<unsigned char>(*p))) ++p;
+        if(p >= last) break;
+        if(*p == '%') {
+            while(p < last && *p != '\n') ++p;
+            continue;
+        }
+
+        std::size_t r = 0, c = 0;
+        T v = T(1);
+        if(!parse_uint(p, r) || !parse_uint(p, c)) return false;
+        if(!fmt.pattern && !parse_value(p, last, num, v, is_int{})) return false;
+        if(r < 1 || c < 1 || r > rows || c > cols) return false;
+        --r; --c;
+
+        ++count;
+        out.push_back(crs_triplet<T>{r, c, v});
+        if(fmt.symmetric && r != c) {
+            out.push_back(crs_triplet<T>{c, r, fmt.skew ? T(-v) : v});
+        }
+        while(p < last && *p != '\n') ++p;
+    }
+    return true;
+}
+
+
+}  // namespace crs_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief reads a sparse matrix in Matrix Market coordinate format
+ *        (real/integer/pattern; general/symmetric/skew-symmetric)
+ *
+ * @details The file is read in chunks of 'chunkSize' bytes; each chunk is
+ *          split at line boundaries and parsed by 'numThreads' threads
+ *          (0 => hardware concurrency). All entries are collected and
+ *          handed to Matrix::from_triplets; duplicates are combined with
+ *          'combine'.
+ *
+ * @tparam Matrix  crs_matrix type
+ *
+ *****************************************************************************/
+template<class Matrix, class Combine = crs_keep_last>
+Matrix
+read_matrix_market(std::istream& is, int numThreads = 1,
+                   Combine combine = Combine{},
+                   std::size_t chunkSize = (std::size_t(1) << 22))
+{
+    using value_type = typename Matrix::value_type;
+    using triplet    = crs_triplet<value_type>;
+
+    std::string line;
+    if(!std::getline(is, line))
+        throw crs_matrix_io_error{"matrix market: empty input"};
+
+    const auto fmt = crs_detail::parse_matrix_market_banner(line);
+
+    //skip comments up to size line
+    while(std::getline(is, line)) {
+        if(!line.empty() && line[0] != '%' &&
+           line.find_first_not_of(" \t\r") != std::string::npos) break;
+    }
+    std::size_t rows = 0, cols = 0, nnz = 0;
+    {
+        const char* p = line.c_str();
+        if(!crs_detail::parse_uint(p, rows) ||
+           !crs_detail::parse_uint(p, cols) ||
+           !crs_detail::parse_uint(p, nnz))
+        {
+            throw crs_matrix_io_error{"matrix market: invalid size line"};
+        }
+    }
+
+    numThreads = effective_thread_count(numThreads);
+    if(chunkSize < 64) chunkSize = 64;
+
+    auto triplets = std::vector<triplet>{};
+    triplets.reserve(fmt.symmetric ? 2 * nnz : nnz);
+
+    auto parts = std::vector<std::vector<triplet>>(std::size_t(numThreads));
+    auto counts = std::vector<std::size_t>(std::size_t(numThreads), 0);
+    std::size_t entries = 0;
+    auto buf = std::vector<char>{};
+    std::size_t carry = 0;
+
+    while(is) {
+        buf.resize(carry + chunkSize + 1);
+        is.read(buf.data() + carry, std::streamsize(chunkSize));
+        auto len = carry + std::size_t(is.gcount());
+        if(len < 1) break;
+
+        //only parse complete lines; keep the rest for the next chunk
+        auto end = len;
+        if(is) {
+            while(end > 0 && buf[end-1] != '\n') --end;
+            if(end == 0) {
+                //line longer than chunk
+                carry = len;
+                chunkSize *= 2;
+                continue;
+            }
+        }
+        //sentinel for the parsers
+        const char saved = buf[end];
+        buf[end] = '\0';
+
+        //split at line boundaries
+        auto bounds = uniform_partition(std::size_t(0), end, numThreads);
+        for(std::size_t i = 1; i + 1 < bounds.size(); ++i) {
+            auto b = std::max(bounds[i], bounds[i-1]);
+            while(b < end && buf[b-1] != '\n') ++b;
+            bounds[i] = b;
+        }
+
+        auto ok = std::vector<char>(bounds.size(), 1);
+        parallel_for_blocks(bounds,
+            [&](std::size_t b, std::size_t e, int part) {
+                auto& out = parts[std::size_t(part)];
+                out.clear();
+                ok[std::size_t(part)] = char(
+                    crs_detail::parse_matrix_market_entries(
+                        buf.data() + b, buf.data() + e, fmt, rows, cols, out,
+                        counts[std::size_t(part)]));
+            });
+
+        for(std::size_t i = 0; i + 1 < bounds.size(); ++i) {
+            if(!ok[i]) throw crs_matrix_io_error{"matrix market: invalid entry"};
+            entries += counts[i];
+            if(entries > nnz) {
+                throw crs_matrix_io_error{"matrix market: more entries than "
+                                          "declared in the size line"};
+            }
+            triplets.insert(triplets.end(), parts[i].begin(), parts[i].end());
+        }
+
+        buf[end] = saved;
+        carry = len - end;
+        std::copy(buf.begin() + std::ptrdiff_t(end),
+                  buf.begin() + std::ptrdiff_t(len), buf.begin());
+    }
+
+    if(entries < nnz) {
+        throw crs_matrix_io_error{"matrix market: fewer entries than "
+                                  "declared in the size line"};
+    }
+
+    auto m = Matrix::from_triplets(triplets.begin(), triplets.end(),
+                                   combine, numThreads);
+    if(m.rows() < rows) m.rows(typename Matrix::size_type(rows));
+    m.cols(typename Matrix::size_type(cols));
+    return m;
+}
+
+//-------------------------------------------------------------------
+template<class Matrix, class Combine = crs_keep_last>
+Matrix
+read_matrix_market(const std::string& filename, int numThreads = 1,
+                   Combine combine = Combine{})
+{
+    std::ifstream is{filename, std::ios::in | std::ios::binary};
+    if(!is) throw crs_matrix_io_error{"matrix market: could not open " + filename};
+    return read_matrix_market<Matrix>(is, numThreads, combine);
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief writes matrix in Matrix Market coordinate format (general);
+ *        entries are formatted directly from the CRS arrays into
+ *        an output buffer that is flushed in large blocks
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO>
+void
+write_matrix_market(std::ostream& os, const crs_matrix<T,NA,A,CI,RO>& m)
+{
+    using is_int = std::integral_constant<bool,std::is_integral<T>::value>;
+
+    os << "%%MatrixMarket matrix coordinate "
+       << (is_int::value ? "integer" : "real") << " general\n"
+       << m.rows() << ' ' << m.cols() << ' ' << m.size() << '\n';
+
+    constexpr std::size_t flushSize = std::size_t(1) << 16;
+    auto buf = std::string{};
+    buf.reserve(flushSize + 128);
+
+    char num[64];
+    crs_detail::classic_float_format fpfmt;
+
+    const auto append_uint = [&](std::size_t x) {
+        char* e = num + sizeof(num);
+        char* p = e;
+        do { *--p = char('0' + (x % 10)); x /= 10; } while(x > 0);
+        buf.append(p, std::size_t(e - p));
+    };
+    const auto append_value = [&](const T& v) {
+        if(is_int::value) {
+            const int n = std::snprintf(num, sizeof(num), "%lld",
+                                        static_cast<long long>(v));
+            if(n > 0) buf.append(num, std::size_t(n));
+        } else {
+            //not snprintf: must not depend on the global locale
+            const auto e = fpfmt.format(num, static_cast<double>(v));
+            buf.append(num, std::size_t(e - num));
+        }
+    };
+
+    const auto values = m.data();
+    const auto colidx = m.col_index_data();
+    const auto rowbeg = m.row_offset_data();
+
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        for(auto i = std::size_t(rowbeg[r]); i < std::size_t(rowbeg[r+1]); ++i) {
+            append_uint(r + 1);
+            buf += ' ';
+            append_uint(std::size_t(colidx[i]) + 1);
+            buf += ' ';
+            append_value(values[i]);
+            buf += '\n';
+            if(buf.size() >= flushSize) {
+                os.write(buf.data(), std::streamsize(buf.size()));
+                buf.clear();
+            }
+        }
+    }
+    os.write(buf.data(), std::streamsize(buf.size()));
+
+    if(!os) throw crs_matrix_io_error{"matrix market: write failed"};
+}
+
+//-------------------------------------------------------------------
+template<class T, class NA, class A, class CI, class RO>
+void
+write_matrix_market(const std::string& filename,
+                    const crs_matrix<T,NA,A,CI,RO>& m)
+{
+    std::ofstream os{filename, std::ios::out | std::ios::binary};
+    if(!os) throw crs_matrix_io_error{"matrix market: could not open " + filename};
+    write_matrix_market(os, m);
+}
+
+
+}  // namespace am
+
+
+#endif
@@ -0,0 +1,304 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_CRS_MATRIX_REORDERING_H_
+#define AMLIB_CONTAINERS_CRS_MATRIX_REORDERING_H_
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#include "crs_matrix.h"
+
+
+namespace am {
+
+
+/*************************************************************************//***
+ *
+ * @brief bandwidth and profile (envelope size) of a sparse matrix
+ *
+ * @details bandwidth: max |row - col| over all stored elements
+ *          profile:   sum over all rows r of (r - first column in row r)
+ *                     (only rows whose first column is < r contribute)
+ *
+ *****************************************************************************/
+struct crs_band_info
+{
+    std::size_t bandwidth = 0;
+    std::size_t profile = 0;
+};
+
+
+//-------------------------------------------------------------------
+template<class T, class NA, class A, class CI, class RO>
+crs_band_info
+band_info(const crs_matrix<T,NA,A,CI,RO>& m)
+{
+    const auto col = m.col_index_data();
+    const auto beg = m.row_offset_data();
+
+    crs_band_info info;
+    for(std::size_t r = 0, n = m.rows(); r < n; ++r) {
+        if(beg[r] == beg[r+1]) continue;
+        //columns are sorted => first and last element are the extremes
+        const auto first = std::size_t(col[beg[r]]);
+        const auto last  = std::size_t(col[beg[r+1] - 1]);
+        if(first < r) {
+            info.profile += r - first;
+            info.bandwidth = std::max(info.bandwidth, r - first);
+        }
+        if(last > r) {
+            info.bandwidth = std::max(info.bandwidth, last - r);
+        }
+    }
+    return info;
+}
+
+
+
+namespace crs_detail {
+
+/*****************************************************************************
+ *
+ * @brief symmetric adjacency structure of the pattern of A + A^T
+ *        (without self loops)
+ *
+ *****************************************************************************/
+class symmetric_graph
+{
+public:
+    template<class T, class NA, class A, class CI, class RO>
+    explicit
+    symmetric_graph(const crs_matrix<T,NA,A,CI,RO>& m):
+        beg_{}, adj_{}
+    {
+        const auto n = std::max(m.rows(), m.cols());
+        const auto col = m.col_index_data();
+        const auto rbeg = m.row_offset_data();
+
+        //count edges in both directions
+        beg_.assign(n + 1, 0);
+        for(std::size_t r = 0, nr = m.rows(); r < nr; ++r) {
+            for(auto k = std::size_t(rbeg[r]); k < std::size_t(rbeg[r+1]); ++k) {
+                const auto c = std::size_t(col[k]);
+                if(c != r) { ++beg_[r+1]; ++beg_[c+1]; }
+            }
+        }
+        std::partial_sum(beg_.begin(), beg_.end(), beg_.begin());
+
+        adj_.resize(beg_[n]);
+        auto pos = std::vector<std::size_t>(beg_.begin(), beg_.end() - 1);
+        for(std::size_t r = 0, nr = m.rows(); r < nr; ++r) {
+            for(auto k = std::size_t(rbeg[r]); k < std::size_t(rbeg[r+1]); ++k) {
+                const auto c = std::size_t(col[k]);
+                if(c != r) {
+                    adj_[pos[r]++] = c;
+                    adj_[pos[c]++] = r;
+                }
+            }
+        }
+
+        //sort & remove duplicates (entries present in A and A^T)
+        std::size_t w = 0;
+        for(std::size_t v = 0; v < n; ++v) {
+            const auto b = adj_.begin() + std::ptrdiff_t(beg_[v]);
+            const auto e = adj_.begin() + std::ptrdiff_t(beg_[v+1]);
+            std::sort(b, e);
+            const auto u = std::unique(b, e);
+            beg_[v] = w;
+            w = std::size_t(std::copy(b, u, adj_.begin() + std::ptrdiff_t(w)) - adj_.begin());
+        }
+        beg_[n] = w;
+        adj_.resize(w);
+    }
+
+    std::size_t size() const noexcept { return beg_.size() - 1; }
+
+    std::size_t degree(std::size_t v) const noexcept {
+        return beg_[v+1] - beg_[v];
+    }
+    const std::size_t* begin(std::size_t v) const noexcept {
+        return adj_.data() + beg_[v];
+    }
+    const std::size_t* end(std::size_t v) const noexcept {
+        return adj_.data() + beg_[v+1];
+    }
+
+private:
+    std::vector<std::size_t> beg_;
+    std::vector<std::size_t> adj_;
+};
+
+
+//-------------------------------------------------------------------
+/**
+ * @brief breadth-first level structure rooted at 'root';
+ *        nodes of the component in BFS order are appended to 'order'
+ *        (neighbors in ascending degree order)
+ * @return number of levels
+ */
+inline std::size_t
+bfs_levels(const symmetric_graph& g, std::size_t root,
+           std::vector<std::size_t>& level, std::vector<std::size_t>& order)
+{
+    constexpr auto unvisited = std::size_t(-1);
+
+    const auto first = order.size();
+    order.push_back(root);
+    level[root] = 0;
+    std::size_t depth = 0;
+
+    auto nbs = std::vector<std::size_t>{};
+    for(auto i = first; i < order.size(); ++i) {
+        const auto v = order[i];
+        nbs.clear();
+        for(auto p = g.begin(v); p != g.end(v); ++p) {
+            if(level[*p] == unvisited) {
+                level[*p] = level[v] + 1;
+                nbs.push_back(*p);
+            }
+        }
+        std::sort(nbs.begin(), nbs.end(), [&](std::size_t a, std::size_t b) {
+            return g.degree(a) < g.degree(b);
+        });
+        order.insert(order.end(), nbs.begin(), nbs.end());
+        depth = std::max(depth, level[v] + 1);
+    }
+    return depth;
+}
+
+}  // namespace crs_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief Reverse Cuthill-McKee ordering of the pattern of A + A^T
+ *
+ * @details every connected component is started from a pseudo-peripheral
+ *          node (George-Liu heuristic); non-square matrices are treated
+ *          as square matrices of size max(rows,cols)
+ *
+ * @return  permutation p with p[i] = old index of new row/column i
+ *          (can be passed to crs_matrix::permute)
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO>
+std::vector<std::size_t>
+reverse_cuthill_mckee(const crs_matrix<T,NA,A,CI,RO>& m)
+{
+    constexpr auto unvisited = std::size_t(-1);
+
+    const auto g = crs_detail::symmetric_graph{m};
+    const auto n = g.size();
+
+    //candidate roots in ascending degree order
+    auto byDegree = std::vector<std::size_t>(n);
+    std::iota(byDegree.begin(), byDegree.end(), std::size_t(0));
+    std::stable_sort(byDegree.begin(), byDegree.end(),
+        [&](std::size_t a, std::size_t b) { return g.degree(a) < g.degree(b); });
+
+    auto level = std::vector<std::size_t>(n, unvisited);
+    auto order = std::vector<std::size_t>{};
+    order.reserve(n);
+    auto probe = std::vector<std::size_t>{};
+
+    for(const auto start : byDegree) {
+        if(level[start] != unvisited) continue;
+
+        //find pseudo-peripheral root: restart from a min. degree node
+        //of the last level as long as the number of levels grows
+        auto root = start;
+        std::size_t depth = 0;
+        for(int iter = 0; iter < 8; ++iter) {
+            probe.clear();
+            const auto d = crs_detail::bfs_levels(g, root, level, probe);
+
+            auto next = root;
+            auto minDeg = unvisited;
+            for(auto v : probe) {
+                if(level[v] + 1 == d && g.degree(v) < minDeg) {
+                    minDeg = g.degree(v);
+                    next = v;
+                }
+            }
+            for(auto v : probe) level[v] = unvisited;
+
+            if(iter > 0 && d <= depth) break;
+            depth = d;
+            if(next == root) break;
+            root = next;
+        }
+
+        crs_detail::bfs_levels(g, root, level, order);
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief result of a reordering
+ *
+ *****************************************************************************/
+struct crs_reordering_result
+{
+    std::vector<std::size_t> row_permutation;
+    std::vector<std::size_t> col_permutation;
+    crs_band_info before;
+    crs_band_info after;
+};
+
+
+
+/*************************************************************************//***
+ *
+ * @brief applies a Reverse Cuthill-McKee ordering to rows and columns of 'm'
+ *
+ * @return the row and column permutations as well as bandwidth and
+ *         profile before and after the reordering
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO>
+crs_reordering_result
+reorder_rcm(crs_matrix<T,NA,A,CI,RO>& m)
+{
+    crs_reordering_result res;
+    res.before = band_info(m);
+
+    const auto perm = reverse_cuthill_mckee(m);
+
+    //drop indices beyond the row/column range of non-square matrices
+    const auto rows = m.rows();
+    const auto cols = m.cols();
+    res.row_permutation.reserve(rows);
+    res.col_permutation.reserve(cols);
+    for(auto i : perm) {
+        if(i < rows) res.row_permutation.push_back(i);
+        if(i < cols) res.col_permutation.push_back(i);
+    }
+
+    m.permute(res.row_permutation, res.col_permutation);
+
+    res.after = band_info(m);
+    return res;
+}
+
+
+}  // namespace am
+
+
+#endif
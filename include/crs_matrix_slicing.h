@@ -0,0 +1,337 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_CRS_MATRIX_SLICING_H_
+#define AMLIB_CONTAINERS_CRS_MATRIX_SLICING_H_
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "crs_matrix.h"
+#include "crs_search.h"
+
+
+namespace am {
+
+
+/*************************************************************************//***
+ *
+ * @brief non-owning, read-only view of the contiguous row range
+ *        [first,last) of a crs_matrix
+ *
+ * @details values and column indices are shared with the viewed matrix;
+ *          row offsets are rebased on the fly, so row 0 of the slice
+ *          starts at offset 0 of data() / col_index_data();
+ *          the view is invalidated by any modification of the matrix
+ *
+ *****************************************************************************/
+template<class Matrix>
+class crs_row_slice
+{
+public:
+    //---------------------------------------------------------------
+    using matrix_type     = Matrix;
+    using value_type      = typename Matrix::value_type;
+    using size_type       = typename Matrix::size_type;
+    using col_index_type  = typename Matrix::col_index_type;
+    using row_offset_type = typename Matrix::row_offset_type;
+    using const_iterator  = const value_type*;
+    using col_index_iterator = const col_index_type*;
+
+
+    //---------------------------------------------------------------
+    crs_row_slice() noexcept:
+        val_{nullptr}, col_{nullptr}, beg_{nullptr}, first_{0}, rows_{0}, cols_{0}
+    {}
+
+    //-----------------------------------------------------
+    /// @brief view of rows [first,last); the range is clamped to m.rows()
+    crs_row_slice(const Matrix& m, size_type first, size_type last) noexcept:
+        crs_row_slice{}
+    {
+        if(last > m.rows()) last = m.rows();
+        if(first >= last) return;
+        beg_   = m.row_offset_data() + first;
+        val_   = m.data() + beg_[0];
+        col_   = m.col_index_data() + beg_[0];
+        first_ = first;
+        rows_  = last - first;
+        cols_  = m.cols();
+    }
+
+
+    //---------------------------------------------------------------
+    // SIZE PROPERTIES
+    //---------------------------------------------------------------
+    size_type rows() const noexcept { return rows_; }
+    size_type cols() const noexcept { return cols_; }
+
+    /// @brief index of the first viewed row in the underlying matrix
+    size_type first_row() const noexcept { return first_; }
+
+    /// @return number of stored elements in the viewed rows
+    size_type size() const noexcept {
+        return rows_ > 0 ? size_type(beg_[rows_] - beg_[0]) : 0;
+    }
+
+    bool empty() const noexcept { return size() < 1; }
+
+
+    //---------------------------------------------------------------
+    // ROW PROPERTIES
+    //---------------------------------------------------------------
+    /// @return offset of row r relative to the first viewed element
+    size_type row_offset(size_type r) const noexcept {
+        return size_type(beg_[r] - beg_[0]);
+    }
+
+    size_type row_size(size_type r) const noexcept {
+        return size_type(beg_[r+1] - beg_[r]);
+    }
+
+    bool row_empty(size_type r) const noexcept {
+        return row_size(r) < 1;
+    }
+
+
+    //---------------------------------------------------------------
+    // ELEMENT ACCESS
+    //---------------------------------------------------------------
+    bool
+    has(size_type r, size_type c) const noexcept {
+        if(r >= rows_ || c >= cols_) return false;
+        const auto b = begin_col_indices(r);
+        const auto e = end_col_indices(r);
+        const auto it = adaptive_lower_bound(b, e, col_index_type(c));
+        return it != e && size_type(*it) == c;
+    }
+
+    //-----------------------------------------------------
+    /// @return stored value or the n/a value of the matrix type
+    value_type
+    operator () (size_type r, size_type c) const noexcept {
+        if(r >= rows_ || c >= cols_) return Matrix::na_value();
+        const auto b = begin_col_indices(r);
+        const auto e = end_col_indices(r);
+        const auto it = adaptive_lower_bound(b, e, col_index_type(c));
+        return (it != e && size_type(*it) == c)
+            ? val_[it - col_] : Matrix::na_value();
+    }
+
+
+    //---------------------------------------------------------------
+    // RAW DATA ACCESS
+    //---------------------------------------------------------------
+    const value_type*     data()           const noexcept { return val_; }
+    const col_index_type* col_index_data() const noexcept { return col_; }
+
+
+    //---------------------------------------------------------------
+    // ITERATORS
+    //---------------------------------------------------------------
+    const_iterator begin() const noexcept { return val_; }
+    const_iterator end()   const noexcept { return val_ + size(); }
+
+    //-----------------------------------------------------
+    const_iterator
+    begin_row(size_type r) const noexcept {
+        return val_ + row_offset(r);
+    }
+    const_iterator
+    end_row(size_type r) const noexcept {
+        return val_ + row_offset(r+1);
+    }
+
+    //-----------------------------------------------------
+    col_index_iterator
+    begin_col_indices(size_type r) const noexcept {
+        return col_ + row_offset(r);
+    }
+    col_index_iterator
+    end_col_indices(size_type r) const noexcept {
+        return col_ + row_offset(r+1);
+    }
+
+    //-----------------------------------------------------
+    size_type
+    col_index_of(const_iterator it) const noexcept {
+        return size_type(col_[it - val_]);
+    }
+
+
+    //---------------------------------------------------------------
+    /// @return deep copy of the viewed rows
+    Matrix
+    to_crs_matrix() const
+    {
+        const auto nnz = size();
+        auto values = typename Matrix::value_storage(val_, val_ + nnz);
+        auto colidx = typename Matrix::col_index_storage(col_, col_ + nnz);
+        auto rowbeg = typename Matrix::row_offset_storage(rows_ + 1,
+                                                          row_offset_type(0));
+        for(size_type r = 1; r <= rows_; ++r) {
+            rowbeg[r] = row_offset_type(row_offset(r));
+        }
+        auto m = Matrix{std::move(values), std::move(colidx), std::move(rowbeg)};
+        m.cols(cols_);
+        return m;
+    }
+
+
+private:
+    const value_type* val_;
+    const col_index_type* col_;
+    const row_offset_type* beg_;
+    size_type first_;
+    size_type rows_;
+    size_type cols_;
+};
+
+
+
+//-------------------------------------------------------------------
+/// @brief view of the rows [first,last) of m (clamped to m.rows())
+template<class T, class NA, class A, class CI, class RO>
+inline crs_row_slice<crs_matrix<T,NA,A,CI,RO>>
+row_slice(const crs_matrix<T,NA,A,CI,RO>& m, std::size_t first, std::size_t last)
+{
+    return crs_row_slice<crs_matrix<T,NA,A,CI,RO>>{m, first, last};
+}
+
+
+
+namespace crs_detail {
+
+//-------------------------------------------------------------------
+/// @brief storage offsets [lo,hi) of the elements of row r
+///        with columns in [firstCol,lastCol)
+template<class T, class NA, class A, class CI, class RO>
+inline std::pair<std::size_t,std::size_t>
+col_window(const crs_matrix<T,NA,A,CI,RO>& m, std::size_t r,
+           std::size_t firstCol, std::size_t lastCol) noexcept
+{
+    if(r >= m.rows() || firstCol >= lastCol) return {0, 0};
+
+    const auto col = m.col_index_data();
+    const auto beg = m.row_offset_data();
+    const auto b = col + beg[r];
+    const auto e = col + beg[r+1];
+    //keys beyond the last column might not be representable by CI
+    if(b == e || firstCol > std::size_t(*(e-1))) return {0, 0};
+
+    const auto lo = (firstCol > std::size_t(*b))
+                  ? adaptive_lower_bound(b, e, CI(firstCol)) : b;
+    const auto hi = (lastCol > std::size_t(*(e-1)))
+                  ? e : adaptive_lower_bound(lo, e, CI(lastCol));
+
+    return {std::size_t(lo - col), std::size_t(hi - col)};
+}
+
+
+//-------------------------------------------------------------------
+/// @brief copies the storage windows of all rows into a new matrix
+template<class T, class NA, class A, class CI, class RO>
+crs_matrix<T,NA,A,CI,RO>
+extract_windows(const crs_matrix<T,NA,A,CI,RO>& m,
+                const std::vector<std::pair<std::size_t,std::size_t>>& window,
+                std::size_t firstCol, std::size_t lastCol)
+{
+    using matrix_t = crs_matrix<T,NA,A,CI,RO>;
+
+    const auto nrows = window.size();
+    auto rowbeg = typename matrix_t::row_offset_storage(nrows + 1, RO(0));
+    for(std::size_t i = 0; i < nrows; ++i) {
+        rowbeg[i+1] = rowbeg[i] + RO(window[i].second - window[i].first);
+    }
+
+    const auto nnz = std::size_t(rowbeg[nrows]);
+    auto values = typename matrix_t::value_storage(nnz);
+    auto colidx = typename matrix_t::col_index_storage(nnz);
+
+    const auto val = m.data();
+    const auto col = m.col_index_data();
+
+    for(std::size_t i = 0; i < nrows; ++i) {
+        auto o = std::size_t(rowbeg[i]);
+        for(auto j = window[i].first; j < window[i].second; ++j, ++o) {
+            values[o] = val[j];
+            colidx[o] = CI(std::size_t(col[j]) - firstCol);
+        }
+    }
+
+    auto s = matrix_t{std::move(values), std::move(colidx), std::move(rowbeg)};
+    s.cols(lastCol > firstCol ? lastCol - firstCol : 0);
+    return s;
+}
+
+}  // namespace crs_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief copies the elements of the rows in [rowFirst,rowLast) and the
+ *        columns [firstCol,lastCol) into a new matrix
+ *
+ * @param  rowFirst,rowLast  range of row indices (any order, duplicates
+ *                           allowed); row i of the result is row
+ *                           *(rowFirst+i) of m; indices >= m.rows()
+ *                           yield empty rows
+ *
+ * @details column indices of the result are relative to firstCol;
+ *          the window of every row is located by binary search
+ *          (so cost is O(log(row length) + window size) per row);
+ *          the result is allocated exactly once
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO, class ForwardIterator>
+crs_matrix<T,NA,A,CI,RO>
+extract_rows(const crs_matrix<T,NA,A,CI,RO>& m,
+             ForwardIterator rowFirst, ForwardIterator rowLast,
+             std::size_t firstCol, std::size_t lastCol)
+{
+    auto window = std::vector<std::pair<std::size_t,std::size_t>>{};
+    window.reserve(std::size_t(std::distance(rowFirst, rowLast)));
+    for(; rowFirst != rowLast; ++rowFirst) {
+        window.push_back(crs_detail::col_window(
+            m, std::size_t(*rowFirst), firstCol, lastCol));
+    }
+    return crs_detail::extract_windows(m, window, firstCol, lastCol);
+}
+
+
+//-------------------------------------------------------------------
+/// @brief copy of the block [firstRow,lastRow) x [firstCol,lastCol);
+///        the row range is clamped to m.rows()
+template<class T, class NA, class A, class CI, class RO>
+crs_matrix<T,NA,A,CI,RO>
+submatrix(const crs_matrix<T,NA,A,CI,RO>& m,
+          std::size_t firstRow, std::size_t lastRow,
+          std::size_t firstCol, std::size_t lastCol)
+{
+    if(lastRow > m.rows()) lastRow = m.rows();
+    if(firstRow > lastRow) firstRow = lastRow;
+
+    auto window = std::vector<std::pair<std::size_t,std::size_t>>{};
+    window.reserve(lastRow - firstRow);
+    for(auto r = firstRow; r < lastRow; ++r) {
+        window.push_back(crs_detail::col_window(m, r, firstCol, lastCol));
+    }
+    return crs_detail::extract_windows(m, window, firstCol, lastCol);
+}
+
+
+}  // namespace am
+
+
+#endif
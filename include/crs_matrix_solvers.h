@@ -0,0 +1,843 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_CRS_MATRIX_SOLVERS_H_
+#define AMLIB_CONTAINERS_CRS_MATRIX_SOLVERS_H_
+
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "crs_matrix.h"
+#include "crs_matrix_algorithms.h"
+#include "parallel.h"
+
+
+namespace am {
+
+
+/*****************************************************************************
+ *
+ * EXCEPTIONS
+ *
+ *****************************************************************************/
+struct crs_solver_error :
+    public std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+
+
+/*************************************************************************//***
+ *
+ * @brief iterative solver settings
+ *
+ *****************************************************************************/
+struct solver_settings
+{
+    std::size_t max_iterations = 1000;
+    /// @brief stop if ||r|| <= tolerance * ||b||
+    double tolerance = 1e-8;
+    /// @brief 1 => serial; 0 => hardware concurrency
+    int num_threads = 1;
+};
+
+
+
+/*************************************************************************//***
+ *
+ * @brief iterative solver statistics
+ *
+ * @details timings are wall clock seconds per phase:
+ *          setup:          workspace preparation and initial residual
+ *          spmv:           matrix-vector products (incl. fused dot products)
+ *          preconditioner: preconditioner applications that could not be
+ *                          fused into vector updates
+ *          vector:         fused vector updates and dot products
+ *
+ *****************************************************************************/
+struct solver_stats
+{
+    std::size_t iterations = 0;
+    bool converged = false;
+    /// @brief final ||r|| / ||b|| (recursively updated residual)
+    double residual = 0;
+    double setup_seconds = 0;
+    double spmv_seconds = 0;
+    double preconditioner_seconds = 0;
+    double vector_seconds = 0;
+    double total_seconds = 0;
+};
+
+
+
+/*************************************************************************//***
+ *
+ * @brief no preconditioning (z = r)
+ *
+ * @details Preconditioners with 'pointwise == true' provide
+ *          apply(i, r_i) so that applying them can be fused into the
+ *          vector updates of a solver; all preconditioners provide
+ *          apply(r, z, n) which computes z = M^-1 * r for n values.
+ *
+ *****************************************************************************/
+struct identity_preconditioner
+{
+    static constexpr bool pointwise = true;
+
+    template<class T>
+    T apply(std::size_t, const T& r) const noexcept { return r; }
+
+    template<class T>
+    void apply(const T* r, T* z, std::size_t n) const noexcept {
+        std::copy(r, r + n, z);
+    }
+};
+
+
+
+/*************************************************************************//***
+ *
+ * @brief Jacobi (diagonal) preconditioner  z = D^-1 * r
+ *
+ *****************************************************************************/
+template<class ValueType>
+class jacobi_preconditioner
+{
+public:
+    using value_type = ValueType;
+
+    static constexpr bool pointwise = true;
+
+    //---------------------------------------------------------------
+    /** @throws crs_solver_error if a diagonal element is zero or missing */
+    template<class NA, class A, class CI, class RO>
+    explicit
+    jacobi_preconditioner(const crs_matrix<value_type,NA,A,CI,RO>& m):
+        invdiag_(m.rows())
+    {
+        const auto val = m.data();
+        const auto col = m.col_index_data();
+        const auto beg = m.row_offset_data();
+
+        for(std::size_t r = 0; r < invdiag_.size(); ++r) {
+            const auto b = col + beg[r];
+            const auto e = col + beg[r+1];
+            const auto p = std::lower_bound(b, e, CI(r));
+            if(p == e || std::size_t(*p) != r || val[p - col] == value_type(0)) {
+                throw crs_solver_error{
+                    "jacobi_preconditioner: zero or missing diagonal element"};
+            }
+            invdiag_[r] = value_type(1) / val[p - col];
+        }
+    }
+
+    //---------------------------------------------------------------
+    value_type
+    apply(std::size_t i, const value_type& r) const noexcept {
+        return invdiag_[i] * r;
+    }
+
+    void
+    apply(const value_type* r, value_type* z, std::size_t n) const noexcept {
+        for(std::size_t i = 0; i < n; ++i) z[i] = invdiag_[i] * r[i];
+    }
+
+private:
+    std::vector<value_type> invdiag_;
+};
+
+
+
+/*************************************************************************//***
+ *
+ * @brief incomplete LU factorization without fill-in (ILU(0))
+ *
+ * @details L (unit lower) and U share the sparsity pattern of A;
+ *          the factorization is computed from the CRS arrays of A in one
+ *          row-by-row (IKJ) pass that merges sorted column index lists;
+ *          apply() performs a forward and a backward substitution
+ *
+ *****************************************************************************/
+template<class ValueType>
+class ilu0_preconditioner
+{
+public:
+    using value_type = ValueType;
+
+    static constexpr bool pointwise = false;
+
+    //---------------------------------------------------------------
+    /** @throws crs_solver_error if a pivot is zero or missing */
+    template<class NA, class A, class CI, class RO>
+    explicit
+    ilu0_preconditioner(const crs_matrix<value_type,NA,A,CI,RO>& m):
+        lu_(m.data(), m.data() + m.size()),
+        col_(m.col_index_data(), m.col_index_data() + m.size()),
+        beg_(m.row_offset_data(), m.row_offset_data() + m.rows() + 1),
+        diag_(m.rows())
+    {
+        const auto n = m.rows();
+
+        for(std::size_t i = 0; i < n; ++i) {
+            const auto b = col_.begin() + std::ptrdiff_t(beg_[i]);
+            const auto e = col_.begin() + std::ptrdiff_t(beg_[i+1]);
+            const auto p = std::lower_bound(b, e, i);
+            if(p == e || *p != i) {
+                throw crs_solver_error{
+                    "ilu0_preconditioner: missing diagonal element"};
+            }
+            diag_[i] = std::size_t(p - col_.begin());
+        }
+
+        for(std::size_t i = 0; i < n; ++i) {
+            //eliminate with all rows k < i present in row i
+            for(auto p = beg_[i]; p < diag_[i]; ++p) {
+                const auto k = col_[p];
+                const auto pivot = lu_[diag_[k]];
+                if(pivot == value_type(0)) {
+                    throw crs_solver_error{"ilu0_preconditioner: zero pivot"};
+                }
+                const auto l = lu_[p] / pivot;
+                lu_[p] = l;
+
+                //row i -= l * (upper part of row k); pattern of row i only
+                auto q = p + 1;
+                auto s = diag_[k] + 1;
+                while(q < beg_[i+1] && s < beg_[k+1]) {
+                    if(col_[q] < col_[s])      ++q;
+                    else if(col_[s] < col_[q]) ++s;
+                    else {
+                        lu_[q] -= l * lu_[s];
+                        ++q; ++s;
+                    }
+                }
+            }
+            if(lu_[diag_[i]] == value_type(0)) {
+                throw crs_solver_error{"ilu0_preconditioner: zero pivot"};
+            }
+        }
+    }
+
+    //---------------------------------------------------------------
+    /// @brief z = (LU)^-1 * r; n has to be equal to the matrix size
+    void
+    apply(const value_type* r, value_type* z, std::size_t n) const noexcept
+    {
+        //L y = r  (unit diagonal)
+        for(std::size_t i = 0; i < n; ++i) {
+            auto sum = r[i];
+            for(auto p = beg_[i]; p < diag_[i]; ++p) {
+                sum -= lu_[p] * z[col_[p]];
+            }
+            z[i] = sum;
+        }
+        //U z = y
+        for(std::size_t i = n; i > 0; --i) {
+            const auto row = i - 1;
+            auto sum = z[row];
+            for(auto p = diag_[row] + 1; p < beg_[row+1]; ++p) {
+                sum -= lu_[p] * z[col_[p]];
+            }
+            z[row] = sum / lu_[diag_[row]];
+        }
+    }
+
+private:
+    std::vector<value_type> lu_;
+    std::vector<std::size_t> col_;
+    std::vector<std::size_t> beg_;
+    std::vector<std::size_t> diag_;
+};
+
+
+
+namespace crs_detail {
+
+//-------------------------------------------------------------------
+template<class T>
+struct fused_sums {
+    T a = T(0);
+    T b = T(0);
+};
+
+//-------------------------------------------------------------------
+template<class P, class T>
+inline T
+precondition_point(const P& m, std::size_t i, const T& r, std::true_type) {
+    return m.apply(i, r);
+}
+template<class P, class T>
+inline T
+precondition_point(const P&, std::size_t, const T& r, std::false_type) {
+    return r;
+}
+
+//-------------------------------------------------------------------
+inline double
+seconds_since(std::chrono::steady_clock::time_point t) noexcept
+{
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - t).count();
+}
+
+
+/*****************************************************************************
+ *
+ * @brief runs fused kernels on fixed row blocks and sums up
+ *        per-block partial results
+ *
+ * @details The row blocks and the partial result slots are reused, but
+ *          each parallel kernel call is a fork-join via
+ *          parallel_for_blocks, which allocates a vector of std::thread
+ *          and starts and joins one thread per block.
+ *
+ *****************************************************************************/
+template<class T>
+class solver_workspace
+{
+protected:
+    template<class Offset>
+    void
+    partition(const Offset* rowOffsets, std::size_t n, int numThreads)
+    {
+        numThreads = effective_thread_count(numThreads);
+        if(numThreads < 2) {
+            bounds_.assign({std::size_t(0), n});
+        } else {
+            bounds_ = weighted_partition(rowOffsets, n, numThreads);
+        }
+        partial_.resize(bounds_.size() - 1);
+    }
+
+    //---------------------------------------------------------------
+    /// @brief f(first,last) -> fused_sums<T> on each row block
+    template<class Function>
+    fused_sums<T>
+    reduce(Function&& f)
+    {
+        if(bounds_.size() < 3) return f(bounds_.front(), bounds_.back());
+
+        parallel_for_blocks(bounds_,
+            [&](std::size_t first, std::size_t last, int part) {
+                partial_[std::size_t(part)] = f(first, last);
+            });
+
+        fused_sums<T> s;
+        for(const auto& p : partial_) { s.a += p.a; s.b += p.b; }
+        return s;
+    }
+
+    //---------------------------------------------------------------
+    /// @brief f(first,last) on each row block
+    template<class Function>
+    void
+    for_each_block(Function&& f)
+    {
+        if(bounds_.size() < 3) {
+            f(bounds_.front(), bounds_.back());
+            return;
+        }
+        parallel_for_blocks(bounds_,
+            [&](std::size_t first, std::size_t last, int) { f(first, last); });
+    }
+
+    //---------------------------------------------------------------
+    template<class NA, class A, class CI, class RO>
+    static void
+    check_square(const crs_matrix<T,NA,A,CI,RO>& m)
+    {
+        if(m.rows() != m.cols()) {
+            throw crs_solver_error{"solver: matrix has to be square"};
+        }
+    }
+
+    //---------------------------------------------------------------
+    template<class NA, class A, class CI, class RO>
+    static T
+    row_product(const crs_matrix<T,NA,A,CI,RO>& m, std::size_t r,
+                const T* x) noexcept
+    {
+        const auto beg = m.row_offset_data();
+        return sparse_dot(m.data() + beg[r], m.col_index_data() + beg[r],
+                          std::size_t(beg[r+1] - beg[r]), x);
+    }
+
+private:
+    std::vector<std::size_t> bounds_;
+    std::vector<fused_sums<T>> partial_;
+};
+
+}  // namespace crs_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief preconditioned conjugate gradient solver for
+ *        symmetric positive definite systems A x = b
+ *
+ * @details Workspace vectors are kept between calls to solve().
+ *          Dot products are fused with the matrix-vector product
+ *          (p.Ap) and with the vector updates (r.r and, for pointwise
+ *          preconditioners, z = M^-1 r and r.z).
+ *          With num_threads != 1 every iteration runs 3-5 parallel
+ *          kernels, each of which starts and joins its own threads;
+ *          for small systems this start-up cost can exceed the gain.
+ *
+ *****************************************************************************/
+template<class ValueType>
+class cg_solver :
+    private crs_detail::solver_workspace<ValueType>
+{
+    using base_t = crs_detail::solver_workspace<ValueType>;
+    using sums_t = crs_detail::fused_sums<ValueType>;
+
+public:
+    using value_type = ValueType;
+
+    //---------------------------------------------------------------
+    explicit
+    cg_solver(const solver_settings& settings = solver_settings{}):
+        settings_(settings)
+    {}
+
+    //---------------------------------------------------------------
+    const solver_settings& settings() const noexcept { return settings_; }
+    solver_settings&       settings()       noexcept { return settings_; }
+
+
+    //---------------------------------------------------------------
+    /**
+     * @param  x  initial guess on input; solution on output;
+     *            has to hold at least A.rows() values
+     * @throws crs_solver_error if A is not square
+     */
+    template<class NA, class A, class CI, class RO,
+             class Preconditioner = identity_preconditioner>
+    solver_stats
+    solve(const crs_matrix<value_type,NA,A,CI,RO>& m,
+          const value_type* b, value_type* x,
+          const Preconditioner& precond = Preconditioner{})
+    {
+        using T = value_type;
+        using pointwise = std::integral_constant<bool,Preconditioner::pointwise>;
+        using clock = std::chrono::steady_clock;
+
+        const auto start = clock::now();
+        base_t::check_square(m);
+
+        solver_stats stats;
+        const auto n = m.rows();
+
+        r_.resize(n); z_.resize(n); p_.resize(n); q_.resize(n);
+        T* r = r_.data(); T* z = z_.data(); T* p = p_.data(); T* q = q_.data();
+
+        base_t::partition(m.row_offset_data(), n, settings_.num_threads);
+
+        //r = b - A x;  r.r;  (z = M^-1 r;  r.z)
+        auto s = base_t::reduce([&](std::size_t first, std::size_t last) {
+            sums_t acc;
+            for(auto i = first; i < last; ++i) {
+                r[i] = b[i] - base_t::row_product(m, i, x);
+                acc.a += r[i] * r[i];
+                if(pointwise::value) {
+                    z[i] = crs_detail::precondition_point(precond, i, r[i], pointwise{});
+                    acc.b += r[i] * z[i];
+                }
+            }
+            return acc;
+        });
+        T rr = s.a;
+        T rz = s.b;
+
+        const auto bnorm = norm(b, n);
+        stats.setup_seconds = crs_detail::seconds_since(start);
+
+        if(!pointwise::value) {
+            rz = precondition(precond, stats);
+        }
+        std::copy(z, z + n, p);
+
+        while(true) {
+            stats.residual = (bnorm > 0) ? double(std::sqrt(rr)) / bnorm
+                                         : double(std::sqrt(rr));
+            if(stats.residual <= settings_.tolerance) {
+                stats.converged = true;
+                break;
+            }
+            if(stats.iterations >= settings_.max_iterations) break;
+            ++stats.iterations;
+
+            //q = A p;  p.q
+            auto t = clock::now();
+            const auto pq = base_t::reduce([&](std::size_t first, std::size_t last) {
+                sums_t acc;
+                for(auto i = first; i < last; ++i) {
+                    q[i] = base_t::row_product(m, i, p);
+                    acc.a += p[i] * q[i];
+                }
+                return acc;
+            }).a;
+            stats.spmv_seconds += crs_detail::seconds_since(t);
+
+            if(pq == T(0)) break;
+            const T alpha = rz / pq;
+
+            //x += alpha p;  r -= alpha q;  r.r;  (z = M^-1 r;  r.z)
+            t = clock::now();
+            s = base_t::reduce([&](std::size_t first, std::size_t last) {
+                sums_t acc;
+                for(auto i = first; i < last; ++i) {
+                    x[i] += alpha * p[i];
+                    r[i] -= alpha * q[i];
+                    acc.a += r[i] * r[i];
+                    if(pointwise::value) {
+                        z[i] = crs_detail::precondition_point(precond, i, r[i], pointwise{});
+                        acc.b += r[i] * z[i];
+                    }
+                }
+                return acc;
+            });
+            stats.vector_seconds += crs_detail::seconds_since(t);
+            rr = s.a;
+
+            const T rzNew = pointwise::value ? s.b : precondition(precond, stats);
+            const T beta = rzNew / rz;
+            rz = rzNew;
+
+            //p = z + beta p
+            t = clock::now();
+            base_t::for_each_block([&](std::size_t first, std::size_t last) {
+                for(auto i = first; i < last; ++i) p[i] = z[i] + beta * p[i];
+            });
+            stats.vector_seconds += crs_detail::seconds_since(t);
+        }
+
+        stats.total_seconds = crs_detail::seconds_since(start);
+        return stats;
+    }
+
+    //-----------------------------------------------------
+    /**
+     * @brief x is resized to A.rows() (filled with zeros) if it is too small
+     */
+    template<class NA, class A, class CI, class RO, class VA,
+             class Preconditioner = identity_preconditioner>
+    solver_stats
+    solve(const crs_matrix<value_type,NA,A,CI,RO>& m,
+          const std::vector<value_type,VA>& b, std::vector<value_type,VA>& x,
+          const Preconditioner& precond = Preconditioner{})
+    {
+        if(x.size() < m.rows()) x.resize(m.rows(), value_type(0));
+        return solve(m, b.data(), x.data(), precond);
+    }
+
+
+private:
+    //---------------------------------------------------------------
+    double
+    norm(const value_type* v, std::size_t n) const noexcept {
+        double s = 0;
+        for(std::size_t i = 0; i < n; ++i) s += double(v[i] * v[i]);
+        return std::sqrt(s);
+    }
+
+    //---------------------------------------------------------------
+    /// @brief z = M^-1 r; @return r.z
+    template<class Preconditioner>
+    value_type
+    precondition(const Preconditioner& precond, solver_stats& stats)
+    {
+        const auto n = r_.size();
+        auto t = std::chrono::steady_clock::now();
+        precond.apply(r_.data(), z_.data(), n);
+        stats.preconditioner_seconds += crs_detail::seconds_since(t);
+
+        t = std::chrono::steady_clock::now();
+        const value_type* r = r_.data();
+        const value_type* z = z_.data();
+        const auto rz = base_t::reduce([&](std::size_t first, std::size_t last) {
+            sums_t acc;
+            for(auto i = first; i < last; ++i) acc.a += r[i] * z[i];
+            return acc;
+        }).a;
+        stats.vector_seconds += crs_detail::seconds_since(t);
+        return rz;
+    }
+
+
+    //---------------------------------------------------------------
+    solver_settings settings_;
+    std::vector<value_type> r_;
+    std::vector<value_type> z_;
+    std::vector<value_type> p_;
+    std::vector<value_type> q_;
+};
+
+
+
+/*************************************************************************//***
+ *
+ * @brief right-preconditioned BiCGSTAB solver for general
+ *        (non-symmetric) systems A x = b
+ *
+ * @details Workspace vectors are kept between calls to solve().
+ *          Dot products are fused with the matrix-vector products
+ *          (rhat.v, t.t and t.s) and with the vector updates.
+ *          With num_threads != 1 every iteration runs 5-6 parallel
+ *          kernels, each of which starts and joins its own threads;
+ *          for small systems this start-up cost can exceed the gain.
+ *
+ *****************************************************************************/
+template<class ValueType>
+class bicgstab_solver :
+    private crs_detail::solver_workspace<ValueType>
+{
+    using base_t = crs_detail::solver_workspace<ValueType>;
+    using sums_t = crs_detail::fused_sums<ValueType>;
+
+public:
+    using value_type = ValueType;
+
+    //---------------------------------------------------------------
+    explicit
+    bicgstab_solver(const solver_settings& settings = solver_settings{}):
+        settings_(settings)
+    {}
+
+    //---------------------------------------------------------------
+    const solver_settings& settings() const noexcept { return settings_; }
+    solver_settings&       settings()       noexcept { return settings_; }
+
+
+    //---------------------------------------------------------------
+    /**
+     * @param  x  initial guess on input; solution on output;
+     *            has to hold at least A.rows() values
+     * @throws crs_solver_error if A is not square
+     */
+    template<class NA, class A, class CI, class RO,
+             class Preconditioner = identity_preconditioner>
+    solver_stats
+    solve(const crs_matrix<value_type,NA,A,CI,RO>& m,
+          const value_type* b, value_type* x,
+          const Preconditioner& precond = Preconditioner{})
+    {
+        using T = value_type;
+        using pointwise = std::integral_constant<bool,Preconditioner::pointwise>;
+        using clock = std::chrono::steady_clock;
+
+        const auto start = clock::now();
+        base_t::check_square(m);
+
+        solver_stats stats;
+        const auto n = m.rows();
+
+        r_.resize(n); rhat_.resize(n); p_.resize(n); v_.resize(n);
+        phat_.resize(n); s_.resize(n); shat_.resize(n); t_.resize(n);
+        T* r = r_.data(); T* rhat = rhat_.data(); T* p = p_.data();
+        T* v = v_.data(); T* phat = phat_.data(); T* s = s_.data();
+        T* shat = shat_.data(); T* t = t_.data();
+
+        base_t::partition(m.row_offset_data(), n, settings_.num_threads);
+
+        //r = rhat = b - A x;  p = v = 0;  r.r
+        T rr = base_t::reduce([&](std::size_t first, std::size_t last) {
+            sums_t acc;
+            for(auto i = first; i < last; ++i) {
+                r[i] = b[i] - base_t::row_product(m, i, x);
+                rhat[i] = r[i];
+                p[i] = T(0);
+                v[i] = T(0);
+                acc.a += r[i] * r[i];
+            }
+            return acc;
+        }).a;
+
+        double bnorm = 0;
+        for(std::size_t i = 0; i < n; ++i) bnorm += double(b[i] * b[i]);
+        bnorm = std::sqrt(bnorm);
+
+        T rho = T(1);
+        T alpha = T(1);
+        T omega = T(1);
+
+        stats.setup_seconds = crs_detail::seconds_since(start);
+
+        const auto relative = [&](T sq) {
+            return (bnorm > 0) ? double(std::sqrt(sq)) / bnorm
+                               : double(std::sqrt(sq));
+        };
+
+        while(true) {
+            stats.residual = relative(rr);
+            if(stats.residual <= settings_.tolerance) {
+                stats.converged = true;
+                break;
+            }
+            if(stats.iterations >= settings_.max_iterations) break;
+            ++stats.iterations;
+
+            //rho = rhat.r
+            auto tp = clock::now();
+            const T rhoNew = base_t::reduce([&](std::size_t first, std::size_t last) {
+                sums_t acc;
+                for(auto i = first; i < last; ++i) acc.a += rhat[i] * r[i];
+                return acc;
+            }).a;
+            if(rhoNew == T(0)) break;   //breakdown
+
+            const T beta = (rhoNew / rho) * (alpha / omega);
+            rho = rhoNew;
+
+            //p = r + beta (p - omega v);  (phat = M^-1 p)
+            base_t::for_each_block([&](std::size_t first, std::size_t last) {
+                for(auto i = first; i < last; ++i) {
+                    p[i] = r[i] + beta * (p[i] - omega * v[i]);
+                    if(pointwise::value) {
+                        phat[i] = crs_detail::precondition_point(precond, i, p[i], pointwise{});
+                    }
+                }
+            });
+            stats.vector_seconds += crs_detail::seconds_since(tp);
+
+            if(!pointwise::value) precondition(precond, p, phat, stats);
+
+            //v = A phat;  rhat.v
+            tp = clock::now();
+            const T rv = base_t::reduce([&](std::size_t first, std::size_t last) {
+                sums_t acc;
+                for(auto i = first; i < last; ++i) {
+                    v[i] = base_t::row_product(m, i, phat);
+                    acc.a += rhat[i] * v[i];
+                }
+                return acc;
+            }).a;
+            stats.spmv_seconds += crs_detail::seconds_since(tp);
+
+            if(rv == T(0)) break;   //breakdown
+            alpha = rho / rv;
+
+            //s = r - alpha v;  s.s;  (shat = M^-1 s)
+            tp = clock::now();
+            const T ss = base_t::reduce([&](std::size_t first, std::size_t last) {
+                sums_t acc;
+                for(auto i = first; i < last; ++i) {
+                    s[i] = r[i] - alpha * v[i];
+                    acc.a += s[i] * s[i];
+                    if(pointwise::value) {
+                        shat[i] = crs_detail::precondition_point(precond, i, s[i], pointwise{});
+                    }
+                }
+                return acc;
+            }).a;
+            stats.vector_seconds += crs_detail::seconds_since(tp);
+
+            if(relative(ss) <= settings_.tolerance) {
+                tp = clock::now();
+                base_t::for_each_block([&](std::size_t first, std::size_t last) {
+                    for(auto i = first; i < last; ++i) x[i] += alpha * phat[i];
+                });
+                stats.vector_seconds += crs_detail::seconds_since(tp);
+                rr = ss;
+                continue;
+            }
+
+            if(!pointwise::value) precondition(precond, s, shat, stats);
+
+            //t = A shat;  t.t;  t.s
+            tp = clock::now();
+            const auto ts = base_t::reduce([&](std::size_t first, std::size_t last) {
+                sums_t acc;
+                for(auto i = first; i < last; ++i) {
+                    t[i] = base_t::row_product(m, i, shat);
+                    acc.a += t[i] * t[i];
+                    acc.b += t[i] * s[i];
+                }
+                return acc;
+            });
+            stats.spmv_seconds += crs_detail::seconds_since(tp);
+
+            if(ts.a == T(0)) break;   //breakdown
+            omega = ts.b / ts.a;
+
+            //x += alpha phat + omega shat;  r = s - omega t;  r.r
+            tp = clock::now();
+            rr = base_t::reduce([&](std::size_t first, std::size_t last) {
+                sums_t acc;
+                for(auto i = first; i < last; ++i) {
+                    x[i] += alpha * phat[i] + omega * shat[i];
+                    r[i] = s[i] - omega * t[i];
+                    acc.a += r[i] * r[i];
+                }
+                return acc;
+            }).a;
+            stats.vector_seconds += crs_detail::seconds_since(tp);
+
+            if(omega == T(0)) break;   //breakdown
+        }
+
+        stats.total_seconds = crs_detail::seconds_since(start);
+        return stats;
+    }
+
+    //-----------------------------------------------------
+    /**
+     * @brief x is resized to A.rows() (filled with zeros) if it is too small
+     */
+    template<class NA, class A, class CI, class RO, class VA,
+             class Preconditioner = identity_preconditioner>
+    solver_stats
+    solve(const crs_matrix<value_type,NA,A,CI,RO>& m,
+          const std::vector<value_type,VA>& b, std::vector<value_type,VA>& x,
+          const Preconditioner& precond = Preconditioner{})
+    {
+        if(x.size() < m.rows()) x.resize(m.rows(), value_type(0));
+        return solve(m, b.data(), x.data(), precond);
+    }
+
+
+private:
+    //---------------------------------------------------------------
+    template<class Preconditioner>
+    void
+    precondition(const Preconditioner& precond,
+                 const value_type* in, value_type* out, solver_stats& stats)
+    {
+        const auto t = std::chrono::steady_clock::now();
+        precond.apply(in, out, r_.size());
+        stats.preconditioner_seconds += crs_detail::seconds_since(t);
+    }
+
+
+    //---------------------------------------------------------------
+    solver_settings settings_;
+    std::vector<value_type> r_;
+    std::vector<value_type> rhat_;
+    std::vector<value_type> p_;
+    std::vector<value_type> v_;
+    std::vector<value_type> phat_;
+    std::vector<value_type> s_;
+    std::vector<value_type> shat_;
+    std::vector<value_type> t_;
+};
+
+
+}  // namespace am
+
+
+#endif
@@ -0,0 +1,218 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_CRS_SEARCH_H_
+#define AMLIB_CONTAINERS_CRS_SEARCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#endif
+
+
+namespace am {
+
+
+/*****************************************************************************
+ *
+ * lower bound search strategies for short, strictly ascending sequences
+ * (like the column indices of one CRS matrix row)
+ *
+ * all functions return a pointer to the first element in [first,last)
+ * that is not less than 'key' (same as std::lower_bound)
+ *
+ *****************************************************************************/
+
+/// @brief rows up to this length are searched with linear_lower_bound
+constexpr std::size_t crs_linear_search_limit = 32;
+
+/// @brief rows from this length on are searched with interpolation_lower_bound
+constexpr std::size_t crs_interpolation_search_limit = 256;
+
+
+
+/*************************************************************************//***
+ *
+ * @brief counts all elements < key without any data-dependent branches
+ *
+ *****************************************************************************/
+template<class T>
+inline const T*
+linear_lower_bound(const T* first, const T* last, const T& key) noexcept
+{
+    std::size_t n = 0;
+    for(auto p = first; p != last; ++p) {
+        n += std::size_t(*p < key);
+    }
+    return first + n;
+}
+
+
+#if defined(__AVX2__)
+
+namespace crs_detail {
+
+//-------------------------------------------------------------------
+/// @brief number of set bits in an (at most 8 bit) SIMD movemask result;
+///        portable (compiler builtins / POPCNT aren't available everywhere)
+inline std::size_t
+mask_popcount(int mask) noexcept
+{
+    auto m = unsigned(mask) & 0xFFu;
+    m = m - ((m >> 1) & 0x55u);
+    m = (m & 0x33u) + ((m >> 2) & 0x33u);
+    return std::size_t((m + (m >> 4)) & 0x0Fu);
+}
+
+}  // namespace crs_detail
+
+
+//-------------------------------------------------------------------
+inline const std::uint32_t*
+linear_lower_bound(const std::uint32_t* first, const std::uint32_t* last,
+                   const std::uint32_t& key) noexcept
+{
+    //AVX2 only has signed comparisons => flip sign bits
+    const auto bias = _mm256_set1_epi32(int(0x80000000u));
+    const auto k = _mm256_xor_si256(_mm256_set1_epi32(int(key)), bias);
+
+    std::size_t n = 0;
+    auto p = first;
+    for(; last - p >= 8; p += 8) {
+        const auto x = _mm256_xor_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), bias);
+        const auto lt = _mm256_cmpgt_epi32(k, x);
+        n += crs_detail::mask_popcount(
+                 _mm256_movemask_ps(_mm256_castsi256_ps(lt)));
+    }
+    for(; p != last; ++p) {
+        n += std::size_t(*p < key);
+    }
+    return first + n;
+}
+
+//-------------------------------------------------------------------
+inline const std::uint64_t*
+linear_lower_bound(const std::uint64_t* first, const std::uint64_t* last,
+                   const std::uint64_t& key) noexcept
+{
+    const auto bias = _mm256_set1_epi64x(
+        static_cast<long long>(0x8000000000000000ull));
+    const auto k = _mm256_xor_si256(
+        _mm256_set1_epi64x(static_cast<long long>(key)), bias);
+
+    std::size_t n = 0;
+    auto p = first;
+    for(; last - p >= 4; p += 4) {
+        const auto x = _mm256_xor_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), bias);
+        const auto lt = _mm256_cmpgt_epi64(k, x);
+        n += crs_detail::mask_popcount(
+                 _mm256_movemask_pd(_mm256_castsi256_pd(lt)));
+    }
+    for(; p != last; ++p) {
+        n += std::size_t(*p < key);
+    }
+    return first + n;
+}
+
+#endif
+
+
+
+/*************************************************************************//***
+ *
+ * @brief binary search whose loop body compiles to a conditional move
+ *        instead of a (frequently mispredicted) branch
+ *
+ *****************************************************************************/
+template<class T>
+inline const T*
+branchless_lower_bound(const T* first, const T* last, const T& key) noexcept
+{
+    auto n = std::size_t(last - first);
+    if(n < 1) return first;
+
+    auto base = first;
+    while(n > 1) {
+        const auto half = n / 2;
+        base = (base[half] < key) ? base + half : base;
+        n -= half;
+    }
+    return base + std::size_t(*base < key);
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief a few interpolation steps (guessing the position from the values
+ *        at the range boundaries) followed by a branchless binary search
+ *        of the remaining range;
+ *        works best for long rows with evenly spread column indices
+ *
+ *****************************************************************************/
+template<class T>
+inline const T*
+interpolation_lower_bound(const T* first, const T* last, const T& key,
+                          int maxSteps = 4) noexcept
+{
+    std::size_t lo = 0;
+    std::size_t hi = std::size_t(last - first);
+
+    //invariant: result in [lo,hi]
+    for(int step = 0; step < maxSteps && hi - lo > crs_linear_search_limit; ++step) {
+        const auto& a = first[lo];
+        const auto& b = first[hi-1];
+        if(!(a < key)) return first + lo;
+        if(b < key)    return first + hi;
+
+        //a < key <= b
+        const auto frac = double(key - a) / double(b - a);
+        auto pos = lo + std::size_t(frac * double(hi - 1 - lo));
+        if(pos >= hi) pos = hi - 1;
+
+        if(first[pos] < key) lo = pos + 1; else hi = pos;
+    }
+    return branchless_lower_bound(first + lo, first + hi, key);
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief picks a search strategy based on the sequence length:
+ *        linear scan for short, interpolation for very long and
+ *        branchless binary search for all other sequences
+ *
+ *****************************************************************************/
+template<class T>
+inline const T*
+adaptive_lower_bound(const T* first, const T* last, const T& key) noexcept
+{
+    const auto n = std::size_t(last - first);
+
+    if(n <= crs_linear_search_limit) {
+        return linear_lower_bound(first, last, key);
+    }
+    if(n >= crs_interpolation_search_limit) {
+        return interpolation_lower_bound(first, last, key);
+    }
+    return branchless_lower_bound(first, last, key);
+}
+
+
+}  // namespace am
+
+
+#endif
@@ -0,0 +1,553 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_GAPPED_CRS_MATRIX_H_
+#define AMLIB_CONTAINERS_GAPPED_CRS_MATRIX_H_
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "crs_matrix.h"
+
+
+namespace am {
+
+
+/*************************************************************************//***
+ *
+ * @brief compressed row storage sparse matrix with slack slots at the end
+ *        of each row (packed memory array layout) for interleaved
+ *        reads and writes
+ *
+ * @details Row r owns the slots [row_offset_data()[r], row_offset_data()[r+1])
+ *          of which the first row_size(r) hold its elements (sorted by
+ *          column). Inserting into a row with free slots only shifts the
+ *          elements of that row. If a row is full, the smallest aligned
+ *          window of 2^k neighboring rows whose density stays below a
+ *          level-dependent threshold is redistributed evenly; if even the
+ *          whole matrix is too dense, the storage grows.
+ *          This gives amortized O(log^2 n) slot moves per insertion.
+ *          compact() removes all slack (=> plain CRS arrays).
+ *
+ *****************************************************************************/
+template<
+    class ValueType,
+    class NAvalue = crs_matrix_static_value<ValueType,0>,
+    class Allocator = std::allocator<ValueType>,
+    class ColIndexType = std::size_t,
+    class RowOffsetType = std::size_t
+>
+class gapped_crs_matrix
+{
+public:
+    //---------------------------------------------------------------
+    // TYPES
+    //---------------------------------------------------------------
+    using matrix_type     = crs_matrix<ValueType,NAvalue,Allocator,
+                                       ColIndexType,RowOffsetType>;
+    using value_type      = ValueType;
+    using size_type       = typename matrix_type::size_type;
+    using col_index_type  = typename matrix_type::col_index_type;
+    using row_offset_type = typename matrix_type::row_offset_type;
+    //-----------------------------------------------------
+    using iterator        = typename matrix_type::iterator;
+    using const_iterator  = typename matrix_type::const_iterator;
+    using row_range       = typename matrix_type::row_range;
+    using const_row_range = typename matrix_type::const_row_range;
+
+
+private:
+    using value_storage      = typename matrix_type::value_storage;
+    using col_index_storage  = typename matrix_type::col_index_storage;
+    using row_offset_storage = typename matrix_type::row_offset_storage;
+
+    static constexpr size_type no_row = size_type(-1);
+
+
+public:
+    //---------------------------------------------------------------
+    // CONSTRUCTION / DESTRUCTION
+    //---------------------------------------------------------------
+    gapped_crs_matrix():
+        values_{}, colidx_{}, rowbeg_{0}, rowlen_{}
+    {}
+
+    //-----------------------------------------------------
+    /** @brief  copies the content of a CRS matrix and spreads
+     *          slack * m.size() free slots evenly over all rows
+     */
+    explicit
+    gapped_crs_matrix(const matrix_type& m, double slack = 0.5):
+        values_(m.begin(), m.end()),
+        colidx_(m.begin_col_indices(), m.end_col_indices()),
+        rowbeg_(m.begin_row_offsets(), m.end_row_offsets()),
+        rowlen_(m.rows())
+    {
+        for(size_type r = 0; r < rowlen_.size(); ++r) {
+            rowlen_[r] = row_offset_type(rowbeg_[r+1] - rowbeg_[r]);
+        }
+        size_ = m.size();
+        declaredCols_ = m.cols();
+        maxCol_ = declaredCols_;
+
+        if(slack > 0 && !rowlen_.empty()) {
+            redistribute(0, rows(), size_ + size_type(slack * double(size_)),
+                         no_row);
+        }
+    }
+
+
+    //---------------------------------------------------------------
+    // SETTINGS
+    //---------------------------------------------------------------
+    /** @brief  maximum fraction of used slots in the whole matrix before
+     *          the storage grows; windows of fewer rows tolerate
+     *          higher densities (up to 1 for single rows)
+     */
+    void
+    max_density(double density) {
+        maxDensity_ = std::min(1.0, std::max(0.125, density));
+    }
+    //-----------------------------------------------------
+    double
+    max_density() const noexcept {
+        return maxDensity_;
+    }
+
+
+    //---------------------------------------------------------------
+    // MODIFY
+    //---------------------------------------------------------------
+    /** @brief  insert/modify value at (row,col)
+     *  @return true, if a new element was inserted
+     */
+    bool
+    insert(size_type row, size_type col, const value_type& val)
+    {
+        if(row >= rows()) add_rows(row + 1);
+
+        auto b = size_type(rowbeg_[row]);
+        const auto n = size_type(rowlen_[row]);
+        const auto pos = position(row, col);
+
+        if(pos < n && size_type(colidx_[b + pos]) == col) {
+            values_[b + pos] = val;
+            return false;
+        }
+
+        if(b + n == size_type(rowbeg_[row+1])) {
+            rebalance(row);
+            b = size_type(rowbeg_[row]);
+        }
+
+        //shift tail of this row only
+        const auto vb = values_.begin() + std::ptrdiff_t(b);
+        const auto cb = colidx_.begin() + std::ptrdiff_t(b);
+        std::move_backward(vb + std::ptrdiff_t(pos), vb + std::ptrdiff_t(n),
+                           vb + std::ptrdiff_t(n + 1));
+        std::move_backward(cb + std::ptrdiff_t(pos), cb + std::ptrdiff_t(n),
+                           cb + std::ptrdiff_t(n + 1));
+        values_[b + pos] = val;
+        colidx_[b + pos] = col_index_type(col);
+
+        ++rowlen_[row];
+        ++size_;
+        if(col >= maxCol_) maxCol_ = col + 1;
+        return true;
+    }
+
+    //-----------------------------------------------------
+    /** @return true, if an element was erased
+     */
+    bool
+    erase(size_type row, size_type col)
+    {
+        if(row >= rows()) return false;
+
+        const auto b = size_type(rowbeg_[row]);
+        const auto n = size_type(rowlen_[row]);
+        const auto pos = position(row, col);
+
+        if(pos >= n || size_type(colidx_[b + pos]) != col) return false;
+
+        const auto vb = values_.begin() + std::ptrdiff_t(b);
+        const auto cb = colidx_.begin() + std::ptrdiff_t(b);
+        std::move(vb + std::ptrdiff_t(pos + 1), vb + std::ptrdiff_t(n),
+                  vb + std::ptrdiff_t(pos));
+        std::move(cb + std::ptrdiff_t(pos + 1), cb + std::ptrdiff_t(n),
+                  cb + std::ptrdiff_t(pos));
+
+        --rowlen_[row];
+        --size_;
+        return true;
+    }
+
+    //-----------------------------------------------------
+    void
+    clear() {
+        values_.clear();
+        colidx_.clear();
+        rowbeg_.clear();
+        rowbeg_.push_back(0);
+        rowlen_.clear();
+        size_ = 0;
+        maxCol_ = 0;
+        declaredCols_ = 0;
+    }
+
+    //-----------------------------------------------------
+    /** @brief sets the number of rows (can only grow) */
+    void
+    rows(size_type numRows) {
+        if(numRows > rows()) add_rows(numRows);
+    }
+    //-----------------------------------------------------
+    /** @brief sets the (minimum) number of columns reported by cols() */
+    void
+    cols(size_type numCols) noexcept {
+        declaredCols_ = numCols;
+    }
+
+
+    //---------------------------------------------------------------
+    // COMPACTION
+    //---------------------------------------------------------------
+    /** @brief  removes all slack slots;
+     *          afterwards data(), col_index_data() and row_offset_data()
+     *          form plain CRS arrays
+     */
+    void
+    compact()
+    {
+        if(capacity() == size_) return;
+        redistribute(0, rows(), size_, no_row);
+        values_.shrink_to_fit();
+        colidx_.shrink_to_fit();
+    }
+
+    //-----------------------------------------------------
+    /** @return plain CRS matrix with the same content */
+    matrix_type
+    to_crs_matrix() const
+    {
+        auto values = value_storage(values_.get_allocator());
+        auto colidx = col_index_storage(colidx_.get_allocator());
+        auto rowbeg = row_offset_storage(rows() + 1, row_offset_type(0),
+                                         rowbeg_.get_allocator());
+        values.reserve(size_);
+        colidx.reserve(size_);
+
+        for(size_type r = 0; r < rows(); ++r) {
+            const auto b = std::ptrdiff_t(rowbeg_[r]);
+            const auto e = b + std::ptrdiff_t(rowlen_[r]);
+            values.insert(values.end(), values_.begin() + b, values_.begin() + e);
+            colidx.insert(colidx.end(), colidx_.begin() + b, colidx_.begin() + e);
+            rowbeg[r+1] = row_offset_type(values.size());
+        }
+
+        auto m = matrix_type{std::move(values), std::move(colidx),
+                             std::move(rowbeg)};
+        m.cols(declaredCols_);
+        return m;
+    }
+
+
+    //---------------------------------------------------------------
+    // ELEMENT ACCESS
+    //---------------------------------------------------------------
+    bool
+    has(size_type row, size_type col) const noexcept {
+        if(row >= rows()) return false;
+        const auto pos = position(row, col);
+        return pos < size_type(rowlen_[row]) &&
+               size_type(colidx_[size_type(rowbeg_[row]) + pos]) == col;
+    }
+
+    //-----------------------------------------------------
+    /** @return value at (row,col) or the n/a value if not present
+     */
+    value_type
+    operator () (size_type row, size_type col) const noexcept
+    {
+        if(row >= rows()) return matrix_type::na_value();
+        const auto b = size_type(rowbeg_[row]);
+        const auto pos = position(row, col);
+        return (pos < size_type(rowlen_[row]) &&
+                size_type(colidx_[b + pos]) == col)
+               ? values_[b + pos] : matrix_type::na_value();
+    }
+
+    //-----------------------------------------------------
+    /** @brief insert/modify value at (row,col) */
+    void
+    operator () (size_type row, size_type col, const value_type& val)
+    {
+        insert(row, col, val);
+    }
+
+
+    //---------------------------------------------------------------
+    // ROW ITERATORS
+    //---------------------------------------------------------------
+    iterator
+    begin_row(size_type row) noexcept {
+        return values_.begin() + std::ptrdiff_t(rowbeg_[row]);
+    }
+    const_iterator
+    begin_row(size_type row) const noexcept {
+        return values_.begin() + std::ptrdiff_t(rowbeg_[row]);
+    }
+    const_iterator
+    cbegin_row(size_type row) const noexcept {
+        return begin_row(row);
+    }
+    //-----------------------------------------------------
+    iterator
+    end_row(size_type row) noexcept {
+        return begin_row(row) + std::ptrdiff_t(rowlen_[row]);
+    }
+    const_iterator
+    end_row(size_type row) const noexcept {
+        return begin_row(row) + std::ptrdiff_t(rowlen_[row]);
+    }
+    const_iterator
+    cend_row(size_type row) const noexcept {
+        return end_row(row);
+    }
+
+    //-----------------------------------------------------
+    row_range
+    row(size_type row) noexcept {
+        return row_range{begin_row(row), end_row(row)};
+    }
+    const_row_range
+    row(size_type row) const noexcept {
+        return const_row_range{begin_row(row), end_row(row)};
+    }
+    const_row_range
+    crow(size_type row) const noexcept {
+        return const_row_range{begin_row(row), end_row(row)};
+    }
+
+    //-----------------------------------------------------
+    size_type
+    col_index_of(const_iterator it) const noexcept {
+        using std::distance;
+        return size_type(colidx_[size_type(distance(values_.cbegin(), it))]);
+    }
+
+
+    //---------------------------------------------------------------
+    // DIRECT ACCESS TO SLOT ARRAYS
+    //---------------------------------------------------------------
+    const value_type*      data()            const noexcept { return values_.data(); }
+    const col_index_type*  col_index_data()  const noexcept { return colidx_.data(); }
+    /// @brief first slot of each row; rows()+1 values
+    const row_offset_type* row_offset_data() const noexcept { return rowbeg_.data(); }
+    /// @brief number of elements in each row; rows() values
+    const row_offset_type* row_size_data()   const noexcept { return rowlen_.data(); }
+
+
+    //---------------------------------------------------------------
+    // SIZE PROPERTIES
+    //---------------------------------------------------------------
+    size_type
+    size() const noexcept {
+        return size_;
+    }
+    //-----------------------------------------------------
+    bool
+    empty() const noexcept {
+        return size_ < 1;
+    }
+    //-----------------------------------------------------
+    size_type
+    rows() const noexcept {
+        return rowlen_.size();
+    }
+    //-----------------------------------------------------
+    /** @return number of columns;
+     *          might be too large if erasures removed
+     *          the elements with the largest column index
+     */
+    size_type
+    cols() const noexcept {
+        return std::max(declaredCols_, maxCol_);
+    }
+    //-----------------------------------------------------
+    size_type
+    row_size(size_type row) const noexcept {
+        return size_type(rowlen_[row]);
+    }
+    //-----------------------------------------------------
+    /// @brief total number of slots (elements + slack)
+    size_type
+    capacity() const noexcept {
+        return values_.size();
+    }
+    //-----------------------------------------------------
+    size_type
+    row_capacity(size_type row) const noexcept {
+        return size_type(rowbeg_[row+1] - rowbeg_[row]);
+    }
+
+
+    //---------------------------------------------------------------
+    friend void
+    swap(gapped_crs_matrix& a, gapped_crs_matrix& b) noexcept {
+        using std::swap;
+        swap(a.values_, b.values_);
+        swap(a.colidx_, b.colidx_);
+        swap(a.rowbeg_, b.rowbeg_);
+        swap(a.rowlen_, b.rowlen_);
+        swap(a.size_, b.size_);
+        swap(a.maxCol_, b.maxCol_);
+        swap(a.declaredCols_, b.declaredCols_);
+        swap(a.maxDensity_, b.maxDensity_);
+    }
+
+
+private:
+    //---------------------------------------------------------------
+    /// @return position of first element in row with column >= col
+    size_type
+    position(size_type row, size_type col) const noexcept
+    {
+        const auto b = colidx_.begin() + std::ptrdiff_t(rowbeg_[row]);
+        const auto e = b + std::ptrdiff_t(rowlen_[row]);
+        return size_type(std::lower_bound(b, e, col,
+            [](col_index_type c, size_type k) { return size_type(c) < k; }) - b);
+    }
+
+    //---------------------------------------------------------------
+    /// @brief appends rows without slots
+    void
+    add_rows(size_type numRows)
+    {
+        rowbeg_.resize(numRows + 1, rowbeg_.back());
+        rowlen_.resize(numRows, row_offset_type(0));
+    }
+
+    //---------------------------------------------------------------
+    /**
+     * @brief  makes room for one more element in 'row':
+     *         redistributes the smallest aligned window of rows around
+     *         'row' that is sparse enough or grows the whole storage
+     */
+    void
+    rebalance(size_type row)
+    {
+        const auto nrows = rows();
+        size_type height = 0;
+        while((size_type(1) << height) < nrows) ++height;
+
+        for(size_type level = 1; level <= height; ++level) {
+            const auto lo = (row >> level) << level;
+            const auto hi = std::min(lo + (size_type(1) << level), nrows);
+
+            size_type used = 1;
+            for(auto r = lo; r < hi; ++r) used += size_type(rowlen_[r]);
+            const auto slots = size_type(rowbeg_[hi] - rowbeg_[lo]);
+
+            //upper density threshold: 1 for single rows ... maxDensity_ for all
+            const auto limit = 1.0 - (1.0 - maxDensity_) *
+                                     double(level) / double(height);
+
+            if(double(used) <= limit * double(slots)) {
+                redistribute(lo, hi, slots, row);
+                return;
+            }
+        }
+
+        //whole matrix too dense => grow to half the maximum density
+        const auto used = size_ + 1;
+        const auto slots = std::max(used + 1,
+                                    size_type(2.0 * double(used) / maxDensity_));
+        redistribute(0, nrows, slots, row);
+    }
+
+    //---------------------------------------------------------------
+    /**
+     * @brief  spreads the elements of rows [lo,hi) evenly over 'numSlots'
+     *         slots starting at row_offset_data()[lo];
+     *         'target' row (if in window) gets one additional free slot;
+     *         the slot count may only change if hi == rows()
+     */
+    void
+    redistribute(size_type lo, size_type hi, size_type numSlots,
+                 size_type target)
+    {
+        const auto base = size_type(rowbeg_[lo]);
+
+        size_type used = 0;
+        for(auto r = lo; r < hi; ++r) used += size_type(rowlen_[r]);
+
+        //gather
+        auto values = value_storage(values_.get_allocator());
+        auto colidx = col_index_storage(colidx_.get_allocator());
+        values.reserve(used);
+        colidx.reserve(used);
+        for(auto r = lo; r < hi; ++r) {
+            const auto b = std::ptrdiff_t(rowbeg_[r]);
+            const auto e = b + std::ptrdiff_t(rowlen_[r]);
+            std::move(values_.begin() + b, values_.begin() + e,
+                      std::back_inserter(values));
+            colidx.insert(colidx.end(), colidx_.begin() + b, colidx_.begin() + e);
+        }
+
+        if(base + numSlots != size_type(rowbeg_[hi])) {
+            values_.resize(base + numSlots);
+            colidx_.resize(base + numSlots);
+        }
+
+        //scatter
+        const auto n = hi - lo;
+        const auto reserved = (target >= lo && target < hi) ? 1 : 0;
+        const auto gaps = numSlots - used - size_type(reserved);
+
+        auto o = base;
+        size_type k = 0;
+        for(auto r = lo; r < hi; ++r) {
+            const auto i = r - lo;
+            const auto len = size_type(rowlen_[r]);
+            rowbeg_[r] = row_offset_type(o);
+            std::move(values.begin() + std::ptrdiff_t(k),
+                      values.begin() + std::ptrdiff_t(k + len),
+                      values_.begin() + std::ptrdiff_t(o));
+            std::copy(colidx.begin() + std::ptrdiff_t(k),
+                      colidx.begin() + std::ptrdiff_t(k + len),
+                      colidx_.begin() + std::ptrdiff_t(o));
+            k += len;
+            o += len + (r == target ? 1 : 0) +
+                 (gaps * (i + 1)) / n - (gaps * i) / n;
+        }
+        rowbeg_[hi] = row_offset_type(o);
+    }
+
+
+    //---------------------------------------------------------------
+    value_storage values_;
+    col_index_storage colidx_;
+    row_offset_storage rowbeg_;
+    row_offset_storage rowlen_;
+    size_type size_ = 0;
+    size_type maxCol_ = 0;
+    size_type declaredCols_ = 0;
+    double maxDensity_ = 0.75;
+};
+
+
+}  // namespace am
+
+
+#endif
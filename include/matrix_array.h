@@ -432,12 +432,12 @@ public:
     //---------------------------------------------------------------
     pointer
     data() noexcept {
-        return static_cast<pointer>(m_);
+        return &m_[0][0];
     }
     //-----------------------------------------------------
     const_pointer
     data() const noexcept {
-        return static_cast<const value_type*>(m_);
+        return &m_[0][0];
     }
     //-----------------------------------------------------
     reference
@@ -0,0 +1,157 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_PARALLEL_H_
+#define AMLIB_CONTAINERS_PARALLEL_H_
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace am {
+
+
+/*************************************************************************//***
+ *
+ * @brief returns a sane number of threads for 'requested'
+ *        (0 => hardware concurrency; never less than 1)
+ *
+ *****************************************************************************/
+inline int
+effective_thread_count(int requested) noexcept
+{
+    if(requested > 0) return requested;
+    const auto hw = int(std::thread::hardware_concurrency());
+    return (hw > 0) ? hw : 1;
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief splits [first,last) into 'parts' contiguous blocks of
+ *        (roughly) equal length
+ *
+ * @return block boundaries: parts+1 ascending indices
+ *
+ *****************************************************************************/
+template<class Index>
+std::vector<Index>
+uniform_partition(Index first, Index last, int parts)
+{
+    if(parts < 1) parts = 1;
+    const auto n = Index(last - first);
+    if(Index(parts) > n) parts = (n > 0) ? int(n) : 1;
+
+    auto bounds = std::vector<Index>(std::size_t(parts) + 1);
+    for(int i = 0; i <= parts; ++i) {
+        bounds[std::size_t(i)] = Index(first + (n * Index(i)) / Index(parts));
+    }
+    return bounds;
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief splits [0,n) into 'parts' contiguous blocks with (roughly) equal
+ *        weight; the weights are given as prefix sums (n+1 ascending
+ *        values, e.g. the row offsets of a CRS matrix)
+ *
+ * @return block boundaries: parts+1 ascending indices
+ *
+ *****************************************************************************/
+template<class Index, class Offset>
+std::vector<Index>
+weighted_partition(const Offset* prefix, Index n, int parts)
+{
+    if(parts < 1) parts = 1;
+    if(Index(parts) > n) parts = (n > 0) ? int(n) : 1;
+
+    auto bounds = std::vector<Index>(std::size_t(parts) + 1);
+    bounds.front() = 0;
+    bounds.back()  = n;
+
+    const auto first = prefix[0];
+    const auto total = prefix[n] - first;
+
+    for(int i = 1; i < parts; ++i) {
+        //first row whose begin offset reaches the i-th share of the weight
+        //(64 bit product: narrow offset types would overflow)
+        const auto target = first + Offset(
+            (std::uint64_t(total) * std::uint64_t(i)) / std::uint64_t(parts));
+        const auto p = std::lower_bound(prefix, prefix + n, target);
+        auto b = Index(std::distance(prefix, p));
+        //keep boundaries ascending
+        const auto prev = bounds[std::size_t(i-1)];
+        if(b < prev) b = prev;
+        bounds[std::size_t(i)] = b;
+    }
+    return bounds;
+}
+
+
+
+/*************************************************************************//***
+ *
+ * @brief calls f(begin, end, part) for each block [bounds[i], bounds[i+1])
+ *        each block on its own thread; the last block is processed
+ *        by the calling thread
+ *
+ * @details 'f' must not throw
+ *
+ *****************************************************************************/
+template<class Index, class Function>
+void
+parallel_for_blocks(const std::vector<Index>& bounds, Function&& f)
+{
+    if(bounds.size() < 2) return;
+
+    const auto parts = bounds.size() - 1;
+    if(parts == 1) {
+        f(bounds[0], bounds[1], 0);
+        return;
+    }
+
+    auto threads = std::vector<std::thread>{};
+    threads.reserve(parts - 1);
+
+    for(std::size_t i = 0; i < parts - 1; ++i) {
+        threads.emplace_back([&f,&bounds,i]() noexcept {
+            f(bounds[i], bounds[i+1], int(i));
+        });
+    }
+    f(bounds[parts-1], bounds[parts], int(parts-1));
+
+    for(auto& t : threads) t.join();
+}
+
+//-------------------------------------------------------------------
+/**
+ * @brief calls f(begin, end, part) on 'numThreads' contiguous blocks
+ *        of [first,last)
+ */
+template<class Index, class Function>
+void
+parallel_for_blocks(Index first, Index last, int numThreads, Function&& f)
+{
+    parallel_for_blocks(uniform_partition(first, last, numThreads),
+                        std::forward<Function>(f));
+}
+
+
+}  // namespace am
+
+
+#endif
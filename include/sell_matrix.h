@@ -0,0 +1,362 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_SELL_MATRIX_H_
+#define AMLIB_CONTAINERS_SELL_MATRIX_H_
+
+#include <cstddef>
+#include <type_traits>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#include "crs_matrix.h"
+#include "parallel.h"
+
+
+namespace am {
+
+
+/*************************************************************************//***
+ *
+ * @brief read-only sliced ELLPACK (SELL-C-sigma) sparse matrix
+ *
+ * @details Rows are sorted by length (descending) within windows of
+ *          'sigma' rows and grouped into chunks of C consecutive (sorted)
+ *          rows. Each chunk is padded to the length of its longest row
+ *          and stored column-major, so that the j-th elements of all
+ *          C rows of a chunk are adjacent in memory and can be processed
+ *          by one SIMD instruction. The row permutation is kept so that
+ *          results can be reported in the original row order.
+ *
+ *          sigma = 1 keeps the original row order (SELL-C-1);
+ *          larger windows reduce the padding overhead at the cost of
+ *          less locality in the output vector.
+ *
+ * @tparam  C  chunk height (should be a multiple of the SIMD width)
+ *
+ *****************************************************************************/
+template<
+    class ValueType,
+    std::size_t C = 8,
+    class Allocator = std::allocator<ValueType>,
+    class ColIndexType = std::size_t
+>
+class sell_matrix
+{
+    static_assert(C > 0, "chunk height has to be positive");
+    static_assert(std::is_integral<ColIndexType>::value &&
+                  std::is_unsigned<ColIndexType>::value,
+                  "column index type has to be an unsigned integer type");
+
+    template<class T>
+    using rebound_alloc =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+    using value_vector     = std::vector<ValueType,Allocator>;
+    using col_index_vector = std::vector<ColIndexType,
+                                         rebound_alloc<ColIndexType>>;
+    using size_vector      = std::vector<std::size_t,
+                                         rebound_alloc<std::size_t>>;
+
+public:
+    //---------------------------------------------------------------
+    // TYPES
+    //---------------------------------------------------------------
+    using value_type      = ValueType;
+    using allocator_type  = Allocator;
+    using size_type       = std::size_t;
+    using col_index_type  = ColIndexType;
+
+
+    //---------------------------------------------------------------
+    // CONSTRUCTION / DESTRUCTION
+    //---------------------------------------------------------------
+    sell_matrix():
+        values_{}, colidx_{}, chunkbeg_{0}, perm_{}, iperm_{}
+    {}
+
+    //-----------------------------------------------------
+    /** @param sigma  sorting window size in rows; rounded up to a
+     *                multiple of C; 0 => sort all rows at once
+     */
+    template<class NA, class A, class CI, class RO>
+    explicit
+    sell_matrix(const crs_matrix<value_type,NA,A,CI,RO>& m,
+                size_type sigma = 32 * C)
+    :
+        sell_matrix{}
+    {
+        assign(m, sigma);
+    }
+
+
+    //---------------------------------------------------------------
+    // ASSIGNMENT
+    //---------------------------------------------------------------
+    template<class NA, class A, class CI, class RO>
+    void
+    assign(const crs_matrix<value_type,NA,A,CI,RO>& m, size_type sigma = 32 * C)
+    {
+        rows_ = m.rows();
+        cols_ = m.cols();
+        nnz_  = m.size();
+
+        if(sigma < 1) sigma = rows_;
+        sigma = ((sigma + C - 1) / C) * C;
+        sigma_ = sigma;
+
+        const auto beg = m.row_offset_data();
+        const auto row_length = [&](size_type r) {
+            return size_type(beg[r+1] - beg[r]);
+        };
+
+        //sort rows by length within windows
+        perm_.resize(rows_);
+        std::iota(perm_.begin(), perm_.end(), size_type(0));
+        for(size_type w = 0; w < rows_; w += sigma) {
+            const auto e = std::min(w + sigma, rows_);
+            std::stable_sort(perm_.begin() + std::ptrdiff_t(w),
+                             perm_.begin() + std::ptrdiff_t(e),
+                [&](size_type a, size_type b) {
+                    return row_length(a) > row_length(b);
+                });
+        }
+        iperm_.resize(rows_);
+        for(size_type s = 0; s < rows_; ++s) iperm_[perm_[s]] = s;
+
+        //chunk offsets (chunk width = longest row in chunk)
+        const auto nchunks = (rows_ + C - 1) / C;
+        chunkbeg_.assign(nchunks + 1, 0);
+        for(size_type k = 0; k < nchunks; ++k) {
+            size_type width = 0;
+            for(size_type i = 0; i < C && k*C + i < rows_; ++i) {
+                width = std::max(width, row_length(perm_[k*C + i]));
+            }
+            chunkbeg_[k+1] = chunkbeg_[k] + width * C;
+        }
+
+        //column-major packing; padding: value 0, column 0
+        values_.assign(chunkbeg_[nchunks], value_type(0));
+        colidx_.assign(chunkbeg_[nchunks], col_index_type(0));
+
+        const auto val = m.data();
+        const auto col = m.col_index_data();
+        for(size_type s = 0; s < rows_; ++s) {
+            const auto r = perm_[s];
+            auto o = chunkbeg_[s / C] + (s % C);
+            for(auto i = size_type(beg[r]); i < size_type(beg[r+1]); ++i, o += C) {
+                values_[o] = val[i];
+                colidx_[o] = col_index_type(col[i]);
+            }
+        }
+    }
+
+
+    //---------------------------------------------------------------
+    // ELEMENT ACCESS
+    //---------------------------------------------------------------
+    /** @return value at (row,col) (original row index); zero if not stored */
+    value_type
+    operator () (size_type row, size_type col) const noexcept
+    {
+        if(row >= rows_) return value_type(0);
+        const auto s = iperm_[row];
+        const auto b = chunkbeg_[s / C];
+        const auto w = chunk_width(s / C);
+        for(size_type j = 0; j < w; ++j) {
+            const auto o = b + j*C + (s % C);
+            //padding (column 0, value 0) can only follow the row's elements
+            if(size_type(colidx_[o]) == col) return values_[o];
+            if(size_type(colidx_[o]) > col) break;
+        }
+        return value_type(0);
+    }
+
+
+    //---------------------------------------------------------------
+    // DIRECT ACCESS TO SELL REPRESENTATION
+    //---------------------------------------------------------------
+    const value_type*     data()           const noexcept { return values_.data(); }
+    const col_index_type* col_index_data() const noexcept { return colidx_.data(); }
+    /// @brief offsets of chunks in data(); num_chunks()+1 values
+    const size_type*      chunk_offset_data() const noexcept { return chunkbeg_.data(); }
+
+    //-----------------------------------------------------
+    /// @brief permutation()[s] = original index of s-th stored row
+    const size_type*      permutation() const noexcept { return perm_.data(); }
+    /// @brief inverse_permutation()[r] = storage position of original row r
+    const size_type*      inverse_permutation() const noexcept { return iperm_.data(); }
+
+
+    //---------------------------------------------------------------
+    // SIZE PROPERTIES
+    //---------------------------------------------------------------
+    /// @brief number of stored elements of the original matrix
+    size_type size()  const noexcept { return nnz_; }
+    bool      empty() const noexcept { return nnz_ < 1; }
+    size_type rows()  const noexcept { return rows_; }
+    size_type cols()  const noexcept { return cols_; }
+
+    //-----------------------------------------------------
+    static constexpr size_type chunk_height() noexcept { return C; }
+    size_type sigma() const noexcept { return sigma_; }
+    size_type num_chunks() const noexcept { return chunkbeg_.size() - 1; }
+
+    size_type
+    chunk_width(size_type chunk) const noexcept {
+        return (chunkbeg_[chunk+1] - chunkbeg_[chunk]) / C;
+    }
+
+    //-----------------------------------------------------
+    /// @brief number of stored values including padding
+    size_type padded_size() const noexcept { return values_.size(); }
+
+    /// @brief size() / padded_size(); 1 => no padding overhead
+    double
+    fill_ratio() const noexcept {
+        return values_.empty() ? 1.0 : double(nnz_) / double(values_.size());
+    }
+
+
+    //---------------------------------------------------------------
+    friend void
+    swap(sell_matrix& a, sell_matrix& b) noexcept {
+        using std::swap;
+        swap(a.values_,   b.values_);
+        swap(a.colidx_,   b.colidx_);
+        swap(a.chunkbeg_, b.chunkbeg_);
+        swap(a.perm_,     b.perm_);
+        swap(a.iperm_,    b.iperm_);
+        swap(a.rows_,     b.rows_);
+        swap(a.cols_,     b.cols_);
+        swap(a.nnz_,      b.nnz_);
+        swap(a.sigma_,    b.sigma_);
+    }
+
+
+private:
+    //---------------------------------------------------------------
+    value_vector values_;
+    col_index_vector colidx_;
+    size_vector chunkbeg_;
+    size_vector perm_;
+    size_vector iperm_;
+    size_type rows_ = 0;
+    size_type cols_ = 0;
+    size_type nnz_ = 0;
+    size_type sigma_ = C;
+};
+
+
+
+namespace sell_detail {
+
+//-------------------------------------------------------------------
+/// @brief y = alpha * A * x + beta * y for all rows in chunks [first,last)
+template<class T, std::size_t C, class A, class CI>
+void
+spmv_chunks(const sell_matrix<T,C,A,CI>& m,
+            std::size_t first, std::size_t last,
+            const T* x, T* y, const T& alpha, const T& beta) noexcept
+{
+    const auto val  = m.data();
+    const auto col  = m.col_index_data();
+    const auto cbeg = m.chunk_offset_data();
+    const auto perm = m.permutation();
+    const auto rows = m.rows();
+
+    for(auto k = first; k < last; ++k) {
+        T acc[C];
+        for(std::size_t i = 0; i < C; ++i) acc[i] = T(0);
+
+        //one SIMD lane per row of the chunk
+        for(auto o = cbeg[k]; o < cbeg[k+1]; o += C) {
+            for(std::size_t i = 0; i < C; ++i) {
+                acc[i] += val[o+i] * x[col[o+i]];
+            }
+        }
+
+        const auto n = std::min(C, rows - k*C);
+        const auto p = perm + k*C;
+        if(beta == T(0)) {
+            for(std::size_t i = 0; i < n; ++i) y[p[i]] = alpha * acc[i];
+        } else {
+            for(std::size_t i = 0; i < n; ++i) {
+                y[p[i]] = alpha * acc[i] + beta * y[p[i]];
+            }
+        }
+    }
+}
+
+}  // namespace sell_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief SELL-C-sigma matrix - dense vector product
+ *        y = alpha * A * x + beta * y  (original row order)
+ *
+ * @param  x           has to hold at least A.cols() values
+ * @param  y           has to hold at least A.rows() values;
+ *                     is not read if beta == 0
+ * @param  numThreads  1 => serial; 0 => hardware concurrency;
+ *                     chunks are distributed so that every thread
+ *                     processes (about) the same number of stored values
+ *
+ *****************************************************************************/
+template<class T, std::size_t C, class A, class CI>
+void
+spmv(const sell_matrix<T,C,A,CI>& m, const T* x, T* y,
+     const T& alpha = T(1), const T& beta = T(0),
+     int numThreads = 1)
+{
+    const auto nchunks = m.num_chunks();
+    if(nchunks < 1) return;
+
+    numThreads = effective_thread_count(numThreads);
+
+    if(numThreads < 2) {
+        sell_detail::spmv_chunks(m, 0, nchunks, x, y, alpha, beta);
+        return;
+    }
+
+    parallel_for_blocks(
+        weighted_partition(m.chunk_offset_data(), nchunks, numThreads),
+        [&](std::size_t first, std::size_t last, int) {
+            sell_detail::spmv_chunks(m, first, last, x, y, alpha, beta);
+        });
+}
+
+//-------------------------------------------------------------------
+/**
+ * @brief SELL-C-sigma matrix - dense vector product
+ *        y = alpha * A * x + beta * y;
+ *        y is resized to A.rows() if it is too small
+ */
+template<class T, std::size_t C, class A, class CI, class VA>
+void
+spmv(const sell_matrix<T,C,A,CI>& m,
+     const std::vector<T,VA>& x, std::vector<T,VA>& y,
+     const T& alpha = T(1), const T& beta = T(0),
+     int numThreads = 1)
+{
+    if(y.size() < m.rows()) y.resize(m.rows(), T(0));
+    spmv(m, x.data(), y.data(), alpha, beta, numThreads);
+}
+
+
+}  // namespace am
+
+
+#endif
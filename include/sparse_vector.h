@@ -0,0 +1,475 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_SPARSE_VECTOR_H_
+#define AMLIB_CONTAINERS_SPARSE_VECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+#include "crs_matrix.h"
+#include "crs_matrix_algorithms.h"
+
+
+namespace am {
+
+
+/*************************************************************************//***
+ *
+ * @brief sparse vector: sorted index array + value array
+ *
+ * @details size() is the number of stored elements,
+ *          dimension() the length of the (conceptual) dense vector;
+ *          positions without stored element are zero
+ *
+ *****************************************************************************/
+template<
+    class ValueType,
+    class IndexType = std::size_t,
+    class Allocator = std::allocator<ValueType>
+>
+class sparse_vector
+{
+    static_assert(std::is_integral<IndexType>::value &&
+                  std::is_unsigned<IndexType>::value,
+                  "index type has to be an unsigned integer type");
+
+    template<class T>
+    using rebound_alloc =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+    using value_vector = std::vector<ValueType,Allocator>;
+    using index_vector = std::vector<IndexType,rebound_alloc<IndexType>>;
+
+public:
+    //---------------------------------------------------------------
+    // TYPES
+    //---------------------------------------------------------------
+    using value_type     = ValueType;
+    using index_type     = IndexType;
+    using allocator_type = Allocator;
+    using size_type      = std::size_t;
+
+
+    //---------------------------------------------------------------
+    // CONSTRUCTION / DESTRUCTION
+    //---------------------------------------------------------------
+    sparse_vector():
+        values_{}, indices_{}
+    {}
+
+    //-----------------------------------------------------
+    explicit
+    sparse_vector(size_type dimension):
+        values_{}, indices_{}, dim_{dimension}
+    {}
+
+    //-----------------------------------------------------
+    /** @brief  stores all elements of 'dense' that are not zero */
+    template<class VA>
+    explicit
+    sparse_vector(const std::vector<value_type,VA>& dense):
+        values_{}, indices_{}, dim_{dense.size()}
+    {
+        for(size_type i = 0; i < dense.size(); ++i) {
+            if(dense[i] != value_type(0)) push_back(i, dense[i]);
+        }
+    }
+
+
+    //---------------------------------------------------------------
+    // MODIFY
+    //---------------------------------------------------------------
+    /** @brief  appends an element;
+     *          'index' has to be larger than all stored indices
+     */
+    void
+    push_back(size_type index, const value_type& value)
+    {
+        values_.push_back(value);
+        indices_.push_back(index_type(index));
+        if(index >= dim_) dim_ = index + 1;
+    }
+
+    //-----------------------------------------------------
+    /** @brief  insert/modify element at 'index'
+     *  @return true, if a new element was inserted
+     */
+    bool
+    insert(size_type index, const value_type& value)
+    {
+        const auto pos = position(index);
+        if(pos < size() && size_type(indices_[pos]) == index) {
+            values_[pos] = value;
+            return false;
+        }
+        values_.insert(values_.begin() + std::ptrdiff_t(pos), value);
+        indices_.insert(indices_.begin() + std::ptrdiff_t(pos), index_type(index));
+        if(index >= dim_) dim_ = index + 1;
+        return true;
+    }
+
+    //-----------------------------------------------------
+    /** @return true, if an element was erased */
+    bool
+    erase(size_type index)
+    {
+        const auto pos = position(index);
+        if(pos >= size() || size_type(indices_[pos]) != index) return false;
+        values_.erase(values_.begin() + std::ptrdiff_t(pos));
+        indices_.erase(indices_.begin() + std::ptrdiff_t(pos));
+        return true;
+    }
+
+    //-----------------------------------------------------
+    /** @brief removes all elements; keeps dimension and capacity */
+    void
+    clear() noexcept {
+        values_.clear();
+        indices_.clear();
+    }
+
+    //-----------------------------------------------------
+    void
+    reserve(size_type n) {
+        values_.reserve(n);
+        indices_.reserve(n);
+    }
+
+    //-----------------------------------------------------
+    void
+    dimension(size_type n) noexcept {
+        dim_ = n;
+    }
+
+
+    //---------------------------------------------------------------
+    // ELEMENT ACCESS
+    //---------------------------------------------------------------
+    bool
+    has(size_type index) const noexcept {
+        const auto pos = position(index);
+        return pos < size() && size_type(indices_[pos]) == index;
+    }
+
+    //-----------------------------------------------------
+    /** @return value at 'index'; zero if not stored */
+    value_type
+    operator [] (size_type index) const noexcept {
+        const auto pos = position(index);
+        return (pos < size() && size_type(indices_[pos]) == index)
+               ? values_[pos] : value_type(0);
+    }
+
+    //-----------------------------------------------------
+    /** @brief writes all elements into a dense vector of size dimension() */
+    template<class VA>
+    void
+    to_dense(std::vector<value_type,VA>& dense) const
+    {
+        dense.assign(dim_, value_type(0));
+        for(size_type i = 0; i < size(); ++i) {
+            dense[size_type(indices_[i])] = values_[i];
+        }
+    }
+
+
+    //---------------------------------------------------------------
+    // DIRECT ACCESS
+    //---------------------------------------------------------------
+    const value_type* data()       const noexcept { return values_.data(); }
+    const index_type* index_data() const noexcept { return indices_.data(); }
+
+    //-----------------------------------------------------
+    typename value_vector::iterator
+    begin() noexcept { return values_.begin(); }
+    typename value_vector::const_iterator
+    begin() const noexcept { return values_.begin(); }
+    typename value_vector::iterator
+    end() noexcept { return values_.end(); }
+    typename value_vector::const_iterator
+    end() const noexcept { return values_.end(); }
+
+    //-----------------------------------------------------
+    typename index_vector::const_iterator
+    begin_indices() const noexcept { return indices_.begin(); }
+    typename index_vector::const_iterator
+    end_indices() const noexcept { return indices_.end(); }
+
+
+    //---------------------------------------------------------------
+    // SIZE PROPERTIES
+    //---------------------------------------------------------------
+    size_type size()      const noexcept { return values_.size(); }
+    bool      empty()     const noexcept { return values_.empty(); }
+    size_type dimension() const noexcept { return dim_; }
+
+    /// @brief size() / dimension()
+    double
+    density() const noexcept {
+        return dim_ > 0 ? double(size()) / double(dim_) : 0.0;
+    }
+
+
+    //---------------------------------------------------------------
+    friend void
+    swap(sparse_vector& a, sparse_vector& b) noexcept {
+        using std::swap;
+        swap(a.values_,  b.values_);
+        swap(a.indices_, b.indices_);
+        swap(a.dim_,     b.dim_);
+    }
+
+
+private:
+    //---------------------------------------------------------------
+    size_type
+    position(size_type index) const noexcept {
+        return size_type(std::lower_bound(indices_.begin(), indices_.end(), index,
+            [](index_type i, size_type k) { return size_type(i) < k; })
+            - indices_.begin());
+    }
+
+    //---------------------------------------------------------------
+    value_vector values_;
+    index_vector indices_;
+    size_type dim_ = 0;
+};
+
+
+
+/*****************************************************************************
+ *
+ * @brief direction of a sparse matrix - sparse vector product
+ *
+ *****************************************************************************/
+enum class spmspv_direction {
+    /// @brief choose based on the number of entries x reaches
+    automatic,
+    /// @brief scatter the columns reached by nonzeros of x (uses A^T)
+    push,
+    /// @brief dot product of every row of A with x
+    pull
+};
+
+
+
+/*************************************************************************//***
+ *
+ * @brief sparse matrix - sparse vector product  y = A * x
+ *
+ * @details push: for every nonzero x[c] column c of A (= row c of A^T)
+ *                is scattered into a dense accumulator; touched rows are
+ *                collected and sorted (or bucket-scanned if there are many);
+ *                work ~ number of matrix entries in the columns of x
+ *          pull: every row of A is multiplied with x through a dense
+ *                lookup table; work ~ nnz(A), but purely streaming
+ *          The engine keeps A^T and all dense workspace arrays, so
+ *          multiply() doesn't allocate (except for growing y).
+ *          The referenced matrix must outlive the engine.
+ *
+ *****************************************************************************/
+template<class Matrix>
+class spmspv_engine
+{
+public:
+    //---------------------------------------------------------------
+    using matrix_type = Matrix;
+    using value_type  = typename Matrix::value_type;
+    using size_type   = std::size_t;
+
+
+    //---------------------------------------------------------------
+    /** @brief builds A^T for the push direction */
+    explicit
+    spmspv_engine(const matrix_type& a):
+        spmspv_engine(a, transpose(a))
+    {}
+
+    //-----------------------------------------------------
+    /** @param at  A^T (pass a copy of A if A is symmetric) */
+    spmspv_engine(const matrix_type& a, matrix_type at):
+        a_(a), at_(std::move(at)),
+        acc_(a.rows(), value_type(0)), touched_(a.rows(), 0), rows_{},
+        xval_(a.cols(), value_type(0)), xmask_((a.cols() + 63) / 64, 0)
+    {
+        rows_.reserve(a.rows());
+    }
+
+
+    //---------------------------------------------------------------
+    /** @brief  relative cost of one pushed matrix entry compared to one
+     *          pulled entry (default: 2, see bench/spmspv_bench.cpp);
+     *          push is chosen if (matrix entries reached by x) * factor
+     *          is smaller than nnz(A)
+     */
+    void push_cost_factor(double factor) noexcept { pushFactor_ = factor; }
+    double push_cost_factor() const noexcept { return pushFactor_; }
+
+    //-----------------------------------------------------
+    /// @return direction that multiply() would use for 'x'
+    template<class I, class VA>
+    spmspv_direction
+    choose_direction(const sparse_vector<value_type,I,VA>& x) const noexcept
+    {
+        const auto tbeg = at_.row_offset_data();
+        const auto idx = x.index_data();
+        const auto ncols = at_.rows();
+
+        double work = 0;
+        for(size_type i = 0; i < x.size(); ++i) {
+            const auto c = size_type(idx[i]);
+            if(c < ncols) work += double(tbeg[c+1] - tbeg[c]);
+        }
+        return (work * pushFactor_ < double(a_.size()))
+               ? spmspv_direction::push : spmspv_direction::pull;
+    }
+
+
+    //---------------------------------------------------------------
+    /**
+     * @brief  y = A * x
+     * @return the direction that was used
+     */
+    template<class I, class VA>
+    spmspv_direction
+    multiply(const sparse_vector<value_type,I,VA>& x,
+             sparse_vector<value_type,I,VA>& y,
+             spmspv_direction dir = spmspv_direction::automatic)
+    {
+        if(dir == spmspv_direction::automatic) dir = choose_direction(x);
+
+        y.clear();
+        y.dimension(a_.rows());
+
+        if(dir == spmspv_direction::push) push(x, y); else pull(x, y);
+        return dir;
+    }
+
+
+private:
+    //---------------------------------------------------------------
+    template<class I, class VA>
+    void
+    push(const sparse_vector<value_type,I,VA>& x,
+         sparse_vector<value_type,I,VA>& y)
+    {
+        const auto tval = at_.data();
+        const auto tcol = at_.col_index_data();
+        const auto tbeg = at_.row_offset_data();
+        const auto ncols = at_.rows();
+        const auto nrows = a_.rows();
+
+        const auto xval = x.data();
+        const auto xidx = x.index_data();
+
+        rows_.clear();
+        for(size_type i = 0; i < x.size(); ++i) {
+            const auto c = size_type(xidx[i]);
+            if(c >= ncols) continue;
+            const auto xc = xval[i];
+            for(auto k = size_type(tbeg[c]); k < size_type(tbeg[c+1]); ++k) {
+                const auto r = size_type(tcol[k]);
+                acc_[r] += tval[k] * xc;
+                if(!touched_[r]) {
+                    touched_[r] = 1;
+                    rows_.push_back(r);
+                }
+            }
+        }
+
+        y.reserve(rows_.size());
+
+        //many touched rows: bucket scan is cheaper than sorting
+        if(rows_.size() > nrows / 16) {
+            for(size_type r = 0; r < nrows; ++r) {
+                if(touched_[r]) emit(r, y);
+            }
+        } else {
+            std::sort(rows_.begin(), rows_.end());
+            for(const auto r : rows_) emit(r, y);
+        }
+    }
+
+    //-----------------------------------------------------
+    template<class I, class VA>
+    void
+    emit(size_type r, sparse_vector<value_type,I,VA>& y) noexcept
+    {
+        y.push_back(r, acc_[r]);
+        acc_[r] = value_type(0);
+        touched_[r] = 0;
+    }
+
+    //---------------------------------------------------------------
+    template<class I, class VA>
+    void
+    pull(const sparse_vector<value_type,I,VA>& x,
+         sparse_vector<value_type,I,VA>& y)
+    {
+        const auto val = a_.data();
+        const auto col = a_.col_index_data();
+        const auto beg = a_.row_offset_data();
+        const auto ncols = xval_.size();
+
+        const auto xval = x.data();
+        const auto xidx = x.index_data();
+
+        //dense lookup table + bitmap (small enough to stay in cache) of x
+        for(size_type i = 0; i < x.size(); ++i) {
+            const auto c = size_type(xidx[i]);
+            if(c < ncols) {
+                xval_[c] = xval[i];
+                xmask_[c / 64] |= std::uint64_t(1) << (c % 64);
+            }
+        }
+
+        for(size_type r = 0, n = a_.rows(); r < n; ++r) {
+            auto sum = value_type(0);
+            std::uint64_t hit = 0;
+            for(auto k = size_type(beg[r]); k < size_type(beg[r+1]); ++k) {
+                const auto c = size_type(col[k]);
+                sum += val[k] * xval_[c];
+                hit |= xmask_[c / 64] >> (c % 64);
+            }
+            if(hit & 1) y.push_back(r, sum);
+        }
+
+        for(size_type i = 0; i < x.size(); ++i) {
+            const auto c = size_type(xidx[i]);
+            if(c < ncols) {
+                xval_[c] = value_type(0);
+                xmask_[c / 64] = 0;
+            }
+        }
+    }
+
+
+    //---------------------------------------------------------------
+    const matrix_type& a_;
+    matrix_type at_;
+    std::vector<value_type> acc_;
+    std::vector<unsigned char> touched_;
+    std::vector<size_type> rows_;
+    std::vector<value_type> xval_;
+    std::vector<std::uint64_t> xmask_;
+    double pushFactor_ = 2.0;
+};
+
+
+}  // namespace am
+
+
+#endif
@@ -0,0 +1,543 @@
+/******************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2015-2017 André Müller
+ *
+ *****************************************************************************/
+
+#ifndef AMLIB_CONTAINERS_SYMMETRIC_CRS_MATRIX_H_
+#define AMLIB_CONTAINERS_SYMMETRIC_CRS_MATRIX_H_
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <iterator>
+#include <utility>
+
+#include "crs_matrix.h"
+#include "parallel.h"
+
+
+namespace am {
+
+
+/*************************************************************************//***
+ *
+ * @brief symmetric sparse matrix that stores only the lower triangle
+ *        (including the diagonal) in compressed row storage
+ *
+ * @details (row,col) and (col,row) refer to the same element;
+ *          all accessors mirror upper triangle positions to the lower one;
+ *          the matrix is always square: rows() == cols()
+ *
+ *****************************************************************************/
+template<
+    class ValueType,
+    class NAvalue = crs_matrix_static_value<ValueType,0>,
+    class Allocator = std::allocator<ValueType>,
+    class ColIndexType = std::size_t,
+    class RowOffsetType = std::size_t
+>
+class symmetric_crs_matrix
+{
+public:
+    //---------------------------------------------------------------
+    // TYPES
+    //---------------------------------------------------------------
+    using matrix_type     = crs_matrix<ValueType,NAvalue,Allocator,
+                                       ColIndexType,RowOffsetType>;
+    using value_type      = ValueType;
+    using size_type       = typename matrix_type::size_type;
+    using col_index_type  = typename matrix_type::col_index_type;
+    using row_offset_type = typename matrix_type::row_offset_type;
+    using const_iterator  = typename matrix_type::const_iterator;
+
+
+    //---------------------------------------------------------------
+    // CONSTRUCTION / DESTRUCTION
+    //---------------------------------------------------------------
+    symmetric_crs_matrix():
+        lower_{}
+    {}
+
+    //-----------------------------------------------------
+    /** @brief  takes the lower triangle (col <= row) of a square matrix;
+     *          elements above the diagonal are ignored
+     */
+    explicit
+    symmetric_crs_matrix(const matrix_type& m):
+        lower_{}
+    {
+        const auto n = std::max(m.rows(), m.cols());
+        const auto nrows = m.rows();
+        const auto val = m.data();
+        const auto col = m.col_index_data();
+        const auto beg = m.row_offset_data();
+
+        auto rowbeg = typename matrix_type::row_offset_storage(n + 1,
+                                                               row_offset_type(0));
+        for(size_type r = 0; r < nrows; ++r) {
+            //columns are sorted => lower part is a prefix of each row
+            const auto e = std::upper_bound(col + beg[r], col + beg[r+1],
+                                            col_index_type(r));
+            rowbeg[r+1] = row_offset_type(e - (col + beg[r]));
+        }
+        std::partial_sum(rowbeg.begin(), rowbeg.end(), rowbeg.begin());
+
+        const auto nnz = size_type(rowbeg[n]);
+        auto values = typename matrix_type::value_storage(nnz);
+        auto colidx = typename matrix_type::col_index_storage(nnz);
+        for(size_type r = 0; r < nrows; ++r) {
+            const auto len = size_type(rowbeg[r+1] - rowbeg[r]);
+            std::copy(val + beg[r], val + beg[r] + len, values.begin() + rowbeg[r]);
+            std::copy(col + beg[r], col + beg[r] + len, colidx.begin() + rowbeg[r]);
+        }
+
+        lower_ = matrix_type{std::move(values), std::move(colidx), std::move(rowbeg)};
+        lower_.cols(n);
+    }
+
+
+    //---------------------------------------------------------------
+    // BULK CONSTRUCTION
+    //---------------------------------------------------------------
+    /**
+     * @brief  builds matrix from an unsorted range of (row,col,value)
+     *         triplets; upper triangle triplets are mirrored to the lower
+     *         triangle, so (r,c) and (c,r) count as duplicates
+     *
+     * @param  combine     merges values of duplicate entries
+     * @param  numThreads  see crs_matrix::from_triplets
+     */
+    template<class ForwardIterator, class Combine = crs_keep_last>
+    static symmetric_crs_matrix
+    from_triplets(ForwardIterator first, ForwardIterator last,
+                  Combine combine = Combine{}, int numThreads = 1)
+    {
+        auto tri = std::vector<crs_triplet<value_type,size_type>>{};
+        tri.reserve(size_type(std::distance(first, last)));
+        for(; first != last; ++first) {
+            const auto r = size_type(first->row);
+            const auto c = size_type(first->col);
+            tri.push_back({std::max(r,c), std::min(r,c), first->value});
+        }
+        symmetric_crs_matrix s;
+        s.lower_ = matrix_type::from_triplets(tri.begin(), tri.end(),
+                                              std::move(combine), numThreads);
+        s.lower_.cols(s.lower_.rows());
+        return s;
+    }
+
+
+    //---------------------------------------------------------------
+    // MODIFY
+    //---------------------------------------------------------------
+    /** @brief  insert/modify value at (row,col) and (col,row)
+     *  @return true, if a new value has been inserted
+     *          false, if a value (that was already present) was modified
+     */
+    bool
+    insert(size_type row, size_type col, const value_type& val)
+    {
+        if(col > row) std::swap(row, col);
+        const bool inserted = lower_.insert(row, col, val).second;
+        if(lower_.cols() < lower_.rows()) lower_.cols(lower_.rows());
+        return inserted;
+    }
+
+    //-----------------------------------------------------
+    /** @brief  erase value at (row,col) and (col,row)
+     *  @return true if an element was erased, false otherwise
+     */
+    bool
+    erase(size_type row, size_type col)
+    {
+        if(col > row) std::swap(row, col);
+        return lower_.erase(row, col);
+    }
+
+    //-----------------------------------------------------
+    void
+    clear() {
+        lower_.clear();
+        lower_.rows(0);
+    }
+
+    //-----------------------------------------------------
+    /** @brief  sets the number of rows and columns;
+     *          all elements in rows/columns >= n are erased
+     */
+    void
+    dimension(size_type n)
+    {
+        lower_.rows(n);
+        lower_.cols(n);
+    }
+
+
+    //---------------------------------------------------------------
+    // ELEMENT ACCESS
+    //---------------------------------------------------------------
+    bool
+    has(size_type row, size_type col) const {
+        if(col > row) std::swap(row, col);
+        return lower_.has(row, col);
+    }
+
+    //-----------------------------------------------------
+    /** @return stored value at (row,col) or (col,row) or the n/a value
+     */
+    value_type
+    operator () (size_type row, size_type col) const {
+        if(col > row) std::swap(row, col);
+        return lower_(row, col);
+    }
+
+    //-----------------------------------------------------
+    static constexpr value_type
+    na_value() noexcept {
+        return matrix_type::na_value();
+    }
+
+
+    //---------------------------------------------------------------
+    // DIRECT ACCESS TO LOWER TRIANGLE
+    //---------------------------------------------------------------
+    /// @return stored lower triangle (col <= row)
+    const matrix_type&
+    lower() const noexcept {
+        return lower_;
+    }
+
+    //-----------------------------------------------------
+    const value_type*     data()            const noexcept { return lower_.data(); }
+    const col_index_type* col_index_data()  const noexcept { return lower_.col_index_data(); }
+    const row_offset_type* row_offset_data() const noexcept { return lower_.row_offset_data(); }
+
+    //-----------------------------------------------------
+    const_iterator begin_row(size_type row) const noexcept { return lower_.begin_row(row); }
+    const_iterator end_row(size_type row)   const noexcept { return lower_.end_row(row); }
+
+    size_type
+    col_index_of(const_iterator it) const noexcept {
+        return lower_.col_index_of(it);
+    }
+
+
+    //---------------------------------------------------------------
+    /// @return matrix with both triangles
+    matrix_type
+    to_crs_matrix() const
+    {
+        const auto n = rows();
+        const auto val = lower_.data();
+        const auto col = lower_.col_index_data();
+        const auto beg = lower_.row_offset_data();
+
+        //row r: lower part of row r + column r of the lower triangle below r
+        auto rowbeg = typename matrix_type::row_offset_storage(n + 1,
+                                                               row_offset_type(0));
+        for(size_type r = 0; r < n; ++r) {
+            rowbeg[r+1] += beg[r+1] - beg[r];
+            for(auto j = beg[r]; j < beg[r+1]; ++j) {
+                if(size_type(col[j]) < r) ++rowbeg[size_type(col[j]) + 1];
+            }
+        }
+        std::partial_sum(rowbeg.begin(), rowbeg.end(), rowbeg.begin());
+
+        const auto nnz = size_type(rowbeg[n]);
+        auto values = typename matrix_type::value_storage(nnz);
+        auto colidx = typename matrix_type::col_index_storage(nnz);
+        auto pos = std::vector<size_type>(rowbeg.begin(), rowbeg.end() - 1);
+
+        //visiting rows in ascending order keeps all columns sorted:
+        //row r gets its own entries (cols <= r) before the mirrored
+        //ones (cols > r), which arrive in ascending order
+        for(size_type r = 0; r < n; ++r) {
+            for(auto j = beg[r]; j < beg[r+1]; ++j) {
+                const auto c = size_type(col[j]);
+                values[pos[r]] = val[j];
+                colidx[pos[r]++] = col_index_type(c);
+                if(c < r) {
+                    values[pos[c]] = val[j];
+                    colidx[pos[c]++] = col_index_type(r);
+                }
+            }
+        }
+
+        auto m = matrix_type{std::move(values), std::move(colidx), std::move(rowbeg)};
+        m.cols(n);
+        return m;
+    }
+
+
+    //---------------------------------------------------------------
+    // SIZE PROPERTIES
+    //---------------------------------------------------------------
+    /// @return number of stored elements (lower triangle only)
+    size_type
+    size() const noexcept {
+        return lower_.size();
+    }
+    //-----------------------------------------------------
+    /// @return number of non-n/a elements of the full matrix
+    size_type
+    full_size() const noexcept {
+        const auto col = lower_.col_index_data();
+        const auto beg = lower_.row_offset_data();
+        size_type diag = 0;
+        for(size_type r = 0, n = rows(); r < n; ++r) {
+            if(beg[r] < beg[r+1] && size_type(col[beg[r+1] - 1]) == r) ++diag;
+        }
+        return 2 * size() - diag;
+    }
+    //-----------------------------------------------------
+    bool
+    empty() const noexcept {
+        return lower_.empty();
+    }
+    //-----------------------------------------------------
+    size_type
+    rows() const noexcept {
+        return lower_.rows();
+    }
+    //-----------------------------------------------------
+    size_type
+    cols() const noexcept {
+        return lower_.rows();
+    }
+
+
+    //---------------------------------------------------------------
+    friend void
+    swap(symmetric_crs_matrix& a, symmetric_crs_matrix& b) noexcept {
+        using std::swap;
+        swap(a.lower_, b.lower_);
+    }
+
+
+private:
+    matrix_type lower_;
+};
+
+
+
+
+namespace crs_detail {
+
+/*****************************************************************************
+ *
+ * @brief  y += alpha * S * x  for the rows [first,last) of S;
+ *         transposed updates to rows c < first go to buf[c - bufFirst]
+ *
+ *****************************************************************************/
+template<class T, class CI, class RO>
+void
+symmetric_spmv_rows(const T* val, const CI* col, const RO* beg,
+                    std::size_t first, std::size_t last,
+                    const T* x, T* y, T* buf, std::size_t bufFirst,
+                    const T& alpha) noexcept
+{
+    for(std::size_t r = first; r < last; ++r) {
+        const T ax = alpha * x[r];
+        T sum = T(0);
+        for(auto j = beg[r]; j < beg[r+1]; ++j) {
+            const auto c = std::size_t(col[j]);
+            sum += val[j] * x[c];
+            if(c < r) {
+                if(c >= first) y[c] += val[j] * ax;
+                else         buf[c - bufFirst] += val[j] * ax;
+            }
+        }
+        y[r] += alpha * sum;
+    }
+}
+
+}  // namespace crs_detail
+
+
+
+/*************************************************************************//***
+ *
+ * @brief per-thread buffers of the multithreaded symmetric matrix - vector
+ *        product; keeping one instance around avoids allocating the
+ *        buffers anew on every call
+ *
+ * @details one workspace must not be used by concurrent calls
+ *
+ *****************************************************************************/
+template<class T>
+class symmetric_spmv_workspace
+{
+public:
+    //---------------------------------------------------------------
+    /**
+     * @brief  y = alpha * S * x + beta * y
+     *
+     * @details rows are distributed by non-zeros; a thread owning the rows
+     *          [first,last) updates y[first,last) directly and collects
+     *          mirrored updates of the rows [c,first) in its own buffer
+     *          (c: smallest column index stored in the block);
+     *          the buffers are summed into y in a final parallel pass
+     */
+    template<class NA, class A, class CI, class RO>
+    void
+    multiply(const symmetric_crs_matrix<T,NA,A,CI,RO>& s, const T* x, T* y,
+             const T& alpha, const T& beta, int numThreads)
+    {
+        const std::size_t n = s.rows();
+        if(n < 1) return;
+
+        const auto val = s.data();
+        const auto col = s.col_index_data();
+        const auto beg = s.row_offset_data();
+
+        const auto scale = [&](std::size_t first, std::size_t last) {
+            if(beta == T(0)) std::fill(y + first, y + last, T(0));
+            else for(auto i = first; i < last; ++i) y[i] *= beta;
+        };
+
+        numThreads = effective_thread_count(numThreads);
+
+        if(numThreads < 2) {
+            scale(0, n);
+            crs_detail::symmetric_spmv_rows(val, col, beg, 0, n, x, y,
+                                            static_cast<T*>(nullptr), 0, alpha);
+            return;
+        }
+
+        const auto bounds = weighted_partition(beg, n, numThreads);
+        const auto parts = bounds.size() - 1;
+        if(buffers_.size() < parts) buffers_.resize(parts);
+        bufFirst_.resize(parts);
+
+        parallel_for_blocks(bounds,
+            [&](std::size_t first, std::size_t last, int part) {
+                scale(first, last);
+
+                //mirrored updates only reach [smallest column, first)
+                auto lo = first;
+                for(auto r = first; r < last; ++r) {
+                    if(beg[r] < beg[r+1]) {
+                        lo = std::min(lo, std::size_t(col[beg[r]]));
+                    }
+                }
+                auto& buf = buffers_[std::size_t(part)];
+                buf.assign(first - lo, T(0));
+                bufFirst_[std::size_t(part)] = lo;
+
+                crs_detail::symmetric_spmv_rows(val, col, beg, first, last,
+                                                x, y, buf.data(), lo, alpha);
+            });
+
+        //add up buffers; no buffer reaches beyond the first row of the last part
+        parallel_for_blocks(std::size_t(0), bounds[parts-1], numThreads,
+            [&](std::size_t first, std::size_t last, int) {
+                for(std::size_t p = 1; p < parts; ++p) {
+                    const auto lo = bufFirst_[p];
+                    const auto b = std::max(first, lo);
+                    const auto e = std::min(last, bounds[p]);
+                    const auto buf = buffers_[p].data();
+                    for(auto i = b; i < e; ++i) y[i] += buf[i - lo];
+                }
+            });
+    }
+
+    //---------------------------------------------------------------
+    /// @brief releases all buffer memory
+    void
+    clear() noexcept {
+        buffers_.clear();
+        buffers_.shrink_to_fit();
+        bufFirst_.clear();
+        bufFirst_.shrink_to_fit();
+    }
+
+private:
+    std::vector<std::vector<T>> buffers_;
+    std::vector<std::size_t> bufFirst_;
+};
+
+
+
+/*************************************************************************//***
+ *
+ * @brief symmetric matrix - dense vector product  y = alpha * S * x + beta * y
+ *
+ * @param  x           has to hold at least S.rows() values
+ * @param  y           has to hold at least S.rows() values;
+ *                     is not read if beta == 0
+ * @param  ws          per-thread buffers; reused between calls
+ * @param  numThreads  1 => serial; 0 => hardware concurrency
+ *
+ * @details every stored off-diagonal element (r,c) is applied twice:
+ *          to y[r] and (mirrored) to y[c]
+ *
+ *****************************************************************************/
+template<class T, class NA, class A, class CI, class RO>
+void
+spmv(const symmetric_crs_matrix<T,NA,A,CI,RO>& s, const T* x, T* y,
+     symmetric_spmv_workspace<T>& ws,
+     const T& alpha = T(1), const T& beta = T(0),
+     int numThreads = 1)
+{
+    ws.multiply(s, x, y, alpha, beta, numThreads);
+}
+
+//-------------------------------------------------------------------
+/**
+ * @brief symmetric matrix - dense vector product  y = alpha * S * x + beta * y
+ *        with a temporary workspace
+ */
+template<class T, class NA, class A, class CI, class RO>
+void
+spmv(const symmetric_crs_matrix<T,NA,A,CI,RO>& s, const T* x, T* y,
+     const T& alpha = T(1), const T& beta = T(0),
+     int numThreads = 1)
+{
+    auto ws = symmetric_spmv_workspace<T>{};
+    ws.multiply(s, x, y, alpha, beta, numThreads);
+}
+
+//-------------------------------------------------------------------
+/**
+ * @brief symmetric matrix - dense vector product  y = alpha * S * x + beta * y
+ *        y is resized to S.rows() if it is too small
+ */
+template<class T, class NA, class A, class CI, class RO, class VA>
+void
+spmv(const symmetric_crs_matrix<T,NA,A,CI,RO>& s,
+     const std::vector<T,VA>& x, std::vector<T,VA>& y,
+     symmetric_spmv_workspace<T>& ws,
+     const T& alpha = T(1), const T& beta = T(0),
+     int numThreads = 1)
+{
+    if(y.size() < s.rows()) y.resize(s.rows(), T(0));
+    ws.multiply(s, x.data(), y.data(), alpha, beta, numThreads);
+}
+
+//-------------------------------------------------------------------
+/**
+ * @brief symmetric matrix - dense vector product  y = alpha * S * x + beta * y
+ *        y is resized to S.rows() if it is too small
+ */
+template<class T, class NA, class A, class CI, class RO, class VA>
+void
+spmv(const symmetric_crs_matrix<T,NA,A,CI,RO>& s,
+     const std::vector<T,VA>& x, std::vector<T,VA>& y,
+     const T& alpha = T(1), const T& beta = T(0),
+     int numThreads = 1)
+{
+    auto ws = symmetric_spmv_workspace<T>{};
+    spmv(s, x, y, ws, alpha, beta, numThreads);
+}
+
+
+}  // namespace am
+
+
+#endif
@@ -0,0 +1,144 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "bsr_matrix.h"
+
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+/// @brief matrix made of dense (B x B) blocks (plus optional scattered
+///        single elements) with dimensions that are no multiples of B
+template<class T, std::size_t B>
+crs_matrix<T> make_block_matrix(std::size_t rows, std::size_t cols,
+                                std::size_t numBlocks, std::size_t numSingles)
+{
+    auto urbg = std::mt19937{};
+    auto brDistr = std::uniform_int_distribution<std::size_t>{0, rows / B - 1};
+    auto bcDistr = std::uniform_int_distribution<std::size_t>{0, cols / B - 1};
+    auto rDistr  = std::uniform_int_distribution<std::size_t>{0, rows - 1};
+    auto cDistr  = std::uniform_int_distribution<std::size_t>{0, cols - 1};
+    auto valDistr = std::uniform_int_distribution<int>{1,9};
+
+    auto tri = std::vector<crs_triplet<T>>{};
+    for(std::size_t k = 0; k < numBlocks; ++k) {
+        const auto r0 = brDistr(urbg) * B;
+        const auto c0 = bcDistr(urbg) * B;
+        for(std::size_t i = 0; i < B; ++i) {
+            for(std::size_t j = 0; j < B; ++j) {
+                tri.push_back({r0+i, c0+j, T(valDistr(urbg))});
+            }
+        }
+    }
+    for(std::size_t k = 0; k < numSingles; ++k) {
+        tri.push_back({rDistr(urbg), cDistr(urbg), T(valDistr(urbg))});
+    }
+    auto m = crs_matrix<T>::from_triplets(tri.begin(), tri.end());
+    m.rows(rows);
+    m.cols(cols);
+    return m;
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T, std::size_t B>
+void test_conversion(std::size_t numSingles)
+{
+    const auto m = make_block_matrix<T,B>(10*B + 1, 12*B + 2, 30, numSingles);
+    const auto b = bsr_matrix<T,B>{m};
+
+    if(b.rows() != m.rows() || b.cols() != m.cols() ||
+       b.block_rows() != (m.rows() + B - 1) / B)
+    {
+        throw std::logic_error{"bsr_matrix: dimensions"};
+    }
+
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        for(std::size_t c = 0; c < m.cols(); ++c) {
+            if(b(r,c) != m(r,c))
+                throw std::logic_error{"bsr_matrix: values"};
+            if(m.has(r,c) && !b.has(r,c))
+                throw std::logic_error{"bsr_matrix: structure"};
+        }
+    }
+
+    //every stored block covers at least one stored element
+    for(std::size_t br = 0; br < b.block_rows(); ++br) {
+        for(auto c = b.begin_col_indices(br); c != b.end_col_indices(br); ++c) {
+            bool covered = false;
+            for(std::size_t i = 0; i < B; ++i) {
+                for(std::size_t j = 0; j < B; ++j) {
+                    covered = covered || m.has(br*B + i, std::size_t(*c)*B + j);
+                }
+            }
+            if(!covered) throw std::logic_error{"bsr_matrix: empty block"};
+        }
+    }
+
+    const auto fill = block_fill_ratio(m, B, B);
+    if(numSingles == 0 && fill < 0.999)
+        throw std::logic_error{"bsr_matrix: fill ratio of pure block matrix"};
+    if(fill <= 0 || fill > 1)
+        throw std::logic_error{"bsr_matrix: fill ratio range"};
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T, std::size_t B>
+void test_spmv(int numThreads)
+{
+    const auto m = make_block_matrix<T,B>(40*B + 2, 30*B + 1, 300, 50);
+    const auto b = bsr_matrix<T,B>{m};
+
+    auto x = std::vector<T>(m.cols());
+    for(std::size_t i = 0; i < x.size(); ++i) x[i] = T(i % 7) - T(3);
+
+    auto y = std::vector<T>(m.rows(), T(1));
+    spmv(b, x, y, T(2), T(3), numThreads);
+
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        T ref = T(0);
+        for(auto i = m.begin_row(r); i != m.end_row(r); ++i) {
+            ref += *i * x[m.col_index_of(i)];
+        }
+        ref = T(2) * ref + T(3);
+        if(std::abs(double(y[r] - ref)) > 1e-9)
+            throw std::logic_error{"bsr_matrix: spmv"};
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_conversion<int,3>(0);
+        test_conversion<int,3>(20);
+        test_conversion<double,4>(0);
+        test_conversion<double,4>(15);
+        test_spmv<double,3>(1);
+        test_spmv<double,4>(3);
+        test_spmv<int,3>(0);
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
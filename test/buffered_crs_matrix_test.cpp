@@ -0,0 +1,153 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "buffered_crs_matrix.h"
+
+#include <map>
+#include <utility>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+void check_content(const std::map<std::pair<std::size_t,std::size_t>,int>& ref,
+                   const Matrix& m, std::size_t n)
+{
+    if(m.size() != ref.size())
+        throw std::logic_error{"buffered_crs_matrix: size"};
+
+    for(std::size_t r = 0; r < n; ++r) {
+        for(std::size_t c = 0; c < n; ++c) {
+            const auto it = ref.find(std::make_pair(r,c));
+            const bool stored = it != ref.end();
+            if(m.has(r,c) != stored)
+                throw std::logic_error{"buffered_crs_matrix: has"};
+            if(m(r,c) != (stored ? it->second : 0))
+                throw std::logic_error{"buffered_crs_matrix: value"};
+        }
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+void test_random_updates(std::size_t minDelta, double fraction)
+{
+    constexpr std::size_t n = 40;
+
+    auto urbg = std::mt19937{};
+    auto idxDistr = std::uniform_int_distribution<std::size_t>{0,n-1};
+    auto valDistr = std::uniform_int_distribution<int>{1,100};
+    auto opDistr  = std::uniform_int_distribution<int>{0,3};
+
+    auto ref = std::map<std::pair<std::size_t,std::size_t>,int>{};
+    auto m = buffered_crs_matrix<int>{};
+    m.min_delta_size(minDelta);
+    m.max_delta_fraction(fraction);
+
+    for(int i = 0; i < 3000; ++i) {
+        const auto r = idxDistr(urbg);
+        const auto c = idxDistr(urbg);
+        if(opDistr(urbg) == 0) {
+            const bool erased = ref.erase(std::make_pair(r,c)) > 0;
+            if(m.erase(r,c) != erased)
+                throw std::logic_error{"buffered_crs_matrix: erase"};
+        } else {
+            const auto v = valDistr(urbg);
+            const bool isNew = ref.find(std::make_pair(r,c)) == ref.end();
+            ref[std::make_pair(r,c)] = v;
+            if(m.insert(r,c,v) != isNew)
+                throw std::logic_error{"buffered_crs_matrix: insert"};
+        }
+        if(m.delta_size() > std::max(minDelta, std::size_t(fraction * 3000)))
+            throw std::logic_error{"buffered_crs_matrix: auto compaction"};
+
+        if(i % 500 == 0) check_content(ref, m, n);
+    }
+    check_content(ref, m, n);
+
+    const auto& crs = m.compacted();
+    if(m.delta_size() != 0)
+        throw std::logic_error{"buffered_crs_matrix: compact"};
+
+    check_content(ref, crs, n);
+    check_content(ref, m, n);
+
+    //column indices have to be sorted within rows
+    for(std::size_t r = 0; r < crs.rows(); ++r) {
+        if(!std::is_sorted(crs.begin_col_indices(r), crs.end_col_indices(r)))
+            throw std::logic_error{"buffered_crs_matrix: column order"};
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+void test_wrapping()
+{
+    auto base = crs_matrix<int>{};
+    base.insert(0, 1, 10);
+    base.insert(2, 3, 23);
+    base.insert(2, 5, 25);
+
+    auto m = buffered_crs_matrix<int>{base};
+    m.insert(2, 4, 24);
+    m.insert(1, 0, 10);
+    m.erase(2, 5);
+    m.insert(0, 1, 11);
+    m.insert(4, 2, 42);
+
+    if(m.delta_size() != 5)
+        throw std::logic_error{"buffered_crs_matrix: buffering"};
+
+    if(m(2,4) != 24 || m(0,1) != 11 || m.has(2,5) || m(2,3) != 23)
+        throw std::logic_error{"buffered_crs_matrix: lookup"};
+
+    if(m.rows() != 5 || m.cols() != 6)
+        throw std::logic_error{"buffered_crs_matrix: extents"};
+
+    const auto& c = m.compacted();
+    if(c.size() != 5 || c(2,4) != 24 || c(4,2) != 42 || c(1,0) != 10 ||
+       c.has(2,5) || c.rows() != 5 || c.cols() != 5)
+    {
+        throw std::logic_error{"buffered_crs_matrix: merge"};
+    }
+    if(m.cols() != 5)
+        throw std::logic_error{"buffered_crs_matrix: extents after merge"};
+
+    //declared number of columns survives the merge
+    base.cols(8);
+    auto d = buffered_crs_matrix<int>{base};
+    d.erase(2, 5);
+    if(d.compacted().cols() != 8 || d.cols() != 8)
+        throw std::logic_error{"buffered_crs_matrix: declared columns"};
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_wrapping();
+        test_random_updates(1024, 0.1);
+        test_random_updates(16, 0.05);
+        test_random_updates(0, 0.0);
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
@@ -0,0 +1,242 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "compressed_crs_matrix.h"
+
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <cmath>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+/// @brief banded matrix with a few far-off columns (large deltas)
+template<class T>
+crs_matrix<T> make_banded_matrix(std::size_t rows, std::size_t cols)
+{
+    auto urbg = std::mt19937{};
+    auto farDistr = std::uniform_int_distribution<std::size_t>{0, cols - 1};
+    auto valDistr = std::uniform_int_distribution<int>{1,9};
+
+    auto tri = std::vector<crs_triplet<T>>{};
+    for(std::size_t r = 0; r < rows; ++r) {
+        if(r % 7 == 3) continue;  //some empty rows
+        for(std::size_t c = (r > 3 ? r - 3 : 0); c < std::min(cols, r + 4); ++c) {
+            tri.push_back({r, c, T(valDistr(urbg))});
+        }
+        if(r % 5 == 0) tri.push_back({r, farDistr(urbg), T(valDistr(urbg))});
+    }
+    tri.push_back({0, cols - 1, T(1)});
+    auto m = crs_matrix<T>::from_triplets(tri.begin(), tri.end());
+    m.rows(rows);
+    m.cols(cols);
+    return m;
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+void test_decoding()
+{
+    //wide matrix => multi-byte varints
+    const auto m = make_banded_matrix<T>(300, 1u << 20);
+    const auto c = compressed_crs_matrix<T>{m};
+
+    if(c.rows() != m.rows() || c.cols() != m.cols() || c.size() != m.size())
+        throw std::logic_error{"compressed_crs_matrix: sizes"};
+
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        if(c.row_size(r) != m.row_size(r))
+            throw std::logic_error{"compressed_crs_matrix: row size"};
+
+        auto it = c.begin_row(r);
+        for(auto j = m.begin_row(r); j != m.end_row(r); ++j, ++it) {
+            if(it == c.end_row(r) || it.col() != m.col_index_of(j) || *it != *j)
+                throw std::logic_error{"compressed_crs_matrix: row iteration"};
+            if(c(r, it.col()) != *j || !c.has(r, it.col()))
+                throw std::logic_error{"compressed_crs_matrix: element access"};
+        }
+        if(it != c.end_row(r))
+            throw std::logic_error{"compressed_crs_matrix: row end"};
+    }
+    if(c.has(1, 200) || c(1, 200) != T(0) || c(m.rows(), 0) != T(0))
+        throw std::logic_error{"compressed_crs_matrix: missing element"};
+
+    //8-byte source indices, mostly 1-byte deltas
+    if(c.compression_ratio() < 3.0 || c.memory_bytes() <= c.index_bytes())
+        throw std::logic_error{"compressed_crs_matrix: compression ratio"};
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+void test_conversion(int numThreads)
+{
+    const auto m = make_banded_matrix<T>(211, 100000);
+    const auto c = compressed_crs_matrix<T>{m};
+
+    const auto m2 = c.to_crs_matrix(numThreads);
+    if(m2.rows() != m.rows() || m2.cols() != m.cols() || m2.size() != m.size())
+        throw std::logic_error{"compressed_crs_matrix: conversion sizes"};
+
+    for(std::size_t i = 0; i < m.size(); ++i) {
+        if(m2.data()[i] != m.data()[i] ||
+           m2.col_index_data()[i] != m.col_index_data()[i])
+        {
+            throw std::logic_error{"compressed_crs_matrix: conversion values"};
+        }
+    }
+    for(std::size_t r = 0; r <= m.rows(); ++r) {
+        if(m2.row_offset_data()[r] != m.row_offset_data()[r])
+            throw std::logic_error{"compressed_crs_matrix: conversion offsets"};
+    }
+
+    //compact target index types
+    using compact_t = crs_matrix<T,crs_matrix_static_value<T,0>,
+                                 std::allocator<T>,std::uint32_t,std::uint32_t>;
+    const auto m3 = c.template to_crs_matrix<compact_t>(numThreads);
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        for(auto j = m.begin_row(r); j != m.end_row(r); ++j) {
+            if(m3(r, m.col_index_of(j)) != *j)
+                throw std::logic_error{"compressed_crs_matrix: compact conversion"};
+        }
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+void test_spmv(int numThreads)
+{
+    const auto m = make_banded_matrix<T>(157, 5000);
+    const auto c = compressed_crs_matrix<T>{m};
+
+    auto x = std::vector<T>(m.cols());
+    for(std::size_t i = 0; i < x.size(); ++i) x[i] = T(int(i % 7) - 3);
+
+    auto ref = std::vector<T>(m.rows(), T(0));
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        for(auto j = m.begin_row(r); j != m.end_row(r); ++j) {
+            ref[r] += *j * x[m.col_index_of(j)];
+        }
+    }
+
+    auto y = std::vector<T>{};
+    spmv(c, x, y, T(1), T(0), numThreads);
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        if(std::abs(double(y[r] - ref[r])) > 1e-9)
+            throw std::logic_error{"compressed_crs_matrix: spmv"};
+    }
+
+    //y = 2*A*x - y  =>  y = A*x
+    spmv(c, x, y, T(2), T(-1), numThreads);
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        if(std::abs(double(y[r] - ref[r])) > 1e-9)
+            throw std::logic_error{"compressed_crs_matrix: spmv alpha/beta"};
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+void test_empty()
+{
+    const auto c = compressed_crs_matrix<double>{crs_matrix<double>{}};
+    if(!c.empty() || c.rows() != 0 || c.compression_ratio() != 1.0)
+        throw std::logic_error{"compressed_crs_matrix: empty"};
+
+    const auto m = c.to_crs_matrix();
+    if(!m.empty() || m.rows() != 0)
+        throw std::logic_error{"compressed_crs_matrix: empty conversion"};
+}
+
+
+
+//-------------------------------------------------------------------
+void test_na_value()
+{
+    using na_t = crs_matrix_static_value<int,-1>;
+
+    auto m = crs_matrix<int,na_t>{};
+    m.insert(0, 2, 5);
+    m.insert(3, 1, 7);
+
+    const auto c = compressed_crs_matrix<int,na_t>{m};
+    if(c.na_value() != -1 || c(0,2) != 5 || c(0,1) != -1 || c(2,2) != -1 ||
+       c(9,0) != -1)
+    {
+        throw std::logic_error{"compressed_crs_matrix: na_value"};
+    }
+
+    const auto d = c.to_crs_matrix();
+    if(d.na_value() != -1 || d(3,1) != 7 || d(3,0) != -1)
+        throw std::logic_error{"compressed_crs_matrix: na_value conversion"};
+}
+
+
+
+//-------------------------------------------------------------------
+void test_index_type_limits()
+{
+    using tiny_t = crs_matrix<int,crs_matrix_static_value<int,0>,
+                              std::allocator<int>,std::uint8_t,std::uint8_t>;
+
+    auto wide = crs_matrix<int>{};
+    wide.insert(0, 300, 1);
+    bool thrown = false;
+    try { compressed_crs_matrix<int>{wide}.to_crs_matrix<tiny_t>(); }
+    catch(std::out_of_range&) { thrown = true; }
+    if(!thrown) throw std::logic_error{"compressed_crs_matrix: column index range"};
+
+    auto full = crs_matrix<int>{};
+    for(std::size_t i = 0; i < 300; ++i) full.insert(i, i % 7, 1);
+    thrown = false;
+    try { compressed_crs_matrix<int>{full}.to_crs_matrix<tiny_t>(); }
+    catch(std::length_error&) { thrown = true; }
+    if(!thrown) throw std::logic_error{"compressed_crs_matrix: element count range"};
+
+    auto fits = crs_matrix<int>{};
+    fits.insert(2, 255, 4);
+    const auto t = compressed_crs_matrix<int>{fits}.to_crs_matrix<tiny_t>();
+    if(t.size() != 1 || t(2,255) != 4 || t.cols() != 256)
+        throw std::logic_error{"compressed_crs_matrix: compact index types"};
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_decoding<double>();
+        test_decoding<int>();
+        test_conversion<double>(1);
+        test_conversion<float>(3);
+        test_spmv<double>(1);
+        test_spmv<double>(4);
+        test_spmv<int>(0);
+        test_empty();
+        test_na_value();
+        test_index_type_limits();
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
@@ -0,0 +1,219 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "crs_graph.h"
+
+#include <vector>
+#include <deque>
+#include <cmath>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+
+
+using namespace am;
+
+using graph_t = crs_graph<crs_matrix<float>>;
+
+
+//-------------------------------------------------------------------
+crs_matrix<float>
+make_random_graph(std::size_t n, std::size_t m, unsigned seed)
+{
+    auto urbg = std::mt19937{seed};
+    auto distr = std::uniform_int_distribution<std::size_t>{0, n-1};
+
+    auto tri = std::vector<crs_triplet<float>>{};
+    for(std::size_t i = 0; i < m; ++i) {
+        tri.push_back({distr(urbg), distr(urbg), 1.0f});
+    }
+    auto a = crs_matrix<float>::from_triplets(tri.begin(), tri.end());
+    a.rows(n);
+    a.cols(n);
+    return a;
+}
+
+
+//-------------------------------------------------------------------
+std::vector<std::size_t>
+reference_bfs(const crs_matrix<float>& a, std::size_t source)
+{
+    auto depth = std::vector<std::size_t>(a.rows(), graph_t::unreached);
+    auto queue = std::deque<std::size_t>{source};
+    depth[source] = 0;
+    while(!queue.empty()) {
+        const auto u = queue.front();
+        queue.pop_front();
+        for(auto it = a.begin_row(u); it != a.end_row(u); ++it) {
+            const auto v = a.col_index_of(it);
+            if(depth[v] == graph_t::unreached) {
+                depth[v] = depth[u] + 1;
+                queue.push_back(v);
+            }
+        }
+    }
+    return depth;
+}
+
+
+//-------------------------------------------------------------------
+void check_bfs(const crs_matrix<float>& a, graph_t& g, std::size_t source,
+               std::size_t reached)
+{
+    const auto expected = reference_bfs(a, source);
+    std::size_t count = 0;
+    for(std::size_t v = 0; v < a.rows(); ++v) {
+        if(g.depth(v) != expected[v])
+            throw std::logic_error{"crs_graph: bfs depth"};
+        if(expected[v] == graph_t::unreached) {
+            if(g.parent(v) != graph_t::unreached)
+                throw std::logic_error{"crs_graph: bfs parent of unreached"};
+            continue;
+        }
+        ++count;
+        const auto p = g.parent(v);
+        if(v == source) {
+            if(p != source) throw std::logic_error{"crs_graph: bfs source"};
+        }
+        else if(!a.has(p, v) || g.depth(p) + 1 != g.depth(v)) {
+            throw std::logic_error{"crs_graph: bfs tree"};
+        }
+    }
+    if(count != reached) throw std::logic_error{"crs_graph: bfs reached"};
+}
+
+
+//-------------------------------------------------------------------
+void test_bfs()
+{
+    const auto a = make_random_graph(3000, 15000, 1);
+    auto g = graph_t{a};
+
+    for(int threads : {1, 4}) {
+        //default heuristics: should use both directions on this graph
+        const auto r = g.bfs(0, threads);
+        check_bfs(a, g, 0, r);
+        if(g.bfs_top_down_steps() < 1 || g.bfs_bottom_up_steps() < 1)
+            throw std::logic_error{"crs_graph: bfs direction switching"};
+
+        //top-down only
+        g.bfs_alpha(1e-12);
+        check_bfs(a, g, 17, g.bfs(17, threads));
+        if(g.bfs_bottom_up_steps() != 0)
+            throw std::logic_error{"crs_graph: bfs top-down only"};
+
+        //bottom-up right away
+        std::size_t source = 5;
+        while(g.out_degree(source) < 1) ++source;
+        g.bfs_alpha(1e12);
+        g.bfs_beta(1e12);
+        check_bfs(a, g, source, g.bfs(source, threads));
+        if(g.bfs_top_down_steps() != 0)
+            throw std::logic_error{"crs_graph: bfs bottom-up only"};
+
+        g.bfs_alpha(14);
+        g.bfs_beta(24);
+    }
+
+    //undirected path graph: A is its own transpose
+    auto tri = std::vector<crs_triplet<float>>{};
+    for(std::size_t i = 0; i + 1 < 200; ++i) {
+        tri.push_back({i, i+1, 1.0f});
+        tri.push_back({i+1, i, 1.0f});
+    }
+    const auto path = crs_matrix<float>::from_triplets(tri.begin(), tri.end());
+    auto pg = graph_t{path, path};
+    if(pg.bfs(100, 2) != 200 || pg.depth(0) != 100 || pg.depth(199) != 99)
+        throw std::logic_error{"crs_graph: bfs path"};
+
+    if(pg.bfs(1000) != 0) throw std::logic_error{"crs_graph: bfs bad source"};
+}
+
+
+
+//-------------------------------------------------------------------
+std::vector<double>
+reference_pagerank(const crs_matrix<float>& a, double d, std::size_t iterations)
+{
+    const auto n = a.rows();
+    auto rank = std::vector<double>(n, 1.0 / double(n));
+    for(std::size_t it = 0; it < iterations; ++it) {
+        auto next = std::vector<double>(n, 0.0);
+        double dangling = 0;
+        for(std::size_t u = 0; u < n; ++u) {
+            const auto deg = a.row_size(u);
+            if(deg < 1) { dangling += rank[u]; continue; }
+            for(auto j = a.begin_row(u); j != a.end_row(u); ++j) {
+                next[a.col_index_of(j)] += d * rank[u] / double(deg);
+            }
+        }
+        for(auto& r : next) r += (1.0 - d + d * dangling) / double(n);
+        rank.swap(next);
+    }
+    return rank;
+}
+
+
+//-------------------------------------------------------------------
+void test_pagerank()
+{
+    //sparse graph => has vertices without out-edges
+    const auto a = make_random_graph(500, 1200, 2);
+    auto g = graph_t{a};
+
+    auto settings = pagerank_settings{};
+    settings.tolerance = 1e-12;
+    settings.max_iterations = 500;
+
+    const auto s1 = g.pagerank(settings);
+    const auto r1 = g.ranks();
+    if(!s1.converged || s1.residual >= settings.tolerance)
+        throw std::logic_error{"crs_graph: pagerank convergence"};
+
+    double sum = 0;
+    for(auto r : r1) sum += r;
+    if(std::abs(sum - 1.0) > 1e-9)
+        throw std::logic_error{"crs_graph: pagerank mass"};
+
+    const auto ref = reference_pagerank(a, settings.damping, s1.iterations);
+    for(std::size_t v = 0; v < r1.size(); ++v) {
+        if(std::abs(r1[v] - ref[v]) > 1e-9)
+            throw std::logic_error{"crs_graph: pagerank values"};
+    }
+
+    settings.num_threads = 4;
+    const auto s4 = g.pagerank(settings);
+    if(s4.iterations != s1.iterations)
+        throw std::logic_error{"crs_graph: pagerank threads"};
+    for(std::size_t v = 0; v < r1.size(); ++v) {
+        if(std::abs(g.ranks()[v] - r1[v]) > 1e-12)
+            throw std::logic_error{"crs_graph: pagerank parallel values"};
+    }
+
+    settings.max_iterations = 3;
+    const auto s3 = g.pagerank(settings);
+    if(s3.converged || s3.iterations != 3)
+        throw std::logic_error{"crs_graph: pagerank iteration limit"};
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_bfs();
+        test_pagerank();
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
@@ -0,0 +1,383 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "crs_matrix_algorithms.h"
+
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+template<class T>
+crs_matrix<T>
+make_random_matrix(std::size_t rows, std::size_t cols, std::size_t nnz,
+                   unsigned seed = 0)
+{
+    auto urbg = std::mt19937{seed};
+    auto rowDistr = std::uniform_int_distribution<std::size_t>{0, rows-1};
+    auto colDistr = std::uniform_int_distribution<std::size_t>{0, cols-1};
+    auto valDistr = std::uniform_int_distribution<int>{-9, 9};
+
+    auto tri = std::vector<crs_triplet<T>>{};
+    tri.reserve(nnz + 1);
+    for(std::size_t i = 0; i < nnz; ++i) {
+        tri.push_back(crs_triplet<T>{rowDistr(urbg), colDistr(urbg),
+                                     T(valDistr(urbg))});
+    }
+    //make sure the matrix has the requested extents
+    tri.push_back(crs_triplet<T>{rows-1, cols-1, T(1)});
+
+    return crs_matrix<T>::from_triplets(tri.begin(), tri.end());
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+std::vector<T>
+make_vector(std::size_t n, unsigned seed = 1)
+{
+    auto urbg = std::mt19937{seed};
+    auto distr = std::uniform_int_distribution<int>{-5, 5};
+    auto v = std::vector<T>(n);
+    for(auto& x : v) x = T(distr(urbg));
+    return v;
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+bool
+approx_equal(const std::vector<T>& a, const std::vector<T>& b)
+{
+    if(a.size() != b.size()) return false;
+    for(std::size_t i = 0; i < a.size(); ++i) {
+        if(std::abs(double(a[i]) - double(b[i])) > 1e-6) return false;
+    }
+    return true;
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+std::vector<T>
+reference_spmv(const crs_matrix<T>& m, const std::vector<T>& x,
+               const std::vector<T>& y0, T alpha, T beta)
+{
+    auto y = std::vector<T>(m.rows());
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        auto sum = T(0);
+        for(std::size_t c = 0; c < m.cols(); ++c) {
+            sum += m(r,c) * x[c];
+        }
+        y[r] = alpha * sum + beta * y0[r];
+    }
+    return y;
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+void test_spmv()
+{
+    const auto m = make_random_matrix<T>(57, 43, 400);
+    const auto x = make_vector<T>(m.cols());
+    const auto y0 = make_vector<T>(m.rows(), 7);
+
+    for(int threads : {1, 2, 3, 8}) {
+        auto y = std::vector<T>{};
+        spmv(m, x, y, T(1), T(0), threads);
+        if(!approx_equal(y, reference_spmv(m, x, y0, T(1), T(0))))
+            throw std::logic_error{"spmv: y = A*x"};
+
+        y = y0;
+        spmv(m, x, y, T(2), T(3), threads);
+        if(!approx_equal(y, reference_spmv(m, x, y0, T(2), T(3))))
+            throw std::logic_error{"spmv: y = alpha*A*x + beta*y"};
+    }
+
+    //compact index types have to give the same results
+    using compact_t = crs_matrix<T,crs_matrix_static_value<T,0>,
+                                 std::allocator<T>,std::uint32_t,std::uint32_t>;
+    auto tri = std::vector<crs_triplet<T>>{};
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        for(auto i = m.begin_row(r); i != m.end_row(r); ++i) {
+            tri.push_back(crs_triplet<T>{r, m.col_index_of(i), *i});
+        }
+    }
+    const auto mc = compact_t::from_triplets(tri.begin(), tri.end());
+    for(int threads : {1, 4}) {
+        auto y = y0;
+        auto yc = y0;
+        spmv(m, x, y, T(2), T(1), threads);
+        spmv(mc, x, yc, T(2), T(1), threads);
+        if(!approx_equal(y, yc))
+            throw std::logic_error{"spmv: compact index types"};
+
+        const auto c1 = spgemm(m, m, threads);
+        const auto c2 = spgemm(mc, mc, threads);
+        if(c1.size() != c2.size() ||
+           !std::equal(c1.begin_col_indices(), c1.end_col_indices(),
+                       c2.begin_col_indices()))
+        {
+            throw std::logic_error{"spgemm: compact index types"};
+        }
+    }
+
+    //empty rows and empty matrix
+    auto e = crs_matrix<T>{};
+    auto y = std::vector<T>{};
+    spmv(e, x, y);
+    if(!y.empty()) throw std::logic_error{"spmv: empty matrix"};
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+void check_spgemm(const crs_matrix<T>& a, const crs_matrix<T>& b)
+{
+    for(int threads : {1, 2, 5}) {
+        const auto c = spgemm(a, b, threads);
+
+        std::size_t nnz = 0;
+        for(std::size_t r = 0; r < a.rows(); ++r) {
+            for(std::size_t col = 0; col < b.cols(); ++col) {
+                auto sum = T(0);
+                bool touched = false;
+                for(std::size_t k = 0; k < b.rows(); ++k) {
+                    if(a.has(r,k) && b.has(k,col)) {
+                        sum += a(r,k) * b(k,col);
+                        touched = true;
+                    }
+                }
+                if(touched) ++nnz;
+                if(touched != c.has(r,col))
+                    throw std::logic_error{"spgemm: sparsity pattern"};
+                if(std::abs(double(c(r,col)) - double(sum)) > 1e-6)
+                    throw std::logic_error{"spgemm: values"};
+            }
+        }
+        if(c.size() != nnz)
+            throw std::logic_error{"spgemm: number of non-zeros"};
+
+        //column indices have to be sorted within rows
+        for(std::size_t r = 0; r < c.rows(); ++r) {
+            if(!std::is_sorted(c.begin_col_indices(r), c.end_col_indices(r)))
+                throw std::logic_error{"spgemm: column order"};
+        }
+    }
+}
+
+//-------------------------------------------------------------------
+template<class T>
+void test_spgemm()
+{
+    //dense accumulator path
+    check_spgemm(make_random_matrix<T>(31, 27, 150, 3),
+                 make_random_matrix<T>(27, 35, 170, 4));
+
+    //hash accumulator path (very wide B)
+    check_spgemm(make_random_matrix<T>(13, 11, 30, 5),
+                 make_random_matrix<T>(11, 2000, 40, 6));
+
+    //inner dimension mismatch: missing rows of B count as empty
+    check_spgemm(make_random_matrix<T>(9, 20, 40, 7),
+                 make_random_matrix<T>(12, 9, 30, 8));
+
+    if(!spgemm(crs_matrix<T>{}, make_random_matrix<T>(3,3,3)).empty())
+        throw std::logic_error{"spgemm: empty operand"};
+}
+
+
+
+//-------------------------------------------------------------------
+void test_spgemm_limits()
+{
+    using tiny_t = crs_matrix<int,crs_matrix_static_value<int,0>,
+                              std::allocator<int>,std::uint8_t,std::uint8_t>;
+
+    //largest representable column index must not be mistaken
+    //for an empty hash slot (wide B => hash accumulator)
+    auto a = tiny_t{};
+    a.insert(0, 0, 1);
+    a.insert(0, 1, 1);
+    auto b = tiny_t{};
+    b.insert(0, 255, 2);
+    b.insert(1, 255, 3);
+    b.insert(1, 7, 1);
+    for(int threads : {1, 2}) {
+        const auto c = spgemm(a, b, threads);
+        if(c.size() != 2 || c.row_size(0) != 2 || c(0,255) != 5 || c(0,7) != 1)
+            throw std::logic_error{"spgemm: maximum column index"};
+    }
+
+    //20 x 20 = 400 results don't fit 8 bit row offsets
+    auto col = tiny_t{};
+    auto row = tiny_t{};
+    for(std::size_t i = 0; i < 20; ++i) {
+        col.insert(i, 0, 1);
+        row.insert(0, i, 1);
+    }
+    bool thrown = false;
+    try { spgemm(col, row); } catch(std::length_error&) { thrown = true; }
+    if(!thrown) throw std::logic_error{"spgemm: row offset overflow"};
+
+    //empty left operand keeps the result shape
+    auto e = crs_matrix<int>{};
+    e.rows(4);
+    e.cols(3);
+    const auto z = spgemm(e, make_random_matrix<int>(3, 6, 10));
+    if(!z.empty() || z.rows() != 4 || z.cols() != 6)
+        throw std::logic_error{"spgemm: shape of empty product"};
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+void test_transpose()
+{
+    const auto m = make_random_matrix<T>(23, 41, 200, 9);
+    const auto t = transpose(m);
+
+    if(t.rows() != m.cols() || t.cols() != m.rows() || t.size() != m.size())
+        throw std::logic_error{"transpose: sizes"};
+
+    for(std::size_t r = 0; r < t.rows(); ++r) {
+        for(auto it = t.begin_row(r); it != t.end_row(r); ++it) {
+            const auto c = t.col_index_of(it);
+            if(it != t.begin_row(r) && c <= t.col_index_of(it - 1))
+                throw std::logic_error{"transpose: column order"};
+            if(!m.has(c, r) || m(c, r) != *it)
+                throw std::logic_error{"transpose: values"};
+        }
+    }
+
+    if(!transpose(crs_matrix<T>{}).empty())
+        throw std::logic_error{"transpose: empty"};
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T, class Op>
+void check_merge(const crs_matrix<T>& a, const crs_matrix<T>& b,
+                 const crs_matrix<T>& c, Op op, bool intersect)
+{
+    if(c.rows() != std::max(a.rows(), b.rows()) ||
+       c.cols() != std::max(a.cols(), b.cols()))
+    {
+        throw std::logic_error{"merge: shape"};
+    }
+
+    std::size_t nnz = 0;
+    for(std::size_t r = 0; r < c.rows(); ++r) {
+        for(std::size_t col = 0; col < c.cols(); ++col) {
+            const bool ina = a.has(r, col);
+            const bool inb = b.has(r, col);
+            const bool expected = intersect ? (ina && inb) : (ina || inb);
+            if(c.has(r, col) != expected)
+                throw std::logic_error{"merge: pattern"};
+            if(expected) {
+                ++nnz;
+                if(c(r, col) != op(a(r, col), b(r, col)))
+                    throw std::logic_error{"merge: values"};
+            }
+        }
+        if(!std::is_sorted(c.begin_col_indices(r), c.end_col_indices(r)))
+            throw std::logic_error{"merge: column order"};
+    }
+    if(c.size() != nnz) throw std::logic_error{"merge: size"};
+}
+
+
+//-------------------------------------------------------------------
+template<class T>
+void test_elementwise()
+{
+    const auto a = make_random_matrix<T>(37, 29, 300, 11);
+    const auto b = make_random_matrix<T>(37, 29, 250, 12);
+    //different shape
+    const auto s = make_random_matrix<T>(20, 41, 120, 13);
+
+    const auto add = [](const T& x, const T& y) { return T(x + y); };
+    const auto sub = [](const T& x, const T& y) { return T(x - y); };
+    const auto mul = [](const T& x, const T& y) { return T(x * y); };
+    const auto mx  = [](const T& x, const T& y) { return std::max(x, y); };
+
+    for(int numThreads : {1, 3}) {
+        check_merge(a, b, elementwise_add(a, b, numThreads), add, false);
+        check_merge(a, s, elementwise_add(a, s, numThreads), add, false);
+        check_merge(a, b, elementwise_subtract(a, b, numThreads), sub, false);
+        check_merge(s, b, elementwise_subtract(s, b, numThreads), sub, false);
+        check_merge(a, b, elementwise_multiply(a, b, numThreads), mul, true);
+        check_merge(a, s, elementwise_multiply(a, s, numThreads), mul, true);
+        check_merge(a, b, merge(a, b, mx, numThreads), mx, false);
+    }
+
+    const auto e = crs_matrix<T>{};
+    check_merge(a, e, elementwise_add(a, e), add, false);
+    check_merge(e, b, elementwise_multiply(e, b), mul, true);
+    if(!elementwise_add(e, e).empty())
+        throw std::logic_error{"merge: empty"};
+}
+
+
+
+//-------------------------------------------------------------------
+void test_partition_large_offsets()
+{
+    //4G elements in 32 bit offsets: total * part must not overflow
+    const auto prefix = std::vector<std::uint32_t>{
+        0, 1000000000u, 2000000000u, 3000000000u, 4000000000u};
+    const auto bounds = weighted_partition(prefix.data(), std::size_t(4), 4);
+    if(bounds != std::vector<std::size_t>{0, 1, 2, 3, 4})
+        throw std::logic_error{"weighted_partition: large 32 bit offsets"};
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_partition_large_offsets();
+
+        test_spmv<int>();
+        test_spmv<float>();
+        test_spmv<double>();
+
+        test_spgemm<int>();
+        test_spgemm<double>();
+        test_spgemm_limits();
+
+        test_transpose<int>();
+        test_transpose<double>();
+
+        test_elementwise<int>();
+        test_elementwise<double>();
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
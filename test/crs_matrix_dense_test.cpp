@@ -0,0 +1,283 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "crs_matrix_dense.h"
+
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+Matrix make_random_sparse(std::size_t rows, std::size_t cols,
+                          std::size_t nnz, unsigned seed)
+{
+    using value_t = typename Matrix::value_type;
+
+    auto urg = std::mt19937{seed};
+    auto rowDistr = std::uniform_int_distribution<std::size_t>{0, rows-1};
+    auto colDistr = std::uniform_int_distribution<std::size_t>{0, cols-1};
+    auto valDistr = std::uniform_int_distribution<int>{-9, 9};
+
+    auto tri = std::vector<crs_triplet<value_t>>{};
+    for(std::size_t i = 0; i < nnz; ++i) {
+        tri.push_back({rowDistr(urg), colDistr(urg), value_t(valDistr(urg))});
+    }
+    auto m = Matrix::from_triplets(tri.begin(), tri.end());
+    m.rows(rows);
+    m.cols(cols);
+    return m;
+}
+
+
+//-------------------------------------------------------------------
+template<class T>
+dynamic_matrix<T> make_random_dense(std::size_t rows, std::size_t cols,
+                                    unsigned seed)
+{
+    auto urg = std::mt19937{seed};
+    auto valDistr = std::uniform_int_distribution<int>{-5, 5};
+
+    auto m = dynamic_matrix<T>{};
+    m.resize(rows, cols, T(0));
+    for(std::size_t r = 0; r < rows; ++r) {
+        for(std::size_t c = 0; c < cols; ++c) {
+            m(r,c) = T(valDistr(urg));
+        }
+    }
+    return m;
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+bool equal(const dynamic_matrix<T>& a, const dynamic_matrix<T>& b)
+{
+    if(a.rows() != b.rows() || a.cols() != b.cols()) return false;
+    for(std::size_t r = 0; r < a.rows(); ++r) {
+        for(std::size_t c = 0; c < a.cols(); ++c) {
+            if(a(r,c) != b(r,c)) return false;
+        }
+    }
+    return true;
+}
+
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+void test_spmm(std::size_t k)
+{
+    using value_t = typename Matrix::value_type;
+
+    const auto a = make_random_sparse<Matrix>(57, 43, 300, 11);
+    const auto b = make_random_dense<value_t>(43, k, 12);
+
+    //reference: naive triple loop
+    auto ref = dynamic_matrix<value_t>{};
+    ref.resize(a.rows(), k, value_t(0));
+    for(std::size_t r = 0; r < a.rows(); ++r) {
+        for(std::size_t c = 0; c < a.cols(); ++c) {
+            if(!a.has(r,c)) continue;
+            for(std::size_t j = 0; j < k; ++j) {
+                ref(r,j) += a(r,c) * b(c,j);
+            }
+        }
+    }
+
+    for(int nt : {1, 2, 3, 8}) {
+        const auto c = spmm(a, b, nt);
+        if(c.rows() != a.rows() || c.cols() != k)
+            throw std::logic_error{"crs_matrix_dense: spmm shape"};
+        if(!equal(c, ref))
+            throw std::logic_error{"crs_matrix_dense: spmm values"};
+
+        //C = 2*A*B - C  (with C = A*B  =>  C = A*B)
+        auto c2 = c;
+        spmm(a, b, c2, value_t(2), value_t(-1), nt);
+        if(!equal(c2, ref))
+            throw std::logic_error{"crs_matrix_dense: spmm alpha/beta"};
+    }
+}
+
+
+//-------------------------------------------------------------------
+void test_spmm_edge_cases()
+{
+    //empty sparse rows and wrongly shaped output
+    auto a = crs_matrix<double>{};
+    a.rows(4);
+    a.cols(3);
+    a.insert(2, 1, 2.0);
+
+    const auto b = make_random_dense<double>(3, 5, 1);
+
+    auto c = dynamic_matrix<double>{};
+    c.resize(2, 2, 7.0);
+    spmm(a, b, c, 1.0, 1.0, 2);
+
+    if(c.rows() != 4 || c.cols() != 5)
+        throw std::logic_error{"crs_matrix_dense: spmm resize"};
+
+    for(std::size_t r = 0; r < 4; ++r) {
+        for(std::size_t j = 0; j < 5; ++j) {
+            const auto expected = (r == 2) ? 2.0 * b(1,j) : 0.0;
+            if(std::abs(c(r,j) - expected) > 1e-12)
+                throw std::logic_error{"crs_matrix_dense: spmm edge values"};
+        }
+    }
+
+    //single column dense operand
+    const auto b1 = make_random_dense<double>(3, 1, 2);
+    const auto c1 = spmm(a, b1);
+    if(c1.rows() != 4 || c1.cols() != 1 || c1(2,0) != 2.0 * b1(1,0))
+        throw std::logic_error{"crs_matrix_dense: spmm single column"};
+}
+
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+void test_conversion(int numThreads)
+{
+    using value_t = typename Matrix::value_type;
+
+    const auto a = make_random_sparse<Matrix>(61, 37, 400, 5);
+
+    //sparse -> dense
+    const auto d = crs_to_dense(a, numThreads);
+    if(d.rows() != a.rows() || d.cols() != a.cols())
+        throw std::logic_error{"crs_matrix_dense: crs_to_dense shape"};
+    for(std::size_t r = 0; r < a.rows(); ++r) {
+        for(std::size_t c = 0; c < a.cols(); ++c) {
+            if(d(r,c) != a(r,c))
+                throw std::logic_error{"crs_matrix_dense: crs_to_dense values"};
+        }
+    }
+
+    //dense -> sparse (stored zeros of 'a' are dropped)
+    const auto b = dense_to_crs<Matrix>(d,
+        [](std::size_t, std::size_t, const value_t& x) { return x != value_t(0); },
+        numThreads);
+    if(b.rows() != a.rows() || b.cols() != a.cols())
+        throw std::logic_error{"crs_matrix_dense: dense_to_crs shape"};
+
+    std::size_t nonzeros = 0;
+    for(std::size_t r = 0; r < a.rows(); ++r) {
+        for(auto it = a.begin_row(r); it != a.end_row(r); ++it) {
+            if(*it != value_t(0)) ++nonzeros;
+        }
+        for(auto it = b.begin_row(r); it != b.end_row(r); ++it) {
+            if(*it == value_t(0) || a(r, b.col_index_of(it)) != *it)
+                throw std::logic_error{"crs_matrix_dense: dense_to_crs values"};
+        }
+    }
+    if(b.size() != nonzeros)
+        throw std::logic_error{"crs_matrix_dense: dense_to_crs size"};
+
+    //output of wrong shape is resized
+    auto d2 = dynamic_matrix<value_t>{};
+    d2.resize(3, 3, value_t(1));
+    crs_to_dense(b, d2, numThreads);
+    for(std::size_t r = 0; r < a.rows(); ++r) {
+        for(std::size_t c = 0; c < a.cols(); ++c) {
+            if(d2(r,c) != d(r,c))
+                throw std::logic_error{"crs_matrix_dense: crs_to_dense resize"};
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------
+void test_threshold_conversion()
+{
+    auto d = dynamic_matrix<double>{};
+    d.resize(3, 4, 0.0);
+    d(0,1) = 0.5;
+    d(1,0) = -2.0;
+    d(1,3) = 0.01;
+    d(2,2) = 3.0;
+
+    const auto all = dense_to_crs(d);
+    if(all.size() != 4 || all(1,3) != 0.01 || all.cols() != 4)
+        throw std::logic_error{"crs_matrix_dense: dense_to_crs default"};
+
+    const auto big = dense_to_crs(d, 0.4, 2);
+    if(big.size() != 3 || big.has(1,3) || big(1,0) != -2.0 || big(0,1) != 0.5)
+        throw std::logic_error{"crs_matrix_dense: dense_to_crs threshold"};
+
+    //empty
+    const auto e = dense_to_crs(dynamic_matrix<double>{});
+    if(!e.empty() || e.rows() != 0 || !crs_to_dense(e).empty())
+        throw std::logic_error{"crs_matrix_dense: empty conversion"};
+}
+
+
+
+//-------------------------------------------------------------------
+void test_conversion_limits()
+{
+    using tiny_t = crs_matrix<int,crs_matrix_static_value<int,0>,
+                              std::allocator<int>,std::uint8_t,std::uint8_t>;
+    using narrow_t = crs_matrix<int,crs_matrix_static_value<int,0>,
+                                std::allocator<int>,std::uint8_t,std::uint32_t>;
+    const auto keep_all = [](std::size_t, std::size_t, int) { return true; };
+
+    auto wide = dynamic_matrix<int>{};
+    wide.resize(2, 300, 1);
+    bool thrown = false;
+    try { dense_to_crs<narrow_t>(wide, keep_all); }
+    catch(std::out_of_range&) { thrown = true; }
+    if(!thrown) throw std::logic_error{"crs_matrix_dense: column index range"};
+
+    auto tall = dynamic_matrix<int>{};
+    tall.resize(20, 20, 1);
+    thrown = false;
+    try { dense_to_crs<tiny_t>(tall, keep_all, 2); }
+    catch(std::length_error&) { thrown = true; }
+    if(!thrown) throw std::logic_error{"crs_matrix_dense: element count range"};
+
+    const auto diag = dense_to_crs<tiny_t>(tall,
+        [](std::size_t r, std::size_t c, int) { return r == c; });
+    if(diag.size() != 20 || diag(19,19) != 1 || diag.cols() != 20)
+        throw std::logic_error{"crs_matrix_dense: compact index types"};
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_spmm<crs_matrix<double>>(1);
+        test_spmm<crs_matrix<double>>(16);
+        test_spmm<crs_matrix<int>>(7);
+        test_spmm<crs_matrix<float,crs_matrix_static_value<float,0>,
+            std::allocator<float>,std::uint32_t,std::uint32_t>>(33);
+        test_spmm_edge_cases();
+        test_conversion<crs_matrix<double>>(1);
+        test_conversion<crs_matrix<int>>(3);
+        test_conversion<crs_matrix<float,crs_matrix_static_value<float,0>,
+            std::allocator<float>,std::uint32_t,std::uint32_t>>(0);
+        test_threshold_conversion();
+        test_conversion_limits();
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
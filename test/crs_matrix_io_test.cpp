@@ -0,0 +1,436 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "crs_matrix_io.h"
+
+#include <sstream>
+#include <cstdio>
+#include <clocale>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+#include <vector>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+Matrix make_matrix(std::size_t rows, std::size_t cols, std::size_t nnz)
+{
+    using value_t = typename Matrix::value_type;
+
+    auto urbg = std::mt19937{};
+    auto rowDistr = std::uniform_int_distribution<std::size_t>{0,rows-1};
+    auto colDistr = std::uniform_int_distribution<std::size_t>{0,cols-1};
+    auto valDistr = std::uniform_int_distribution<int>{1,100};
+
+    auto triplets = std::vector<crs_triplet<value_t>>{};
+    for(std::size_t i = 0; i < nnz; ++i) {
+        triplets.push_back({rowDistr(urbg), colDistr(urbg),
+                            value_t(valDistr(urbg))});
+    }
+    auto m = Matrix::from_triplets(triplets.begin(), triplets.end());
+    //trailing empty rows and columns must survive a round trip
+    m.rows(rows + 3);
+    m.cols(cols + 5);
+    return m;
+}
+
+
+
+//-------------------------------------------------------------------
+template<class M1, class M2>
+void check_equal(const M1& a, const M2& b, const char* msg)
+{
+    if(a.rows() != b.rows() || a.cols() != b.cols() || a.size() != b.size())
+        throw std::logic_error{msg};
+
+    for(std::size_t r = 0; r < a.rows(); ++r) {
+        if(a.row_size(r) != b.row_size(r)) throw std::logic_error{msg};
+        for(std::size_t c = 0; c < a.cols(); ++c) {
+            if(a.has(r,c) != b.has(r,c) || a(r,c) != b(r,c))
+                throw std::logic_error{msg};
+        }
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T, class CI, class RO>
+void test_stream_round_trip()
+{
+    using matrix_t = crs_matrix<T,crs_matrix_static_value<T,0>,
+                                std::allocator<T>,CI,RO>;
+
+    const auto m = make_matrix<matrix_t>(50, 40, 300);
+
+    std::stringstream ss;
+    write_binary(ss, m);
+
+    const auto r = read_binary<matrix_t>(ss);
+    check_equal(m, r, "crs_matrix_io: stream round trip");
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T, class CI, class RO>
+void test_mapped()
+{
+    using matrix_t = crs_matrix<T,crs_matrix_static_value<T,0>,
+                                std::allocator<T>,CI,RO>;
+    using mapped_t = mapped_crs_matrix<T,crs_matrix_static_value<T,0>,CI,RO>;
+
+    const auto filename = std::string{"crs_matrix_io_test.bin"};
+
+    const auto m = make_matrix<matrix_t>(60, 70, 500);
+    write_binary(filename, m);
+
+    {
+        const auto v = mapped_t{filename};
+        check_equal(m, v, "crs_matrix_io: mapped view");
+
+        for(std::size_t r = 0; r < m.rows(); ++r) {
+            auto mi = m.begin_col_indices(r);
+            for(auto c = v.begin_col_indices(r); c != v.end_col_indices(r); ++c, ++mi) {
+                if(*c != *mi)
+                    throw std::logic_error{"crs_matrix_io: mapped col indices"};
+            }
+            auto mv = m.begin_row(r);
+            for(const auto& x : v.row(r)) {
+                if(x != *mv++)
+                    throw std::logic_error{"crs_matrix_io: mapped row"};
+            }
+        }
+        for(std::size_t i = 0; i < m.size(); ++i) {
+            if(v.data()[i] != m.data()[i])
+                throw std::logic_error{"crs_matrix_io: mapped data"};
+        }
+
+        //moved-from view must be safe to destroy
+        auto w = mapped_t{filename};
+        auto w2 = std::move(w);
+        if(w2.size() != m.size())
+            throw std::logic_error{"crs_matrix_io: mapped move"};
+
+        //type mismatch must be detected
+        bool thrown = false;
+        try {
+            mapped_crs_matrix<char,crs_matrix_static_value<char,0>,CI,RO>{filename};
+        }
+        catch(crs_matrix_io_error&) {
+            thrown = true;
+        }
+        if(!thrown) throw std::logic_error{"crs_matrix_io: type check"};
+    }
+
+    std::remove(filename.c_str());
+}
+
+
+
+//-------------------------------------------------------------------
+void test_invalid_input()
+{
+    std::stringstream ss;
+    ss << "this is not a matrix file, but long enough to hold a header ...";
+
+    bool thrown = false;
+    try {
+        read_binary<crs_matrix<double>>(ss);
+    }
+    catch(crs_matrix_io_error&) {
+        thrown = true;
+    }
+    if(!thrown) throw std::logic_error{"crs_matrix_io: header check"};
+}
+
+
+
+//-------------------------------------------------------------------
+void test_corrupt_binary()
+{
+    using matrix_t = crs_matrix<double>;
+    using mapped_t = mapped_crs_matrix<double>;
+    using header_t = crs_detail::crs_binary_header;
+
+    const auto m = make_matrix<matrix_t>(20, 20, 50);
+    std::stringstream ss;
+    write_binary(ss, m);
+    const auto good = ss.str();
+
+    header_t h;
+    std::memcpy(&h, good.data(), sizeof(h));
+
+    const auto patch_header = [&](std::uint64_t rows, std::uint64_t nnz) {
+        auto h2 = h;
+        h2.rows = rows;
+        h2.nnz = nnz;
+        auto s = good;
+        std::memcpy(&s[0], &h2, sizeof(h2));
+        return s;
+    };
+    const auto patch_offset = [&](std::size_t i, std::size_t value) {
+        auto s = good;
+        std::memcpy(&s[h.row_offset_offset() + i * sizeof(std::size_t)],
+                    &value, sizeof(value));
+        return s;
+    };
+    const auto patch_col_index = [&](std::size_t i, std::size_t value) {
+        auto s = good;
+        std::memcpy(&s[h.col_index_offset() + i * sizeof(std::size_t)],
+                    &value, sizeof(value));
+        return s;
+    };
+
+    const auto filename = std::string{"crs_matrix_io_test_corrupt.bin"};
+    const auto mapping_throws = [&](const std::string& s, bool validate) {
+        {
+            std::ofstream os{filename, std::ios::out | std::ios::binary};
+            os.write(s.data(), std::streamsize(s.size()));
+        }
+        try { mapped_t{filename, validate}; }
+        catch(crs_matrix_io_error&) { return true; }
+        return false;
+    };
+
+    const auto corrupt = std::vector<std::string>{
+        //huge counts must not end up as huge allocations
+        patch_header(h.rows, std::uint64_t(1) << 60),
+        patch_header(h.rows, std::uint64_t(1) << 40),
+        patch_header(std::uint64_t(1) << 40, h.nnz),
+        patch_header(~std::uint64_t(0), ~std::uint64_t(0)),
+        //broken row offsets
+        patch_offset(0, 1),
+        patch_offset(h.rows, h.nnz - 1),
+        //truncated
+        good.substr(0, good.size() - 1)
+    };
+
+    for(const auto& s : corrupt) {
+        std::stringstream is{s};
+        bool thrown = false;
+        try { read_binary<matrix_t>(is); }
+        catch(crs_matrix_io_error&) { thrown = true; }
+        if(!thrown) throw std::logic_error{"crs_matrix_io: corrupt stream"};
+
+        if(!mapping_throws(s, false) || !mapping_throws(s, true))
+            throw std::logic_error{"crs_matrix_io: corrupt file"};
+    }
+
+    //only detected by a full validation of mapped files
+    const auto offset = patch_offset(5, 0);
+    {
+        std::stringstream is{offset};
+        bool thrown = false;
+        try { read_binary<matrix_t>(is); }
+        catch(crs_matrix_io_error&) { thrown = true; }
+        if(!thrown) throw std::logic_error{"crs_matrix_io: corrupt stream"};
+    }
+    for(const auto& s : {offset, patch_col_index(0, h.cols)}) {
+        if(mapping_throws(s, false))
+            throw std::logic_error{"crs_matrix_io: mapping validates fully"};
+        if(!mapping_throws(s, true))
+            throw std::logic_error{"crs_matrix_io: full validation"};
+    }
+    if(mapping_throws(good, true))
+        throw std::logic_error{"crs_matrix_io: full validation of valid file"};
+
+    std::remove(filename.c_str());
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+void test_matrix_market_round_trip(int numThreads, std::size_t chunkSize)
+{
+    using matrix_t = crs_matrix<T>;
+
+    const auto m = make_matrix<matrix_t>(80, 90, 700);
+
+    std::stringstream ss;
+    write_matrix_market(ss, m);
+
+    const auto r = read_matrix_market<matrix_t>(ss, numThreads,
+                                                crs_keep_last{}, chunkSize);
+    check_equal(m, r, "crs_matrix_io: matrix market round trip");
+}
+
+
+
+//-------------------------------------------------------------------
+void test_matrix_market_variants()
+{
+    {
+        std::stringstream ss;
+        ss << "%%MatrixMarket matrix coordinate real symmetric\n"
+              "% comment\n"
+              "%\n"
+              "4 4 4\n"
+              "1 1 1.5\n"
+              "3 1 -2e1\n"
+              "\n"
+              "4 2\t7\n"
+              "4 4 .25";
+        const auto m = read_matrix_market<crs_matrix<double>>(ss, 2, crs_keep_last{}, 64);
+        if(m.size() != 6 || m.rows() != 4 || m.cols() != 4 ||
+           m(0,0) != 1.5 || m(2,0) != -20 || m(0,2) != -20 ||
+           m(3,1) != 7 || m(1,3) != 7 || m(3,3) != 0.25)
+        {
+            throw std::logic_error{"crs_matrix_io: matrix market symmetric"};
+        }
+    }
+    {
+        std::stringstream ss;
+        ss << "%%MatrixMarket matrix coordinate pattern general\n"
+              "5 6 3\n"
+              "1 2\n"
+              "5 6\n"
+              "2 2\n";
+        const auto m = read_matrix_market<crs_matrix<int>>(ss);
+        if(m.size() != 3 || m.rows() != 5 || m.cols() != 6 ||
+           m(0,1) != 1 || m(4,5) != 1 || m(1,1) != 1)
+        {
+            throw std::logic_error{"crs_matrix_io: matrix market pattern"};
+        }
+    }
+    {
+        std::stringstream ss;
+        ss << "%%MatrixMarket matrix coordinate integer skew-symmetric\n"
+              "3 3 1\n"
+              "3 1 4\n";
+        const auto m = read_matrix_market<crs_matrix<int>>(ss);
+        if(m.size() != 2 || m(2,0) != 4 || m(0,2) != -4)
+            throw std::logic_error{"crs_matrix_io: matrix market skew"};
+    }
+    {
+        std::stringstream ss;
+        ss << "%%MatrixMarket matrix coordinate real general\n"
+              "3 3 2\n"
+              "1 1 1.0\n"
+              "4 1 1.0\n";
+        bool thrown = false;
+        try {
+            read_matrix_market<crs_matrix<double>>(ss);
+        }
+        catch(crs_matrix_io_error&) {
+            thrown = true;
+        }
+        if(!thrown) throw std::logic_error{"crs_matrix_io: matrix market bounds"};
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+void test_matrix_market_errors()
+{
+    const auto invalid = std::vector<std::string>{
+        //fewer / more entries than declared
+        "%%MatrixMarket matrix coordinate real general\n"
+        "3 3 3\n1 1 1.0\n2 2 2.0\n",
+        "%%MatrixMarket matrix coordinate real general\n"
+        "3 3 1\n1 1 1.0\n2 2 2.0\n",
+        //index overflow
+        "%%MatrixMarket matrix coordinate real general\n"
+        "3 3 1\n18446744073709551618 1 1.0\n",
+        "%%MatrixMarket matrix coordinate real general\n"
+        "3 99999999999999999999 1\n1 1 1.0\n",
+        //value not representable
+        "%%MatrixMarket matrix coordinate integer general\n"
+        "3 3 1\n1 1 4294967296\n",
+        "%%MatrixMarket matrix coordinate real general\n"
+        "3 3 1\n1 1 1e999\n"
+    };
+    for(const auto& s : invalid) {
+        std::stringstream ss{s};
+        bool thrown = false;
+        try { read_matrix_market<crs_matrix<int>>(ss); }
+        catch(crs_matrix_io_error&) { thrown = true; }
+        if(!thrown && s.find(" integer ") == std::string::npos) {
+            std::stringstream ss2{s};
+            try { read_matrix_market<crs_matrix<double>>(ss2); }
+            catch(crs_matrix_io_error&) { thrown = true; }
+        }
+        if(!thrown) throw std::logic_error{"crs_matrix_io: matrix market errors"};
+    }
+
+    std::stringstream ss;
+    ss << "%%MatrixMarket matrix coordinate integer general\n"
+          "2 2 2\n1 1 -2147483648\n2 2 +2147483647\n";
+    const auto m = read_matrix_market<crs_matrix<int>>(ss);
+    if(m(0,0) != std::numeric_limits<int>::min() ||
+       m(1,1) != std::numeric_limits<int>::max())
+    {
+        throw std::logic_error{"crs_matrix_io: matrix market integer limits"};
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+void test_matrix_market_locale()
+{
+    //decimal comma locale (skipped if none is installed)
+    const char* names[] = {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8"};
+    const char* found = nullptr;
+    for(auto name : names) {
+        if(std::setlocale(LC_ALL, name)) { found = name; break; }
+    }
+    if(!found) return;
+
+    auto m = crs_matrix<double>{};
+    m.insert(0, 1, 1.5);
+    m.insert(2, 0, -0.125);
+
+    std::stringstream ss;
+    write_matrix_market(ss, m);
+    const auto text = ss.str();
+    const auto r = read_matrix_market<crs_matrix<double>>(ss);
+    std::setlocale(LC_ALL, "C");
+
+    if(text.find(',') != std::string::npos)
+        throw std::logic_error{"crs_matrix_io: matrix market locale write"};
+    check_equal(m, r, "crs_matrix_io: matrix market locale read");
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_stream_round_trip<int,std::size_t,std::size_t>();
+        test_stream_round_trip<double,std::uint32_t,std::uint64_t>();
+        test_stream_round_trip<float,std::uint16_t,std::uint32_t>();
+        test_mapped<double,std::size_t,std::size_t>();
+        test_mapped<int,std::uint32_t,std::uint32_t>();
+        test_invalid_input();
+        test_corrupt_binary();
+        test_matrix_market_round_trip<double>(1, std::size_t(1) << 22);
+        test_matrix_market_round_trip<double>(3, 256);
+        test_matrix_market_round_trip<int>(4, 100);
+        test_matrix_market_variants();
+        test_matrix_market_errors();
+        test_matrix_market_locale();
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
@@ -0,0 +1,163 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "crs_matrix_reordering.h"
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+/// @brief 2D grid Laplacian pattern with randomly shuffled numbering
+crs_matrix<double> make_shuffled_grid(std::size_t w, std::size_t h,
+                                      std::vector<std::size_t>& shuffle)
+{
+    const auto n = w * h;
+    shuffle.resize(n);
+    std::iota(shuffle.begin(), shuffle.end(), std::size_t(0));
+    std::shuffle(shuffle.begin(), shuffle.end(), std::mt19937{});
+
+    auto tri = std::vector<crs_triplet<double>>{};
+    for(std::size_t y = 0; y < h; ++y) {
+        for(std::size_t x = 0; x < w; ++x) {
+            const auto v = shuffle[y*w + x];
+            tri.push_back({v, v, 4.0});
+            if(x > 0)   tri.push_back({v, shuffle[y*w + x-1], -1.0});
+            if(x+1 < w) tri.push_back({v, shuffle[y*w + x+1], -1.0});
+            if(y > 0)   tri.push_back({v, shuffle[(y-1)*w + x], -2.0});
+            if(y+1 < h) tri.push_back({v, shuffle[(y+1)*w + x], -2.0});
+        }
+    }
+    return crs_matrix<double>::from_triplets(tri.begin(), tri.end());
+}
+
+
+
+//-------------------------------------------------------------------
+void test_band_info()
+{
+    auto m = crs_matrix<int>{};
+    m.insert(0, 0, 1);
+    m.insert(0, 3, 1);
+    m.insert(2, 1, 1);
+    m.insert(3, 0, 1);
+    m.insert(3, 3, 1);
+
+    const auto info = band_info(m);
+    if(info.bandwidth != 3 || info.profile != 1 + 3)
+        throw std::logic_error{"crs_matrix_reordering: band_info"};
+}
+
+
+
+//-------------------------------------------------------------------
+void test_permute()
+{
+    std::vector<std::size_t> shuffle;
+    const auto m = make_shuffled_grid(7, 5, shuffle);
+
+    auto rowPerm = std::vector<std::size_t>(m.rows());
+    auto colPerm = std::vector<std::size_t>(m.cols());
+    std::iota(rowPerm.begin(), rowPerm.end(), std::size_t(0));
+    std::iota(colPerm.begin(), colPerm.end(), std::size_t(0));
+    std::shuffle(rowPerm.begin(), rowPerm.end(), std::mt19937{1});
+    std::shuffle(colPerm.begin(), colPerm.end(), std::mt19937{2});
+
+    auto p = m;
+    p.permute(rowPerm, colPerm);
+
+    if(p.size() != m.size() || p.rows() != m.rows() || p.cols() != m.cols())
+        throw std::logic_error{"crs_matrix_reordering: permute sizes"};
+
+    for(std::size_t i = 0; i < p.rows(); ++i) {
+        for(std::size_t j = 0; j < p.cols(); ++j) {
+            if(p(i,j) != m(rowPerm[i], colPerm[j]) ||
+               p.has(i,j) != m.has(rowPerm[i], colPerm[j]))
+            {
+                throw std::logic_error{"crs_matrix_reordering: permute"};
+            }
+        }
+    }
+
+    auto q = m;
+    q.permute_rows(rowPerm);
+    for(std::size_t i = 0; i < q.rows(); ++i) {
+        for(std::size_t j = 0; j < q.cols(); ++j) {
+            if(q(i,j) != m(rowPerm[i], j))
+                throw std::logic_error{"crs_matrix_reordering: permute_rows"};
+        }
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+void test_rcm()
+{
+    constexpr std::size_t w = 30;
+    constexpr std::size_t h = 20;
+
+    std::vector<std::size_t> shuffle;
+    auto m = make_shuffled_grid(w, h, shuffle);
+    //second, disconnected component
+    m.insert(w*h + 1, w*h + 2, 1.0);
+    m.insert(w*h + 2, w*h + 1, 1.0);
+    const auto orig = m;
+
+    const auto perm = reverse_cuthill_mckee(m);
+    auto sorted = perm;
+    std::sort(sorted.begin(), sorted.end());
+    for(std::size_t i = 0; i < sorted.size(); ++i) {
+        if(sorted[i] != i)
+            throw std::logic_error{"crs_matrix_reordering: rcm permutation"};
+    }
+
+    const auto res = reorder_rcm(m);
+
+    //grid bandwidth after RCM is bounded by the grid's shorter side (+1)
+    if(res.after.bandwidth > h + 1 ||
+       res.after.bandwidth >= res.before.bandwidth ||
+       res.after.profile >= res.before.profile)
+    {
+        throw std::logic_error{"crs_matrix_reordering: rcm bandwidth"};
+    }
+    if(band_info(m).bandwidth != res.after.bandwidth)
+        throw std::logic_error{"crs_matrix_reordering: rcm report"};
+
+    for(std::size_t i = 0; i < m.rows(); ++i) {
+        for(auto it = m.begin_row(i); it != m.end_row(i); ++it) {
+            const auto j = m.col_index_of(it);
+            if(*it != orig(res.row_permutation[i], res.col_permutation[j]))
+                throw std::logic_error{"crs_matrix_reordering: rcm values"};
+        }
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_band_info();
+        test_permute();
+        test_rcm();
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
@@ -0,0 +1,185 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "crs_matrix_slicing.h"
+
+#include <vector>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <list>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+Matrix
+make_random_matrix(std::size_t rows, std::size_t cols, std::size_t nnz,
+                   unsigned seed = 0)
+{
+    using value_t = typename Matrix::value_type;
+
+    auto urbg = std::mt19937{seed};
+    auto rowDistr = std::uniform_int_distribution<std::size_t>{0, rows-1};
+    auto colDistr = std::uniform_int_distribution<std::size_t>{0, cols-1};
+    auto valDistr = std::uniform_int_distribution<int>{1, 9};
+
+    auto tri = std::vector<crs_triplet<value_t>>{};
+    for(std::size_t i = 0; i < nnz; ++i) {
+        tri.push_back(crs_triplet<value_t>{rowDistr(urbg), colDistr(urbg),
+                                           value_t(valDistr(urbg))});
+    }
+    tri.push_back(crs_triplet<value_t>{rows-1, cols-1, value_t(1)});
+
+    return Matrix::from_triplets(tri.begin(), tri.end());
+}
+
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+void test_row_slice()
+{
+    const auto m = make_random_matrix<Matrix>(40, 30, 300, 1);
+
+    for(std::size_t first : {0, 7, 39}) {
+        for(std::size_t last : {first, first + 1, std::size_t(25), std::size_t(100)}) {
+            const auto s = row_slice(m, first, last);
+            const auto nrows = std::min(last, m.rows()) > first
+                             ? std::min(last, m.rows()) - first : 0;
+
+            if(s.rows() != nrows || (nrows > 0 && s.cols() != m.cols()))
+                throw std::logic_error{"row_slice: shape"};
+
+            std::size_t nnz = 0;
+            for(std::size_t r = 0; r < s.rows(); ++r) {
+                if(s.row_size(r) != m.row_size(first + r))
+                    throw std::logic_error{"row_slice: row size"};
+                nnz += s.row_size(r);
+                //shares storage with the matrix
+                if(s.begin_row(r) != &*m.begin_row(first + r))
+                    throw std::logic_error{"row_slice: not a view"};
+                for(auto it = s.begin_row(r); it != s.end_row(r); ++it) {
+                    const auto c = s.col_index_of(it);
+                    if(!m.has(first + r, c) || m(first + r, c) != *it)
+                        throw std::logic_error{"row_slice: iteration"};
+                }
+                for(std::size_t c = 0; c < m.cols(); ++c) {
+                    if(s.has(r, c) != m.has(first + r, c) ||
+                       s(r, c) != m(first + r, c))
+                    {
+                        throw std::logic_error{"row_slice: element access"};
+                    }
+                }
+            }
+            if(s.size() != nnz || (nrows > 0 && s.row_offset(0) != 0))
+                throw std::logic_error{"row_slice: size"};
+
+            const auto copy = s.to_crs_matrix();
+            if(copy.rows() != s.rows() || copy.size() != s.size() ||
+               !std::equal(s.begin(), s.end(), copy.begin()) ||
+               !std::equal(copy.begin_col_indices(), copy.end_col_indices(),
+                           s.col_index_data()))
+            {
+                throw std::logic_error{"row_slice: to_crs_matrix"};
+            }
+        }
+    }
+
+    if(!row_slice(Matrix{}, 0, 5).empty())
+        throw std::logic_error{"row_slice: empty matrix"};
+}
+
+
+
+//-------------------------------------------------------------------
+template<class Matrix, class RowIndices>
+void check_extract(const Matrix& m, const Matrix& s, const RowIndices& rows,
+                   std::size_t firstCol, std::size_t lastCol)
+{
+    const auto ncols = lastCol > firstCol ? lastCol - firstCol : 0;
+    if(s.rows() != rows.size() || (s.rows() > 0 && s.cols() != ncols))
+        throw std::logic_error{"extract: shape"};
+
+    std::size_t nnz = 0;
+    std::size_t i = 0;
+    for(const auto r : rows) {
+        for(std::size_t c = firstCol; c < lastCol; ++c) {
+            const bool stored = r < m.rows() && m.has(r, c);
+            if(s.has(i, c - firstCol) != stored)
+                throw std::logic_error{"extract: pattern"};
+            if(stored) {
+                ++nnz;
+                if(s(i, c - firstCol) != m(r, c))
+                    throw std::logic_error{"extract: values"};
+            }
+        }
+        ++i;
+    }
+    if(s.size() != nnz) throw std::logic_error{"extract: size"};
+}
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+void test_extract()
+{
+    const auto m = make_random_matrix<Matrix>(50, 300, 2000, 2);
+
+    const auto rows = std::vector<std::size_t>{3, 0, 49, 3, 17, 120, 8};
+    const auto rowList = std::list<std::size_t>(rows.begin(), rows.end());
+
+    for(const auto& win : std::vector<std::pair<std::size_t,std::size_t>>{
+            {0, 300}, {0, 1}, {10, 20}, {100, 250}, {299, 300},
+            {250, 1000}, {40, 40}, {50, 10}})
+    {
+        check_extract(m, extract_rows(m, rows.begin(), rows.end(),
+                                      win.first, win.second),
+                      rows, win.first, win.second);
+        check_extract(m, extract_rows(m, rowList.begin(), rowList.end(),
+                                      win.first, win.second),
+                      rowList, win.first, win.second);
+
+        const auto block = std::vector<std::size_t>{5, 6, 7, 8, 9, 10};
+        check_extract(m, submatrix(m, 5, 11, win.first, win.second),
+                      block, win.first, win.second);
+    }
+
+    //row range is clamped
+    if(submatrix(m, 45, 1000, 0, m.cols()).rows() != 5 ||
+       submatrix(m, 60, 70, 0, m.cols()).rows() != 0)
+    {
+        throw std::logic_error{"submatrix: row clamping"};
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    using compact_t = crs_matrix<float,crs_matrix_static_value<float,0>,
+                                 std::allocator<float>,std::uint32_t,std::uint32_t>;
+    try {
+        test_row_slice<crs_matrix<int>>();
+        test_row_slice<compact_t>();
+
+        test_extract<crs_matrix<double>>();
+        test_extract<compact_t>();
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
@@ -0,0 +1,215 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "crs_matrix_solvers.h"
+
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <iostream>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+/// @brief 2D Poisson (5-point) matrix plus optional convection term
+template<class Matrix>
+Matrix make_grid_matrix(std::size_t w, std::size_t h, double convection = 0)
+{
+    using value_t = typename Matrix::value_type;
+
+    auto tri = std::vector<crs_triplet<value_t>>{};
+    for(std::size_t y = 0; y < h; ++y) {
+        for(std::size_t x = 0; x < w; ++x) {
+            const auto v = y*w + x;
+            tri.push_back({v, v, value_t(4)});
+            if(x > 0)   tri.push_back({v, v-1, value_t(-1 - convection)});
+            if(x+1 < w) tri.push_back({v, v+1, value_t(-1 + convection)});
+            if(y > 0)   tri.push_back({v, v-w, value_t(-1)});
+            if(y+1 < h) tri.push_back({v, v+w, value_t(-1)});
+        }
+    }
+    return Matrix::from_triplets(tri.begin(), tri.end());
+}
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+double true_residual(const Matrix& m, const std::vector<typename Matrix::value_type>& b,
+                     const std::vector<typename Matrix::value_type>& x)
+{
+    auto ax = std::vector<typename Matrix::value_type>{};
+    spmv(m, x, ax);
+    double rr = 0, bb = 0;
+    for(std::size_t i = 0; i < b.size(); ++i) {
+        rr += double((b[i] - ax[i]) * (b[i] - ax[i]));
+        bb += double(b[i] * b[i]);
+    }
+    return std::sqrt(rr / bb);
+}
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+std::vector<typename Matrix::value_type>
+make_rhs(const Matrix& m)
+{
+    using value_t = typename Matrix::value_type;
+    //b = A * [1 2 3 1 2 3 ...]
+    auto xs = std::vector<value_t>(m.cols());
+    for(std::size_t i = 0; i < xs.size(); ++i) xs[i] = value_t(1 + i % 3);
+    auto b = std::vector<value_t>{};
+    spmv(m, xs, b);
+    return b;
+}
+
+
+
+//-------------------------------------------------------------------
+void test_cg()
+{
+    using matrix_t = crs_matrix<double>;
+    const auto m = make_grid_matrix<matrix_t>(30, 20);
+    const auto b = make_rhs(m);
+
+    auto settings = solver_settings{};
+    settings.tolerance = 1e-10;
+
+    auto solver = cg_solver<double>{settings};
+
+    //unpreconditioned
+    auto x = std::vector<double>{};
+    const auto s0 = solver.solve(m, b, x);
+    if(!s0.converged || s0.iterations < 2 || true_residual(m, b, x) > 1e-8)
+        throw std::logic_error{"crs_matrix_solvers: cg"};
+    for(std::size_t i = 0; i < x.size(); ++i) {
+        if(std::abs(x[i] - double(1 + i % 3)) > 1e-6)
+            throw std::logic_error{"crs_matrix_solvers: cg solution"};
+    }
+    if(s0.total_seconds < s0.spmv_seconds || s0.total_seconds <= 0)
+        throw std::logic_error{"crs_matrix_solvers: cg timing"};
+
+    //Jacobi preconditioner (reused workspace), multiple threads
+    solver.settings().num_threads = 3;
+    const auto jacobi = jacobi_preconditioner<double>{m};
+    auto xj = std::vector<double>(m.rows(), 0.0);
+    const auto s1 = solver.solve(m, b, xj, jacobi);
+    if(!s1.converged || true_residual(m, b, xj) > 1e-8)
+        throw std::logic_error{"crs_matrix_solvers: cg jacobi"};
+
+    //ILU(0) needs fewer iterations
+    const auto ilu = ilu0_preconditioner<double>{m};
+    auto xi = std::vector<double>(m.rows(), 0.0);
+    const auto s2 = solver.solve(m, b, xi, ilu);
+    if(!s2.converged || true_residual(m, b, xi) > 1e-8 ||
+       s2.iterations >= s0.iterations)
+    {
+        throw std::logic_error{"crs_matrix_solvers: cg ilu0"};
+    }
+
+    //exact initial guess => no iterations
+    const auto s3 = solver.solve(m, b, xi, ilu);
+    if(!s3.converged || s3.iterations > 1)
+        throw std::logic_error{"crs_matrix_solvers: cg initial guess"};
+
+    //iteration limit
+    solver.settings().max_iterations = 3;
+    auto xl = std::vector<double>{};
+    const auto s4 = solver.solve(m, b, xl);
+    if(s4.converged || s4.iterations != 3)
+        throw std::logic_error{"crs_matrix_solvers: cg iteration limit"};
+}
+
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+void test_bicgstab(int numThreads)
+{
+    using value_t = typename Matrix::value_type;
+
+    const auto m = make_grid_matrix<Matrix>(25, 16, 0.4);
+    const auto b = make_rhs(m);
+    const double tol = sizeof(value_t) < 8 ? 1e-5 : 1e-10;
+
+    auto settings = solver_settings{};
+    settings.tolerance = tol;
+    settings.num_threads = numThreads;
+    auto solver = bicgstab_solver<value_t>{settings};
+
+    auto x = std::vector<value_t>{};
+    const auto s0 = solver.solve(m, b, x);
+    if(!s0.converged || true_residual(m, b, x) > 100 * tol)
+        throw std::logic_error{"crs_matrix_solvers: bicgstab"};
+
+    auto xj = std::vector<value_t>{};
+    const auto s1 = solver.solve(m, b, xj, jacobi_preconditioner<value_t>{m});
+    if(!s1.converged || true_residual(m, b, xj) > 100 * tol)
+        throw std::logic_error{"crs_matrix_solvers: bicgstab jacobi"};
+
+    auto xi = std::vector<value_t>{};
+    const auto s2 = solver.solve(m, b, xi, ilu0_preconditioner<value_t>{m});
+    if(!s2.converged || true_residual(m, b, xi) > 100 * tol ||
+       s2.iterations > s0.iterations)
+    {
+        throw std::logic_error{"crs_matrix_solvers: bicgstab ilu0"};
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+void test_errors()
+{
+    auto m = crs_matrix<double>{};
+    m.insert(0, 0, 1.0);
+    m.insert(1, 0, 1.0);
+    m.insert(1, 2, 1.0);
+
+    bool thrown = false;
+    try { jacobi_preconditioner<double>{m}; }
+    catch(crs_solver_error&) { thrown = true; }
+    if(!thrown) throw std::logic_error{"crs_matrix_solvers: jacobi error"};
+
+    thrown = false;
+    try { ilu0_preconditioner<double>{m}; }
+    catch(crs_solver_error&) { thrown = true; }
+    if(!thrown) throw std::logic_error{"crs_matrix_solvers: ilu0 error"};
+
+    m.insert(0, 3, 1.0);
+    m.rows(3);
+    thrown = false;
+    try {
+        auto x = std::vector<double>{};
+        cg_solver<double>{}.solve(m, std::vector<double>(3, 1.0), x);
+    }
+    catch(crs_solver_error&) { thrown = true; }
+    if(!thrown) throw std::logic_error{"crs_matrix_solvers: non-square error"};
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_cg();
+        test_bicgstab<crs_matrix<double>>(1);
+        test_bicgstab<crs_matrix<double>>(4);
+        test_bicgstab<crs_matrix<float,crs_matrix_static_value<float,0>,
+            std::allocator<float>,std::uint32_t,std::uint32_t>>(2);
+        test_errors();
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
@@ -11,11 +11,15 @@
 #include "crs_matrix.h"
 
 #include <vector>
+#include <cmath>
 #include <set>
 #include <algorithm>
 #include <stdexcept>
 #include <iostream>
 #include <random>
+#include <functional>
+#include <cstdint>
+#include <type_traits>
 
 using namespace am;
 
@@ -185,6 +189,71 @@ void check_find_and_index_queries(const fixture<T,NA>& fix,
 
 
 
+//-------------------------------------------------------------------
+template<class T, class NA>
+void check_nonzero_iteration(const crs_matrix<T,NA>& m)
+{
+    using idx_t = typename crs_matrix<T,NA>::size_type;
+
+    //proxy iterator => must not claim to be a forward iterator
+    static_assert(std::is_same<typename std::iterator_traits<decltype(
+        m.begin_nonzeros())>::iterator_category,
+        std::input_iterator_tag>::value, "crs_matrix: nonzero iterator category");
+
+    //full scan yields the same as index_of
+    idx_t n = 0;
+    auto vit = m.begin();
+    for(const auto& x : m.nonzeros()) {
+        const auto idx = m.index_of(vit);
+        if(x.row != idx.first || x.col != idx.second || x.value != *vit)
+            throw std::logic_error{"crs_matrix, nonzeros"};
+        ++vit;
+        ++n;
+    }
+    if(n != m.size() || m.nonzeros().size() != m.size())
+        throw std::logic_error{"crs_matrix, nonzeros size"};
+
+    //split ranges cover all elements in order
+    for(int parts : {1, 2, 3, 7}) {
+        auto it = m.begin_nonzeros();
+        for(const auto& range : m.nonzeros().split(parts)) {
+            for(const auto& x : range) {
+                if(x.row != it.row() || x.col != it.col() || x.value != it.value())
+                    throw std::logic_error{"crs_matrix, nonzeros split"};
+                ++it;
+            }
+        }
+        if(it != m.end_nonzeros())
+            throw std::logic_error{"crs_matrix, nonzeros split coverage"};
+    }
+
+    //starting at arbitrary rows
+    for(idx_t r = 0; r <= m.rows(); ++r) {
+        const auto it = m.begin_nonzeros(r);
+        if(it == m.end_nonzeros()) {
+            for(idx_t i = r; i < m.rows(); ++i) {
+                if(!m.row_empty(i))
+                    throw std::logic_error{"crs_matrix, begin_nonzeros(row) end"};
+            }
+        }
+        else if(it.row() < r || it.offset() != idx_t(m.begin_row(it.row()) - m.begin()) ||
+                (it.row() > r && r < m.rows() && !m.row_empty(r)))
+        {
+            throw std::logic_error{"crs_matrix, begin_nonzeros(row)"};
+        }
+    }
+
+    //write access
+    auto c = m;
+    for(auto x : c.nonzeros()) x.value = T(x.row + x.col);
+    for(const auto& x : c.nonzeros()) {
+        if(c(x.row, x.col) != T(x.row + x.col))
+            throw std::logic_error{"crs_matrix, nonzeros write access"};
+    }
+}
+
+
+
 //-------------------------------------------------------------------
 template<class T, class NA>
 void run_tests(const fixture<T,NA>& fix)
@@ -204,7 +273,433 @@ void run_tests(const fixture<T,NA>& fix)
     check_raw_values_column_indices(fix, m);
     check_indexed_access(fix, m);
     check_find_and_index_queries(fix, m);
+    check_nonzero_iteration(m);
+
+    //bulk construction has to yield the same matrix
+    for(int threads : {1, 3}) {
+        auto tri = std::vector<crs_triplet<T>>{};
+        for(const auto& x : fix.original_items()) {
+            tri.push_back(crs_triplet<T>{x.row, x.col, x.val});
+        }
+        auto b = mat_t::from_triplets(tri.begin(), tri.end(),
+                                      crs_keep_last{}, threads);
 
+        if(fix.expected_items().empty() != b.empty())
+            throw std::logic_error{"crs_matrix, from_triplets emptiness"};
+
+        if(b.rows() != m.rows())
+            throw std::logic_error{"crs_matrix, from_triplets rows"};
+
+        check_raw_values_column_indices(fix, b);
+        check_indexed_access(fix, b);
+        check_find_and_index_queries(fix, b);
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+void test_from_triplets_combine()
+{
+    using mat_t = crs_matrix<int>;
+    using t = crs_triplet<int>;
+
+    auto tri = std::vector<t>{
+        t{2,1, 1}, t{0,4, 2}, t{2,1, 3}, t{0,0, 4}, t{2,1, 5}, t{0,4, 6} };
+
+    for(int threads : {1, 2, 4}) {
+        auto m = mat_t::from_triplets(tri.begin(), tri.end(),
+                                      std::plus<int>{}, threads);
+
+        if(m.size() != 3 || m.rows() != 3 || !m.row_empty(1))
+            throw std::logic_error{"crs_matrix, from_triplets structure"};
+
+        if(m(2,1) != 9 || m(0,4) != 8 || m(0,0) != 4)
+            throw std::logic_error{"crs_matrix, from_triplets combine"};
+    }
+
+    auto empty = std::vector<t>{};
+    if(!mat_t::from_triplets(empty.begin(), empty.end()).empty())
+        throw std::logic_error{"crs_matrix, from_triplets empty input"};
+}
+
+
+
+//-------------------------------------------------------------------
+template<class ColIndex, class RowOffset>
+void test_compact_index_types()
+{
+    using na_t    = crs_matrix_static_value<int,0>;
+    using wide_t  = crs_matrix<int,na_t>;
+    using small_t = crs_matrix<int,na_t,std::allocator<int>,ColIndex,RowOffset>;
+
+    static_assert(std::is_same<
+        decltype(std::declval<small_t>().col_index_data()),
+        const ColIndex*>::value, "crs_matrix: col_index_data type");
+
+    static_assert(std::is_same<
+        decltype(std::declval<small_t>().row_offset_data()),
+        const RowOffset*>::value, "crs_matrix: row_offset_data type");
+
+    auto urbg = std::mt19937{};
+    auto idxDistr = std::uniform_int_distribution<std::size_t>{0,60};
+    auto valDistr = std::uniform_int_distribution<int>{1,100};
+
+    auto w = wide_t{};
+    auto s = small_t{};
+    auto tri = std::vector<crs_triplet<int>>{};
+
+    for(int i = 0; i < 500; ++i) {
+        const auto r = idxDistr(urbg);
+        const auto c = idxDistr(urbg);
+        const auto v = valDistr(urbg);
+        w.insert(r, c, v);
+        s.insert(r, c, v);
+        tri.push_back(crs_triplet<int>{r, c, v});
+    }
+    for(int i = 0; i < 100; ++i) {
+        const auto r = idxDistr(urbg);
+        const auto c = idxDistr(urbg);
+        if(w.erase(r,c) != s.erase(r,c))
+            throw std::logic_error{"crs_matrix, compact indices: erase"};
+        tri.erase(std::remove_if(tri.begin(), tri.end(),
+            [&](const crs_triplet<int>& t) { return t.row == r && t.col == c; }),
+            tri.end());
+    }
+    w.erase_rows(3,5);
+    s.erase_rows(3,5);
+
+    auto b = small_t::from_triplets(tri.begin(), tri.end());
+    b.erase_rows(3,5);
+
+    if(w.size() != s.size() || w.rows() != s.rows() || w.cols() != s.cols() ||
+       w.size() != b.size())
+    {
+        throw std::logic_error{"crs_matrix, compact indices: size"};
+    }
+
+    for(std::size_t r = 0; r < w.rows(); ++r) {
+        for(std::size_t c = 0; c < w.cols(); ++c) {
+            if(w(r,c) != s(r,c) || w.has(r,c) != s.has(r,c) ||
+               w(r,c) != b(r,c))
+            {
+                throw std::logic_error{"crs_matrix, compact indices: values"};
+            }
+        }
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+void test_index_type_overflow()
+{
+    using na_t   = crs_matrix_static_value<int,0>;
+    using tiny_t = crs_matrix<int,na_t,std::allocator<int>,
+                              std::uint8_t,std::uint8_t>;
+
+    const auto throws = [](std::function<void()> f) {
+        try { f(); } catch(std::out_of_range&) { return 1; }
+                     catch(std::length_error&) { return 2; }
+        return 0;
+    };
+
+    auto m = tiny_t{};
+    m.insert(0, 255, 1);
+    if(throws([&]{ m.insert(0, 300, 2); }) != 1 ||
+       throws([&]{ m.insert(5, 256, 2); }) != 1 ||
+       m.size() != 1 || m.rows() != 1 || m.cols() != 256)
+    {
+        throw std::logic_error{"crs_matrix, small index types: insert column"};
+    }
+
+    //at most 255 elements are addressable by 8 bit row offsets
+    for(std::size_t c = 0; c < 254; ++c) m.insert(1, c, 1);
+    if(throws([&]{ m.insert(2, 0, 3); }) != 2 ||
+       throws([&]{ m.insert(1, 254, 3); }) != 2 ||
+       m.size() != 255)
+    {
+        throw std::logic_error{"crs_matrix, small index types: insert size"};
+    }
+    //modifying existing elements is still fine
+    m.insert(1, 3, 7);
+    if(m(1,3) != 7) throw std::logic_error{"crs_matrix, small index types: modify"};
+
+    auto tri = std::vector<crs_triplet<int>>{{0,1,1}, {2,300,1}};
+    if(throws([&]{ tiny_t::from_triplets(tri.begin(), tri.end()); }) != 1)
+        throw std::logic_error{"crs_matrix, small index types: from_triplets"};
+
+    auto r = tiny_t{1,2,3};
+    if(throws([&]{ r.col_indices(0, {1, 2, 300}); }) != 1 ||
+       r.col_index_of(r.begin() + 2) != 2)
+    {
+        throw std::logic_error{"crs_matrix, small index types: col_indices"};
+    }
+
+    if(throws([&]{ r.assign(std::vector<int>(300, 1)); }) != 2 || r.size() != 3)
+        throw std::logic_error{"crs_matrix, small index types: assign"};
+}
+
+
+
+//-------------------------------------------------------------------
+void test_column_extent()
+{
+    using mat_t = crs_matrix<int>;
+
+    //reference: full scan over all column indices
+    auto check = [](const mat_t& m, const char* msg) {
+        std::size_t ext = 0;
+        for(auto c : m.col_indices()) ext = std::max(ext, c + 1);
+        if(m.col_extent() != ext) throw std::logic_error{msg};
+    };
+
+    auto m = mat_t{};
+    if(m.cols() != 0) throw std::logic_error{"crs_matrix, cols: empty"};
+
+    m.insert(0, 3, 1);
+    m.insert(2, 7, 2);
+    m.insert(2, 1, 3);
+    m.insert(4, 5, 4);
+    if(m.cols() != 8) throw std::logic_error{"crs_matrix, cols: insert"};
+    check(m, "crs_matrix, col extent: insert");
+
+    //erasing the maximum column
+    m.erase(2, 7);
+    if(m.cols() != 6) throw std::logic_error{"crs_matrix, cols: erase max"};
+    check(m, "crs_matrix, col extent: erase");
+
+    m.erase(2, 1);
+    if(m.cols() != 6) throw std::logic_error{"crs_matrix, cols: erase"};
+
+    //shifting rows
+    m.shift_row(0, 10);
+    if(m.cols() != 14) throw std::logic_error{"crs_matrix, cols: shift right"};
+    m.shift_row(0, -12);
+    if(m.cols() != 6) throw std::logic_error{"crs_matrix, cols: shift left"};
+    check(m, "crs_matrix, col extent: shift_row");
+
+    //setting column indices
+    m.col_indices(4, {20});
+    if(m.cols() != 21) throw std::logic_error{"crs_matrix, cols: col_indices"};
+    m.col_indices(4, {2});
+    if(m.cols() != 3) throw std::logic_error{"crs_matrix, cols: col_indices"};
+    check(m, "crs_matrix, col extent: col_indices");
+
+    //erasing rows
+    m.insert(1, 9, 5);
+    m.erase_rows(1, 1);
+    if(m.cols() != 3) throw std::logic_error{"crs_matrix, cols: erase_rows"};
+    check(m, "crs_matrix, col extent: erase_rows");
+
+    //declared logical column count keeps trailing empty columns
+    m.cols(10);
+    if(m.cols() != 10) throw std::logic_error{"crs_matrix, cols: declared"};
+    m.insert(0, 12, 6);
+    if(m.cols() != 13) throw std::logic_error{"crs_matrix, cols: declared"};
+    m.erase(0, 12);
+    if(m.cols() != 10) throw std::logic_error{"crs_matrix, cols: declared"};
+
+    //copies keep declared columns
+    auto m2 = m;
+    if(m2.cols() != 10) throw std::logic_error{"crs_matrix, cols: copy"};
+
+    //changing the number of rows
+    const auto rows = m.rows();
+    m.rows(rows + 5);
+    if(m.rows() != rows + 5 || !m.row_empty(rows + 4))
+        throw std::logic_error{"crs_matrix, rows: grow"};
+    m.rows(1);
+    if(m.rows() != 1 || m.size() != m.row_size(0))
+        throw std::logic_error{"crs_matrix, rows: shrink"};
+    check(m, "crs_matrix, col extent: rows");
+
+    m.clear();
+    if(m.cols() != 0) throw std::logic_error{"crs_matrix, cols: clear"};
+
+    //bulk construction
+    auto tri = std::vector<crs_triplet<int>>{ {1,4,1}, {0,2,1}, {3,0,1} };
+    if(mat_t::from_triplets(tri.begin(), tri.end()).cols() != 5)
+        throw std::logic_error{"crs_matrix, cols: from_triplets"};
+
+    //adopted raw arrays: extent is known right away, so concurrent
+    //readers of a const matrix never have to compute it
+    const auto a = mat_t{mat_t::value_storage{1,2,3},
+                         mat_t::col_index_storage{6,2,4},
+                         mat_t::row_offset_storage{0,1,1,3}};
+    if(a.cols() != 7) throw std::logic_error{"crs_matrix, cols: raw arrays"};
+    check(a, "crs_matrix, col extent: raw arrays");
+}
+
+
+
+//-------------------------------------------------------------------
+void test_erase_if()
+{
+    auto urbg = std::mt19937{};
+    auto idxDistr = std::uniform_int_distribution<std::size_t>{0,200};
+    auto valDistr = std::uniform_int_distribution<int>{-50,50};
+
+    auto tri = std::vector<crs_triplet<int>>{};
+    for(int i = 0; i < 5000; ++i) {
+        tri.push_back({idxDistr(urbg), idxDistr(urbg), valDistr(urbg)});
+    }
+    const auto orig = crs_matrix<int>::from_triplets(tri.begin(), tri.end());
+
+    const auto pred = [](std::size_t r, std::size_t c, int v) {
+        return (r + c) % 3 == 0 || v > 40;
+    };
+
+    for(int threads : {1, 2, 5}) {
+        auto m = orig;
+        const auto removed = m.erase_if(pred, threads);
+
+        std::size_t expected = 0;
+        for(const auto& x : orig.nonzeros()) {
+            const bool erased = pred(x.row, x.col, x.value);
+            if(erased) ++expected;
+            if(m.has(x.row, x.col) == erased)
+                throw std::logic_error{"crs_matrix, erase_if: content"};
+            if(!erased && m(x.row, x.col) != x.value)
+                throw std::logic_error{"crs_matrix, erase_if: values"};
+        }
+        if(removed != expected || m.size() != orig.size() - expected ||
+           m.rows() != orig.rows())
+        {
+            throw std::logic_error{"crs_matrix, erase_if: count"};
+        }
+        check_nonzero_iteration(m);
+    }
+
+    for(int threads : {1, 3}) {
+        auto m = orig;
+        const auto removed = m.prune(10, threads);
+        for(const auto& x : m.nonzeros()) {
+            if(x.value >= -10 && x.value <= 10)
+                throw std::logic_error{"crs_matrix, prune"};
+        }
+        if(m.size() + removed != orig.size())
+            throw std::logic_error{"crs_matrix, prune: count"};
+    }
+
+    //throwing predicate: visited elements are erased, the rest is kept
+    {
+        auto m = orig;
+        const std::size_t limit = orig.size() / 2;
+        std::size_t calls = 0;
+        bool thrown = false;
+        try {
+            m.erase_if([&](std::size_t r, std::size_t c, int v) {
+                if(++calls > limit) throw std::runtime_error{"pred"};
+                return pred(r, c, v);
+            });
+        }
+        catch(std::runtime_error&) {
+            thrown = true;
+        }
+        if(!thrown) throw std::logic_error{"crs_matrix, erase_if: rethrow"};
+
+        std::size_t i = 0;
+        for(const auto& x : orig.nonzeros()) {
+            const bool erased = i++ < limit && pred(x.row, x.col, x.value);
+            if(m.has(x.row, x.col) == erased ||
+               (!erased && m(x.row, x.col) != x.value))
+            {
+                throw std::logic_error{"crs_matrix, erase_if: throwing predicate"};
+            }
+        }
+        if(m.rows() != orig.rows() || m.cols() != orig.cols())
+            throw std::logic_error{"crs_matrix, erase_if: throwing predicate"};
+        check_nonzero_iteration(m);
+    }
+
+    //removing the elements with the largest column index shrinks cols()
+    auto m = crs_matrix<double>{};
+    m.insert(0, 1, 1.0);
+    m.insert(1, 9, 1e-9);
+    if(m.prune(1e-6) != 1 || m.cols() != 2 || m.size() != 1)
+        throw std::logic_error{"crs_matrix, prune: column extent"};
+
+    //value type without default constructor
+    struct boxed {
+        explicit boxed(int x): v{x} {}
+        int v;
+    };
+    struct boxed_na { static boxed value() { return boxed{0}; } };
+
+    for(int threads : {1, 4}) {
+        auto b = crs_matrix<boxed,boxed_na>{};
+        for(std::size_t i = 0; i < 400; ++i) {
+            b.insert(i % 37, i % 11, boxed{int(i)});
+        }
+        const auto total = b.size();
+        const auto removed = b.erase_if(
+            [](std::size_t, std::size_t, const boxed& x) { return x.v % 2 != 0; },
+            threads);
+        if(b.size() + removed != total)
+            throw std::logic_error{"crs_matrix, erase_if: non-default-constructible"};
+        for(const auto& x : b.nonzeros()) {
+            if(x.value.v % 2 != 0 || int(x.col) != x.value.v % 11)
+                throw std::logic_error{"crs_matrix, erase_if: non-default-constructible"};
+        }
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+void test_stats()
+{
+    //row r has (r * 37) % 400 elements => short and long (>= 256) rows
+    auto tri = std::vector<crs_triplet<float>>{};
+    auto lengths = std::vector<std::size_t>{};
+    for(std::size_t r = 0; r < 1000; ++r) {
+        const auto len = (r * 37) % 400;
+        lengths.push_back(len);
+        for(std::size_t c = 0; c < len; ++c) tri.push_back({r, 2*c, 1.0f});
+    }
+    using matrix_t = crs_matrix<float,crs_matrix_static_value<float,0>,
+                                std::allocator<float>,std::uint32_t,std::uint32_t>;
+    auto m = matrix_t::from_triplets(tri.begin(), tri.end());
+    m.rows(1100);
+    lengths.resize(1100, 0);
+    std::sort(lengths.begin(), lengths.end());
+
+    const auto nearest_rank = [&](double q) {
+        auto rank = std::size_t(q * double(lengths.size()));
+        if(double(rank) < q * double(lengths.size())) ++rank;
+        return lengths[rank - 1];
+    };
+
+    for(int threads : {1, 3, 8}) {
+        const auto s = m.stats(threads);
+        if(s.rows != 1100 || s.cols != m.cols() || s.nnz != tri.size() ||
+           s.empty_rows != std::size_t(std::count(lengths.begin(), lengths.end(), 0)) ||
+           s.min_row_length != 0 || s.max_row_length != lengths.back() ||
+           std::abs(s.mean_row_length - double(tri.size()) / 1100.0) > 1e-9)
+        {
+            throw std::logic_error{"crs_matrix, stats: row lengths"};
+        }
+        if(s.median_row_length != nearest_rank(0.5) ||
+           s.p90_row_length != nearest_rank(0.9) ||
+           s.p99_row_length != nearest_rank(0.99))
+        {
+            throw std::logic_error{"crs_matrix, stats: percentiles"};
+        }
+        if(s.value_bytes != 4 * tri.size() ||
+           s.col_index_bytes != 4 * tri.size() ||
+           s.row_offset_bytes != 4 * 1101 ||
+           s.bytes_reserved() < s.bytes_used() ||
+           s.value_bytes_reserved != 4 * m.capacity() ||
+           s.spmv_bytes != s.bytes_used() + 4 * (1100 + m.cols()))
+        {
+            throw std::logic_error{"crs_matrix, stats: memory"};
+        }
+    }
+
+    const auto e = crs_matrix<int>{}.stats();
+    if(e.rows != 0 || e.nnz != 0 || e.max_row_length != 0 || e.value_bytes != 0)
+        throw std::logic_error{"crs_matrix, stats: empty matrix"};
 }
 
 
@@ -325,6 +820,19 @@ void test_all()
         run_tests(fix_t{std::move(v)});
     }
 
+    test_from_triplets_combine();
+
+    test_column_extent();
+
+    test_erase_if();
+
+    test_stats();
+
+    test_compact_index_types<std::uint32_t,std::uint64_t>();
+    test_compact_index_types<std::uint32_t,std::uint32_t>();
+    test_compact_index_types<std::uint16_t,std::uint32_t>();
+    test_index_type_overflow();
+
 //    if(sum != -190)
 //        throw std::logic_error{"crs_matrix, pure diagonal, indexed access"};
 }
@@ -0,0 +1,105 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "crs_search.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+/// @brief strictly ascending sequence; 'skewed' clusters most values
+///        at the beginning to defeat interpolation
+template<class T>
+std::vector<T> make_sequence(std::size_t n, bool skewed, std::mt19937& urbg)
+{
+    auto gapDistr = std::uniform_int_distribution<int>{1,5};
+    auto v = std::vector<T>{};
+    v.reserve(n);
+    T x = T(gapDistr(urbg));
+    for(std::size_t i = 0; i < n; ++i) {
+        v.push_back(x);
+        const auto gap = (skewed && i + 2 == n) ? 10000 : gapDistr(urbg);
+        x = T(x + T(gap));
+    }
+    return v;
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T, class Search>
+void check_strategy(const std::vector<T>& v, Search search, const char* msg)
+{
+    const auto first = v.data();
+    const auto last  = v.data() + v.size();
+    const auto maxKey = v.empty() ? 3 : int(v.back()) + 3;
+
+    for(int k = 0; k <= maxKey; ++k) {
+        const auto key = T(k);
+        if(search(first, last, key) != std::lower_bound(first, last, key))
+            throw std::logic_error{msg};
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+void test_strategies()
+{
+    auto urbg = std::mt19937{};
+
+    for(std::size_t n : {0, 1, 2, 3, 7, 8, 9, 31, 32, 33, 100, 1000, 5000}) {
+        for(bool skewed : {false, true}) {
+            const auto v = make_sequence<T>(n, skewed, urbg);
+
+            check_strategy(v, [](const T* f, const T* l, const T& k) {
+                    return linear_lower_bound(f,l,k); },
+                "crs_search: linear");
+
+            check_strategy(v, [](const T* f, const T* l, const T& k) {
+                    return branchless_lower_bound(f,l,k); },
+                "crs_search: branchless binary");
+
+            check_strategy(v, [](const T* f, const T* l, const T& k) {
+                    return interpolation_lower_bound(f,l,k); },
+                "crs_search: interpolation");
+
+            check_strategy(v, [](const T* f, const T* l, const T& k) {
+                    return adaptive_lower_bound(f,l,k); },
+                "crs_search: adaptive");
+        }
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_strategies<std::uint32_t>();
+        test_strategies<std::uint64_t>();
+        test_strategies<std::size_t>();
+        test_strategies<int>();
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
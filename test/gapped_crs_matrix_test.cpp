@@ -0,0 +1,166 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "gapped_crs_matrix.h"
+
+#include <vector>
+#include <map>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+template<class Gapped, class Map>
+void check_equal(const Gapped& g, const Map& ref, const char* msg)
+{
+    if(g.size() != ref.size()) throw std::logic_error{msg};
+
+    std::size_t n = 0;
+    for(std::size_t r = 0; r < g.rows(); ++r) {
+        if(g.row_size(r) > g.row_capacity(r)) throw std::logic_error{msg};
+
+        std::size_t prevCol = 0;
+        for(auto it = g.begin_row(r); it != g.end_row(r); ++it, ++n) {
+            const auto c = g.col_index_of(it);
+            if(it != g.begin_row(r) && c <= prevCol) throw std::logic_error{msg};
+            prevCol = c;
+
+            const auto i = ref.find(std::make_pair(r,c));
+            if(i == ref.end() || i->second != *it || g(r,c) != *it || !g.has(r,c))
+                throw std::logic_error{msg};
+        }
+    }
+    if(n != ref.size()) throw std::logic_error{msg};
+}
+
+
+
+//-------------------------------------------------------------------
+void test_insert_erase()
+{
+    using gapped_t = gapped_crs_matrix<int>;
+
+    auto g = gapped_t{};
+    auto ref = std::map<std::pair<std::size_t,std::size_t>,int>{};
+
+    auto urg = std::mt19937{7};
+    auto rowDistr = std::uniform_int_distribution<std::size_t>{0, 63};
+    auto colDistr = std::uniform_int_distribution<std::size_t>{0, 199};
+    auto valDistr = std::uniform_int_distribution<int>{1, 99};
+
+    for(int i = 0; i < 5000; ++i) {
+        const auto r = rowDistr(urg);
+        const auto c = colDistr(urg);
+        const auto v = valDistr(urg);
+        if(i % 4 == 3) {
+            const bool erased = g.erase(r, c);
+            if(erased != (ref.erase(std::make_pair(r,c)) > 0))
+                throw std::logic_error{"gapped_crs_matrix: erase result"};
+        } else {
+            const bool inserted = g.insert(r, c, v);
+            const auto ins = ref.insert({std::make_pair(r,c), v});
+            if(!ins.second) ins.first->second = v;
+            if(inserted != ins.second)
+                throw std::logic_error{"gapped_crs_matrix: insert result"};
+        }
+    }
+    check_equal(g, ref, "gapped_crs_matrix: random insert/erase");
+
+    if(g.has(64, 0) || g(64, 0) != 0 || g.erase(100, 3))
+        throw std::logic_error{"gapped_crs_matrix: missing element"};
+
+    //slack stays bounded
+    if(g.capacity() > 4 * g.size() + 16)
+        throw std::logic_error{"gapped_crs_matrix: capacity"};
+
+    //compact => plain CRS arrays
+    g.compact();
+    if(g.capacity() != g.size())
+        throw std::logic_error{"gapped_crs_matrix: compact capacity"};
+    for(std::size_t r = 0; r < g.rows(); ++r) {
+        if(g.row_offset_data()[r+1] - g.row_offset_data()[r] != g.row_size(r))
+            throw std::logic_error{"gapped_crs_matrix: compact offsets"};
+    }
+    check_equal(g, ref, "gapped_crs_matrix: compact");
+
+    //inserting after compaction
+    g.insert(5, 1000, -1);
+    ref[std::make_pair(std::size_t(5),std::size_t(1000))] = -1;
+    check_equal(g, ref, "gapped_crs_matrix: insert after compact");
+    if(g.cols() != 1001)
+        throw std::logic_error{"gapped_crs_matrix: cols"};
+}
+
+
+
+//-------------------------------------------------------------------
+void test_conversion()
+{
+    auto m = crs_matrix<double>{};
+    m.insert(0, 1, 1.0);
+    m.insert(0, 4, 2.0);
+    m.insert(2, 0, 3.0);
+    m.insert(3, 3, 4.0);
+    m.cols(10);
+
+    auto g = gapped_crs_matrix<double>{m, 1.0};
+    if(g.rows() != 4 || g.cols() != 10 || g.size() != 4 || g.capacity() != 8)
+        throw std::logic_error{"gapped_crs_matrix: construction"};
+
+    //row with free slots => only that row changes
+    const auto offsets = std::vector<std::size_t>(
+        g.row_offset_data(), g.row_offset_data() + g.rows() + 1);
+    std::size_t r = 0;
+    while(g.row_capacity(r) == g.row_size(r)) ++r;
+    g.insert(r, 9, 5.0);
+    for(std::size_t i = 0; i <= g.rows(); ++i) {
+        if(g.row_offset_data()[i] != offsets[i])
+            throw std::logic_error{"gapped_crs_matrix: local insert"};
+    }
+
+    for(std::size_t i = 0; i < 100; ++i) g.insert(1, i, double(i));
+    g.insert(7, 2, 6.0);
+
+    const auto m2 = g.to_crs_matrix();
+    if(m2.rows() != 8 || m2.size() != g.size() || m2.cols() != 100)
+        throw std::logic_error{"gapped_crs_matrix: to_crs_matrix sizes"};
+    for(std::size_t i = 0; i < m2.rows(); ++i) {
+        for(auto it = m2.begin_row(i); it != m2.end_row(i); ++it) {
+            if(g(i, m2.col_index_of(it)) != *it)
+                throw std::logic_error{"gapped_crs_matrix: to_crs_matrix values"};
+        }
+        if(m2.row_size(i) != g.row_size(i))
+            throw std::logic_error{"gapped_crs_matrix: to_crs_matrix rows"};
+    }
+
+    double sum = 0;
+    for(const auto& x : g.row(1)) sum += x;
+    if(sum != 99.0 * 100.0 / 2.0)
+        throw std::logic_error{"gapped_crs_matrix: row range"};
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_insert_erase();
+        test_conversion();
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
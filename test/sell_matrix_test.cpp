@@ -0,0 +1,121 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "sell_matrix.h"
+
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+/// @brief matrix with very uneven row lengths
+template<class T>
+crs_matrix<T> make_skewed_matrix(std::size_t rows, std::size_t cols)
+{
+    auto urbg = std::mt19937{};
+    auto colDistr = std::uniform_int_distribution<std::size_t>{0, cols - 1};
+    auto valDistr = std::uniform_int_distribution<int>{1,9};
+
+    auto tri = std::vector<crs_triplet<T>>{};
+    for(std::size_t r = 0; r < rows; ++r) {
+        const auto len = (r % 17 == 0) ? cols / 2 : (r % 5);
+        for(std::size_t i = 0; i < len; ++i) {
+            tri.push_back({r, colDistr(urbg), T(valDistr(urbg))});
+        }
+    }
+    auto m = crs_matrix<T>::from_triplets(tri.begin(), tri.end());
+    m.rows(rows);
+    m.cols(cols);
+    return m;
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T, std::size_t C>
+void test_layout(std::size_t sigma)
+{
+    const auto m = make_skewed_matrix<T>(203, 90);
+    const auto s = sell_matrix<T,C>{m, sigma};
+
+    if(s.rows() != m.rows() || s.cols() != m.cols() || s.size() != m.size() ||
+       s.num_chunks() != (m.rows() + C - 1) / C || s.padded_size() < s.size())
+    {
+        throw std::logic_error{"sell_matrix: sizes"};
+    }
+
+    //permutation sorts rows by length within windows
+    const auto perm = s.permutation();
+    for(std::size_t i = 0; i < m.rows(); ++i) {
+        if(s.inverse_permutation()[perm[i]] != i)
+            throw std::logic_error{"sell_matrix: inverse permutation"};
+        if(i % s.sigma() != 0 && m.row_size(perm[i-1]) < m.row_size(perm[i]))
+            throw std::logic_error{"sell_matrix: row sorting"};
+    }
+
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        for(std::size_t c = 0; c < m.cols(); ++c) {
+            if(s(r,c) != m(r,c)) throw std::logic_error{"sell_matrix: values"};
+        }
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T, std::size_t C>
+void test_spmv(std::size_t sigma, int numThreads)
+{
+    const auto m = make_skewed_matrix<T>(517, 300);
+    const auto s = sell_matrix<T,C>{m, sigma};
+
+    auto x = std::vector<T>(m.cols());
+    for(std::size_t i = 0; i < x.size(); ++i) x[i] = T(i % 7) - T(3);
+
+    auto y = std::vector<T>(m.rows(), T(1));
+    spmv(s, x, y, T(2), T(3), numThreads);
+
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        T ref = T(0);
+        for(auto i = m.begin_row(r); i != m.end_row(r); ++i) {
+            ref += *i * x[m.col_index_of(i)];
+        }
+        ref = T(2) * ref + T(3);
+        if(std::abs(double(y[r] - ref)) > 1e-9)
+            throw std::logic_error{"sell_matrix: spmv"};
+    }
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_layout<int,4>(1);
+        test_layout<int,4>(16);
+        test_layout<double,8>(0);
+        test_layout<double,8>(13);
+        test_spmv<double,4>(1, 1);
+        test_spmv<double,8>(64, 3);
+        test_spmv<float,8>(0, 0);
+        test_spmv<int,16>(256, 2);
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
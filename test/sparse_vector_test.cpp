@@ -0,0 +1,180 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "sparse_vector.h"
+
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+void test_sparse_vector()
+{
+    auto v = sparse_vector<int>{10};
+    v.push_back(1, 5);
+    v.push_back(4, 7);
+    if(!v.insert(2, 3) || v.insert(4, 8) || !v.insert(12, 1))
+        throw std::logic_error{"sparse_vector: insert"};
+
+    if(v.size() != 4 || v.dimension() != 13 || v[4] != 8 || v[3] != 0 ||
+       !v.has(2) || v.has(0))
+    {
+        throw std::logic_error{"sparse_vector: access"};
+    }
+    const auto expected = std::vector<std::size_t>{1, 2, 4, 12};
+    if(!std::equal(v.begin_indices(), v.end_indices(), expected.begin()))
+        throw std::logic_error{"sparse_vector: index order"};
+
+    if(!v.erase(2) || v.erase(2) || v.size() != 3)
+        throw std::logic_error{"sparse_vector: erase"};
+
+    auto d = std::vector<int>{};
+    v.to_dense(d);
+    if(d.size() != 13 || d[1] != 5 || d[4] != 8 || d[12] != 1 || d[2] != 0)
+        throw std::logic_error{"sparse_vector: to_dense"};
+
+    const auto w = sparse_vector<int>{d};
+    if(w.size() != 3 || w.dimension() != 13 || w[12] != 1)
+        throw std::logic_error{"sparse_vector: from dense"};
+
+    v.clear();
+    if(!v.empty() || v.dimension() != 13)
+        throw std::logic_error{"sparse_vector: clear"};
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+crs_matrix<T> make_random_matrix(std::size_t rows, std::size_t cols,
+                                 std::size_t nnz, unsigned seed)
+{
+    auto urbg = std::mt19937{seed};
+    auto rowDistr = std::uniform_int_distribution<std::size_t>{0, rows-1};
+    auto colDistr = std::uniform_int_distribution<std::size_t>{0, cols-1};
+    auto valDistr = std::uniform_int_distribution<int>{1, 9};
+
+    auto tri = std::vector<crs_triplet<T>>{};
+    for(std::size_t i = 0; i < nnz; ++i) {
+        tri.push_back({rowDistr(urbg), colDistr(urbg), T(valDistr(urbg))});
+    }
+    auto m = crs_matrix<T>::from_triplets(tri.begin(), tri.end());
+    m.rows(rows);
+    m.cols(cols);
+    return m;
+}
+
+
+//-------------------------------------------------------------------
+template<class T>
+void check_product(const crs_matrix<T>& m, const sparse_vector<T>& x,
+                   const sparse_vector<T>& y)
+{
+    //reference: rows with at least one column in x
+    auto ref = sparse_vector<T>{m.rows()};
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        bool hit = false;
+        T sum = T(0);
+        for(auto it = m.begin_row(r); it != m.end_row(r); ++it) {
+            const auto c = m.col_index_of(it);
+            if(x.has(c)) {
+                hit = true;
+                sum += *it * x[c];
+            }
+        }
+        if(hit) ref.push_back(r, sum);
+    }
+
+    if(y.size() != ref.size() || y.dimension() != m.rows() ||
+       !std::equal(y.begin_indices(), y.end_indices(), ref.begin_indices()))
+    {
+        throw std::logic_error{"spmspv: pattern"};
+    }
+    for(std::size_t i = 0; i < y.size(); ++i) {
+        if(std::abs(double(y.data()[i] - ref.data()[i])) > 1e-9)
+            throw std::logic_error{"spmspv: values"};
+    }
+}
+
+
+//-------------------------------------------------------------------
+template<class T>
+void test_spmspv()
+{
+    const auto m = make_random_matrix<T>(300, 250, 2000, 3);
+    auto engine = spmspv_engine<crs_matrix<T>>{m};
+
+    auto urbg = std::mt19937{5};
+    auto y = sparse_vector<T>{};
+
+    for(double density : {0.0, 0.002, 0.02, 0.2, 1.0}) {
+        auto uni = std::uniform_real_distribution<double>{0.0, 1.0};
+        auto x = sparse_vector<T>{m.cols()};
+        for(std::size_t i = 0; i < m.cols(); ++i) {
+            if(uni(urbg) < density) x.push_back(i, T(int(i % 5) - 2));
+        }
+
+        engine.multiply(x, y, spmspv_direction::push);
+        check_product(m, x, y);
+
+        engine.multiply(x, y, spmspv_direction::pull);
+        check_product(m, x, y);
+
+        //workspace must be clean after each call
+        const auto dir = engine.multiply(x, y);
+        check_product(m, x, y);
+
+        if(density < 0.01 && dir != spmspv_direction::push)
+            throw std::logic_error{"spmspv: direction for sparse x"};
+        if(density > 0.9 && dir != spmspv_direction::pull)
+            throw std::logic_error{"spmspv: direction for dense x"};
+    }
+
+    //indices beyond the matrix' columns are ignored
+    auto x = sparse_vector<T>{};
+    x.push_back(3, T(1));
+    x.push_back(1000, T(1));
+    engine.multiply(x, y, spmspv_direction::push);
+    check_product(m, x, y);
+    engine.multiply(x, y, spmspv_direction::pull);
+    check_product(m, x, y);
+
+    //symmetric matrix as its own transpose
+    const auto s = make_random_matrix<T>(50, 50, 200, 9);
+    const auto sym = spgemm(s, transpose(s));
+    auto symEngine = spmspv_engine<crs_matrix<T>>{sym, sym};
+    auto xs = sparse_vector<T>{};
+    xs.push_back(7, T(2));
+    xs.push_back(21, T(-1));
+    symEngine.multiply(xs, y, spmspv_direction::push);
+    check_product(sym, xs, y);
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_sparse_vector();
+        test_spmspv<int>();
+        test_spmspv<double>();
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}
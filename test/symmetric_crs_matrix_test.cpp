@@ -0,0 +1,185 @@
+/*****************************************************************************
+ *
+ * AM utilities
+ *
+ * released under MIT license
+ *
+ * 2008-2017 André Müller
+ *
+ *****************************************************************************/
+
+#include "symmetric_crs_matrix.h"
+#include "crs_matrix_algorithms.h"
+
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+
+
+using namespace am;
+
+
+//-------------------------------------------------------------------
+/// @brief random symmetric matrix with both triangles stored
+template<class Matrix>
+Matrix
+make_symmetric_matrix(std::size_t n, std::size_t nnz, unsigned seed = 0)
+{
+    using value_t = typename Matrix::value_type;
+
+    auto urbg = std::mt19937{seed};
+    auto idxDistr = std::uniform_int_distribution<std::size_t>{0, n-1};
+    auto valDistr = std::uniform_int_distribution<int>{-9, 9};
+
+    auto tri = std::vector<crs_triplet<value_t>>{};
+    for(std::size_t i = 0; i < nnz; ++i) {
+        const auto r = idxDistr(urbg);
+        const auto c = idxDistr(urbg);
+        const auto v = value_t(valDistr(urbg));
+        tri.push_back(crs_triplet<value_t>{r, c, v});
+        tri.push_back(crs_triplet<value_t>{c, r, v});
+    }
+    tri.push_back(crs_triplet<value_t>{n-1, n-1, value_t(1)});
+
+    //mirrored duplicates get the same value => keep_last keeps symmetry
+    return Matrix::from_triplets(tri.begin(), tri.end());
+}
+
+
+
+//-------------------------------------------------------------------
+template<class T>
+void test_storage()
+{
+    using full_t = crs_matrix<T>;
+    using sym_t  = symmetric_crs_matrix<T>;
+
+    const auto m = make_symmetric_matrix<full_t>(60, 400, 1);
+    const auto s = sym_t{m};
+
+    if(s.rows() != m.rows() || s.cols() != m.rows())
+        throw std::logic_error{"symmetric_crs_matrix: shape"};
+
+    std::size_t diag = 0;
+    for(std::size_t r = 0; r < m.rows(); ++r) {
+        for(std::size_t c = 0; c < m.cols(); ++c) {
+            if(s.has(r, c) != m.has(r, c) || s(r, c) != m(r, c))
+                throw std::logic_error{"symmetric_crs_matrix: mirrored access"};
+        }
+        if(m.has(r, r)) ++diag;
+        //only the lower triangle is stored
+        for(auto it = s.begin_row(r); it != s.end_row(r); ++it) {
+            if(s.col_index_of(it) > r)
+                throw std::logic_error{"symmetric_crs_matrix: upper triangle"};
+        }
+    }
+    if(s.full_size() != m.size() || s.size() != (m.size() + diag) / 2)
+        throw std::logic_error{"symmetric_crs_matrix: size"};
+
+    //round trip
+    const auto f = s.to_crs_matrix();
+    if(f.size() != m.size() || f.rows() != m.rows() ||
+       !std::equal(f.begin(), f.end(), m.begin()) ||
+       !std::equal(f.begin_col_indices(), f.end_col_indices(),
+                   m.begin_col_indices()))
+    {
+        throw std::logic_error{"symmetric_crs_matrix: to_crs_matrix"};
+    }
+
+    //triplets from either triangle
+    auto tri = std::vector<crs_triplet<T>>{{0,3,T(1)}, {3,0,T(2)}, {4,4,T(5)}, {1,2,T(7)}};
+    const auto t = sym_t::from_triplets(tri.begin(), tri.end());
+    if(t.size() != 3 || t(0,3) != T(2) || t(3,0) != T(2) || t(2,1) != T(7) ||
+       t(4,4) != T(5) || t.rows() != 5 || t.cols() != 5)
+    {
+        throw std::logic_error{"symmetric_crs_matrix: from_triplets"};
+    }
+
+    //modification
+    auto u = sym_t{};
+    if(!u.insert(2, 7, T(3)) || u.insert(7, 2, T(4)) || u.size() != 1 ||
+       u(2, 7) != T(4) || u.rows() != 8 || u.cols() != 8)
+    {
+        throw std::logic_error{"symmetric_crs_matrix: insert"};
+    }
+    if(!u.erase(2, 7) || u.erase(7, 2) || !u.empty())
+        throw std::logic_error{"symmetric_crs_matrix: erase"};
+}
+
+
+
+//-------------------------------------------------------------------
+template<class Matrix>
+void test_spmv()
+{
+    using value_t = typename Matrix::value_type;
+    using sym_t = symmetric_crs_matrix<value_t,
+                                       typename Matrix::na_value_type,
+                                       std::allocator<value_t>,
+                                       typename Matrix::col_index_type,
+                                       typename Matrix::row_offset_type>;
+
+    //one workspace reused across matrices of different sizes
+    auto ws = symmetric_spmv_workspace<value_t>{};
+
+    for(std::size_t n : {300, 1, 2, 7, 1000}) {
+        const auto m = make_symmetric_matrix<Matrix>(n, 4*n, unsigned(n));
+        const auto s = sym_t{m};
+
+        auto x = std::vector<value_t>(n);
+        auto y0 = std::vector<value_t>(n);
+        for(std::size_t i = 0; i < n; ++i) {
+            x[i]  = value_t(int(i % 7) - 3);
+            y0[i] = value_t(int(i % 5) - 2);
+        }
+
+        for(int threads : {1, 2, 3, 8}) {
+            for(auto beta : {value_t(0), value_t(2)}) {
+                auto expected = y0;
+                spmv(m, x.data(), expected.data(), value_t(3), beta);
+                auto y = y0;
+                spmv(s, x, y, value_t(3), beta, threads);
+
+                for(std::size_t i = 0; i < n; ++i) {
+                    if(std::abs(double(y[i]) - double(expected[i])) > 1e-6)
+                        throw std::logic_error{"symmetric_crs_matrix: spmv"};
+                }
+
+                y = y0;
+                spmv(s, x, y, ws, value_t(3), beta, threads);
+                for(std::size_t i = 0; i < n; ++i) {
+                    if(std::abs(double(y[i]) - double(expected[i])) > 1e-6)
+                        throw std::logic_error{"symmetric_crs_matrix: spmv workspace"};
+                }
+            }
+        }
+    }
+
+    auto y = std::vector<value_t>{};
+    spmv(sym_t{}, std::vector<value_t>{}, y);
+    if(!y.empty()) throw std::logic_error{"symmetric_crs_matrix: spmv empty"};
+}
+
+
+
+//-------------------------------------------------------------------
+int main()
+{
+    try {
+        test_storage<int>();
+        test_storage<double>();
+
+        test_spmv<crs_matrix<int>>();
+        test_spmv<crs_matrix<double>>();
+        test_spmv<crs_matrix<float,crs_matrix_static_value<float,0>,
+            std::allocator<float>,std::uint32_t,std::uint32_t>>();
+    }
+    catch(std::exception& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+}